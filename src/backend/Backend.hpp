@@ -88,6 +88,10 @@ struct TransformMatrix {
     return a == 1.0f && b == 0.0f && c == 0.0f && d == 1.0f && e == 0.0f &&
            f == 0.0f;
   }
+  bool operator==(const TransformMatrix &other) const {
+    return a == other.a && b == other.b && c == other.c && d == other.d &&
+           e == other.e && f == other.f;
+  }
   void clear() {
     a = d = 1.0;
     c = e = b = f = 0.0;
@@ -52,6 +52,7 @@ static void glfw_error_callback(int error, const char *description) {
 
 bool BackendGL::m_lbutton_down = false;
 vfloat2_t BackendGL::m_lbutton_down_mouse_pos;
+float BackendGL::m_scroll_delta = 0.f;
 
 static void glfw_mouse_callback(GLFWwindow *window, int button, int action,
                                 int mods) {
@@ -67,6 +68,11 @@ static void glfw_mouse_callback(GLFWwindow *window, int button, int action,
   }
 }
 
+static void glfw_scroll_callback(GLFWwindow *window, double xoffset,
+                                 double yoffset) {
+  BackendGL::add_mouse_scroll(static_cast<float>(yoffset));
+}
+
 void BackendGL::init(const vfloat2_t &pixels, const char *name) {
   m_window = create_window(static_cast<vint2_t>(pixels), name);
   if (!m_window)
@@ -83,6 +89,7 @@ void BackendGL::set_mouse_down(const vfloat2_t &mouse_pos) {
   m_lbutton_down_mouse_pos = mouse_pos;
 }
 void BackendGL::set_mouse_up() { m_lbutton_down = false; }
+void BackendGL::add_mouse_scroll(const float delta) { m_scroll_delta += delta; }
 
 vfloat2_t BackendGL::get_mouse_pos() {
   double xpos, ypos;
@@ -105,6 +112,10 @@ void BackendGL::mouse_drag_reset_delta() {
   m_lbutton_down_mouse_pos = get_mouse_pos();
 }
 
+float BackendGL::mouse_scroll_delta() { return m_scroll_delta; }
+
+void BackendGL::mouse_scroll_reset_delta() { m_scroll_delta = 0.f; }
+
 void BackendGL::scissor(const bfloat2_t &x) {
   const auto &delta = x.delta();
   const auto &min = x.min();
@@ -141,6 +152,60 @@ void BackendGL::circle(const vfloat2_t &centre, float radius) {
   fill();
 }
 
+void BackendGL::circles(const int n, const float *x, const float *y,
+                        const float *r, const RGBA *fill) {
+  // keep the current fill color for the primitives drawn after these
+  if (fill) {
+    nvgSave(m_vg);
+  }
+  for (int begin = 0, end = 0; begin < n; begin = end) {
+    if (fill) {
+      fill_color(fill[begin]);
+    }
+    begin_path();
+    for (end = begin; end < n && (!fill || fill[end] == fill[begin]); ++end) {
+      nvgCircle(m_vg, x[end], y[end], r[end]);
+    }
+    nvgFill(m_vg);
+  }
+  if (fill) {
+    nvgRestore(m_vg);
+  }
+}
+
+void BackendGL::rects(const int n, const float *xmin, const float *ymin,
+                      const float *xmax, const float *ymax, const RGBA *stroke,
+                      const RGBA *fill) {
+  // as in circles(), the fill color set by the caller is restored afterwards
+  if (fill) {
+    nvgSave(m_vg);
+  }
+  for (int begin = 0, end = 0; begin < n; begin = end) {
+    if (fill) {
+      fill_color(fill[begin]);
+    }
+    begin_path();
+    for (end = begin; end < n && (!fill || fill[end] == fill[begin]); ++end) {
+      nvgRect(m_vg, xmin[end], ymin[end], xmax[end] - xmin[end],
+              ymax[end] - ymin[end]);
+    }
+    nvgFill(m_vg);
+  }
+  if (fill) {
+    nvgRestore(m_vg);
+  }
+}
+
+void BackendGL::polyline(const int n, const float *x, const float *y,
+                         const int stride) {
+  if (n > 0) {
+    nvgMoveTo(m_vg, x[0], y[0]);
+  }
+  for (int i = 1; i < n; ++i) {
+    nvgLineTo(m_vg, x[i * stride], y[i * stride]);
+  }
+}
+
 void BackendGL::move_to(const vfloat2_t &x) { nvgMoveTo(m_vg, x[0], x[1]); }
 void BackendGL::line_to(const vfloat2_t &x) { nvgLineTo(m_vg, x[0], x[1]); }
 void BackendGL::stroke_color(const RGBA &color) {
@@ -244,6 +309,7 @@ GLFWwindow *BackendGL::create_window(const vint2_t &pixels, const char *name) {
     throw Exception("Could not create GLFW window");
 
   glfwSetMouseButtonCallback(window, glfw_mouse_callback);
+  glfwSetScrollCallback(window, glfw_scroll_callback);
   glfwMakeContextCurrent(window);
   glfwSwapInterval(1); // Enable vsync
   return window;
@@ -58,6 +58,7 @@ class BackendGL : public Backend {
   FontManager m_fm;
   static bool m_lbutton_down;
   static vfloat2_t m_lbutton_down_mouse_pos;
+  static float m_scroll_delta;
 
 public:
   TRASE_BACKEND_VISITABLE()
@@ -90,6 +91,7 @@ public:
 
   static void set_mouse_down(const vfloat2_t &mouse_pos);
   static void set_mouse_up();
+  static void add_mouse_scroll(float delta);
 
   /// Get the current position of the mouse in pixel units
   vfloat2_t get_mouse_pos();
@@ -103,6 +105,13 @@ public:
   /// Reset drag delta to zero
   void mouse_drag_reset_delta();
 
+  /// Amount the mouse wheel has scrolled since the last reset, positive
+  /// when scrolling up
+  float mouse_scroll_delta();
+
+  /// Reset scroll delta to zero
+  void mouse_scroll_reset_delta();
+
   /// All subsequent drawing calls will be masked to only show within the
   /// bounding box @p x
   void scissor(const bfloat2_t &x);
@@ -133,6 +142,12 @@ public:
   /// @see begin_path()
   void line_to(const vfloat2_t &x);
 
+  /// Extends the current path with a polyline of @p n points, moving the
+  /// "pen" to the first point and drawing lines to the rest. Point i is
+  /// (@p x[i * @p stride], @p y[i * @p stride])
+  /// @see begin_path()
+  void polyline(int n, const float *x, const float *y, int stride = 1);
+
   /// Draw a line along the completed path
   /// @see begin_path()
   void stroke();
@@ -165,6 +180,23 @@ public:
   /// Draw a circle with a given @p centre and @p radius
   void circle(const vfloat2_t &centre, float radius);
 
+  /// Draw @p n rectangles, rectangle i having opposite corners (@p xmin[i],
+  /// @p ymin[i]) and (@p xmax[i], @p ymax[i]), filled with @p fill[i] (or the
+  /// current fill color if @p fill is nullptr). Consecutive rectangles of the
+  /// same color are filled as a single path, and the current fill color is
+  /// left unchanged. As for rect(), rectangles are not stroked, so @p stroke
+  /// is not used
+  void rects(int n, const float *xmin, const float *ymin, const float *xmax,
+             const float *ymax, const RGBA *stroke = nullptr,
+             const RGBA *fill = nullptr);
+
+  /// Draw @p n circles, circle i centred at (@p x[i], @p y[i]) with radius
+  /// @p r[i], filled with @p fill[i] (or the current fill color if @p fill is
+  /// nullptr). Consecutive circles of the same color are filled as a single
+  /// path, and the current fill color is left unchanged
+  void circles(int n, const float *x, const float *y, const float *r,
+               const RGBA *fill = nullptr);
+
   /// Draw the given text to the screen
   /// @param x the position to draw the text
   /// @param a pointer to the text
@@ -0,0 +1,631 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "backend/BackendRecorder.hpp"
+
+#include <algorithm>
+
+namespace trase {
+
+namespace {
+
+const char magic[8] = {'T', 'R', 'A', 'S', 'E', 'R', 'E', 'C'};
+const std::uint32_t format_version = 1;
+
+/// flags recording which color arrays a bulk command has
+const std::uint8_t has_stroke = 1;
+const std::uint8_t has_fill = 2;
+
+/// reads plain values from the byte range [@p begin, @p end), throwing if
+/// the range runs out
+class Reader {
+  const char *m_pos;
+  const char *m_end;
+
+public:
+  Reader(const char *begin, const char *end) : m_pos(begin), m_end(end) {}
+
+  const char *pos() const { return m_pos; }
+
+  /// the number of bytes left to read
+  std::size_t remaining() const { return m_end - m_pos; }
+
+  template <typename T> T read() {
+    T value;
+    read(&value, 1);
+    return value;
+  }
+
+  template <typename T> void read(T *values, const std::size_t n) {
+    if (static_cast<std::size_t>(m_end - m_pos) / sizeof(T) < n) {
+      throw Exception("BackendRecorder: recording is truncated");
+    }
+    std::memcpy(values, m_pos, n * sizeof(T));
+    m_pos += n * sizeof(T);
+  }
+};
+
+template <typename T> void write_value(std::ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T read_value(std::istream &in) {
+  T value;
+  if (!in.read(reinterpret_cast<char *>(&value), sizeof(T))) {
+    throw Exception("BackendRecorder: recording is truncated");
+  }
+  return value;
+}
+
+/// reads @p size bytes from @p in into @p out. The bytes are read in chunks,
+/// growing @p out only as they arrive, so that a corrupt size in the stream
+/// throws once the stream runs out rather than allocating the whole size
+template <typename Container>
+void read_bytes(std::istream &in, const std::uint64_t size, Container &out) {
+  const std::uint64_t chunk = std::uint64_t(1) << 20;
+  if (size > out.max_size()) {
+    throw Exception("BackendRecorder: recording is corrupt");
+  }
+  out.clear();
+  while (out.size() < size) {
+    const std::size_t offset = out.size();
+    const auto count =
+        static_cast<std::size_t>(std::min<std::uint64_t>(chunk, size - offset));
+    out.resize(offset + count);
+    if (!in.read(&out[offset], count)) {
+      throw Exception("BackendRecorder: recording is truncated");
+    }
+  }
+}
+
+std::uint64_t color_key(const RGBA &color) {
+  return (static_cast<std::uint64_t>(color.r() & 0xffff) << 48) |
+         (static_cast<std::uint64_t>(color.g() & 0xffff) << 32) |
+         (static_cast<std::uint64_t>(color.b() & 0xffff) << 16) |
+         static_cast<std::uint64_t>(color.a() & 0xffff);
+}
+
+} // namespace
+
+void BackendRecorder::write_command(const Command command) {
+  write(static_cast<std::uint8_t>(command));
+  ++m_size;
+}
+
+void BackendRecorder::write_point(const vfloat2_t &x) {
+  write(x[0]);
+  write(x[1]);
+}
+
+void BackendRecorder::write_box(const bfloat2_t &x) {
+  write_point(x.bmin);
+  write_point(x.bmax);
+}
+
+void BackendRecorder::write_string(const char *begin, const char *end) {
+  std::string string = end ? std::string(begin, end) : std::string(begin);
+  auto found = m_string_index.find(string);
+  if (found == m_string_index.end()) {
+    const auto index = static_cast<std::uint32_t>(m_strings.size());
+    found = m_string_index.emplace(string, index).first;
+    m_strings.push_back(std::move(string));
+  }
+  write(found->second);
+}
+
+void BackendRecorder::write_color(const RGBA &color) {
+  const std::uint64_t key = color_key(color);
+  auto found = m_color_index.find(key);
+  if (found == m_color_index.end()) {
+    const auto index = static_cast<std::uint32_t>(m_colors.size());
+    found = m_color_index.emplace(key, index).first;
+    m_colors.push_back(color);
+  }
+  write(found->second);
+}
+
+void BackendRecorder::write_array(const int n, const float *x,
+                                  const int stride) {
+  const std::size_t offset = m_buffer.size();
+  m_buffer.resize(offset + n * sizeof(float));
+  if (stride == 1) {
+    std::memcpy(&m_buffer[offset], x, n * sizeof(float));
+  } else {
+    for (int i = 0; i < n; ++i) {
+      std::memcpy(&m_buffer[offset + i * sizeof(float)], &x[i * stride],
+                  sizeof(float));
+    }
+  }
+}
+
+BackendRecorder::Command BackendRecorder::next(std::size_t &offset,
+                                               Arguments &args) const {
+  Reader reader(m_buffer.data() + offset, m_buffer.data() + m_buffer.size());
+  auto read_point = [&]() {
+    vfloat2_t x;
+    x[0] = reader.read<float>();
+    x[1] = reader.read<float>();
+    return x;
+  };
+  auto read_box = [&]() {
+    const vfloat2_t bmin = read_point();
+    const vfloat2_t bmax = read_point();
+    return bfloat2_t(bmin, bmax);
+  };
+  auto read_string = [&]() {
+    const auto index = reader.read<std::uint32_t>();
+    if (index >= m_strings.size()) {
+      throw Exception("BackendRecorder: invalid string in recording");
+    }
+    return &m_strings[index];
+  };
+  auto read_color = [&]() {
+    const auto index = reader.read<std::uint32_t>();
+    if (index >= m_colors.size()) {
+      throw Exception("BackendRecorder: invalid color in recording");
+    }
+    return m_colors[index];
+  };
+  // the array length is checked against the bytes left before anything is
+  // allocated, so that a corrupt length cannot allocate more than the buffer
+  auto read_arrays = [&](const int count) {
+    args.n = reader.read<std::int32_t>();
+    if (args.n < 0) {
+      throw Exception("BackendRecorder: invalid array in recording");
+    }
+    if (reader.remaining() / (count * sizeof(float)) <
+        static_cast<std::size_t>(args.n)) {
+      throw Exception("BackendRecorder: recording is truncated");
+    }
+    for (int i = 0; i < count; ++i) {
+      args.arrays[i].resize(args.n);
+      reader.read(args.arrays[i].data(), args.arrays[i].size());
+    }
+  };
+  auto read_colors = [&](std::vector<RGBA> &colors, const bool present) {
+    colors.clear();
+    if (present) {
+      if (reader.remaining() / sizeof(std::uint32_t) <
+          static_cast<std::size_t>(args.n)) {
+        throw Exception("BackendRecorder: recording is truncated");
+      }
+      colors.resize(args.n);
+      for (auto &color : colors) {
+        color = read_color();
+      }
+    }
+  };
+
+  const auto opcode = reader.read<std::uint8_t>();
+  if (opcode >= static_cast<std::uint8_t>(Command::count)) {
+    throw Exception("BackendRecorder: invalid command in recording");
+  }
+  const auto command = static_cast<Command>(opcode);
+  switch (command) {
+  case Command::init:
+    args.point = read_point();
+    args.string = read_string();
+    args.time = reader.read<float>();
+    break;
+  case Command::scissor:
+  case Command::rect:
+    args.box = read_box();
+    break;
+  case Command::rotate:
+  case Command::stroke_width:
+  case Command::font_size:
+  case Command::font_blur:
+    args.value = reader.read<float>();
+    break;
+  case Command::translate:
+  case Command::move_to:
+  case Command::line_to:
+    args.point = read_point();
+    break;
+  case Command::polyline:
+    read_arrays(2);
+    break;
+  case Command::add_animated_path:
+  case Command::end_animated_path:
+    args.time = reader.read<float>();
+    break;
+  case Command::rounded_rect:
+    args.box = read_box();
+    args.value = reader.read<float>();
+    break;
+  case Command::rects: {
+    read_arrays(4);
+    const auto flags = reader.read<std::uint8_t>();
+    read_colors(args.strokes, flags & has_stroke);
+    read_colors(args.fills, flags & has_fill);
+    break;
+  }
+  case Command::add_animated_rect:
+    args.box = read_box();
+    args.time = reader.read<float>();
+    break;
+  case Command::add_animated_stroke:
+  case Command::add_animated_fill:
+  case Command::stroke_color:
+  case Command::fill_color:
+    args.color = read_color();
+    break;
+  case Command::circle:
+    args.point = read_point();
+    args.value = reader.read<float>();
+    break;
+  case Command::circles: {
+    read_arrays(3);
+    const auto flags = reader.read<std::uint8_t>();
+    read_colors(args.fills, flags & has_fill);
+    break;
+  }
+  case Command::add_animated_circle:
+    args.point = read_point();
+    args.value = reader.read<float>();
+    args.time = reader.read<float>();
+    break;
+  case Command::stroke_color_mouseover:
+  case Command::fill_color_mouseover:
+    args.color = read_color();
+    args.color_mouseover = read_color();
+    break;
+  case Command::tooltip:
+  case Command::text:
+    args.point = read_point();
+    args.string = read_string();
+    break;
+  case Command::font_face:
+    args.string = read_string();
+    break;
+  case Command::text_align:
+    args.align = reader.read<std::uint32_t>();
+    break;
+  default:
+    // no arguments
+    break;
+  }
+  offset = reader.pos() - m_buffer.data();
+  return command;
+}
+
+std::vector<BackendRecorder::Command> BackendRecorder::commands() const {
+  std::vector<Command> result;
+  result.reserve(m_size);
+  Arguments args;
+  std::size_t offset = 0;
+  while (offset < m_buffer.size()) {
+    result.push_back(next(offset, args));
+  }
+  return result;
+}
+
+void BackendRecorder::clear() {
+  m_buffer.clear();
+  m_size = 0;
+  m_strings.clear();
+  m_string_index.clear();
+  m_colors.clear();
+  m_color_index.clear();
+}
+
+void BackendRecorder::save(std::ostream &out) const {
+  out.write(magic, sizeof(magic));
+  write_value(out, format_version);
+
+  write_value(out, static_cast<std::uint32_t>(m_strings.size()));
+  for (const auto &string : m_strings) {
+    write_value(out, static_cast<std::uint32_t>(string.size()));
+    out.write(string.data(), string.size());
+  }
+
+  write_value(out, static_cast<std::uint32_t>(m_colors.size()));
+  for (const auto &color : m_colors) {
+    for (const int channel : {color.r(), color.g(), color.b(), color.a()}) {
+      write_value(out, static_cast<std::int32_t>(channel));
+    }
+  }
+
+  write_value(out, static_cast<std::uint64_t>(m_size));
+  write_value(out, static_cast<std::uint64_t>(m_buffer.size()));
+  out.write(m_buffer.data(), m_buffer.size());
+}
+
+void BackendRecorder::load(std::istream &in) {
+  char header[sizeof(magic)];
+  if (!in.read(header, sizeof(header)) ||
+      !std::equal(header, header + sizeof(header), magic)) {
+    throw Exception("BackendRecorder: stream does not hold a recording");
+  }
+  if (read_value<std::uint32_t>(in) != format_version) {
+    throw Exception("BackendRecorder: unsupported recording version");
+  }
+
+  BackendRecorder loaded;
+  const auto n_strings = read_value<std::uint32_t>(in);
+  for (std::uint32_t i = 0; i < n_strings; ++i) {
+    std::string string;
+    read_bytes(in, read_value<std::uint32_t>(in), string);
+    loaded.m_string_index.emplace(string, i);
+    loaded.m_strings.push_back(std::move(string));
+  }
+
+  const auto n_colors = read_value<std::uint32_t>(in);
+  for (std::uint32_t i = 0; i < n_colors; ++i) {
+    std::array<std::int32_t, 4> channels;
+    for (auto &channel : channels) {
+      channel = read_value<std::int32_t>(in);
+    }
+    const RGBA color(channels[0], channels[1], channels[2], channels[3]);
+    loaded.m_color_index.emplace(color_key(color), i);
+    loaded.m_colors.push_back(color);
+  }
+
+  const auto size = read_value<std::uint64_t>(in);
+  read_bytes(in, read_value<std::uint64_t>(in), loaded.m_buffer);
+
+  // check every command can be read before replacing the recording
+  loaded.m_size = loaded.commands().size();
+  if (loaded.m_size != size) {
+    throw Exception("BackendRecorder: recording is corrupt");
+  }
+  *this = std::move(loaded);
+}
+
+void BackendRecorder::init(const vfloat2_t &pixels, const char *name,
+                           const float time_span) {
+  write_command(Command::init);
+  write_point(pixels);
+  write_string(name, nullptr);
+  write(time_span);
+}
+
+void BackendRecorder::finalise() { write_command(Command::finalise); }
+
+void BackendRecorder::scissor(const bfloat2_t &x) {
+  write_command(Command::scissor);
+  write_box(x);
+}
+
+void BackendRecorder::reset_scissor() {
+  write_command(Command::reset_scissor);
+}
+
+void BackendRecorder::rotate(const float angle) {
+  write_command(Command::rotate);
+  write(angle);
+}
+
+void BackendRecorder::reset_transform() {
+  write_command(Command::reset_transform);
+}
+
+void BackendRecorder::translate(const vfloat2_t &v) {
+  write_command(Command::translate);
+  write_point(v);
+}
+
+void BackendRecorder::begin_path() { write_command(Command::begin_path); }
+
+void BackendRecorder::move_to(const vfloat2_t &x) {
+  write_command(Command::move_to);
+  write_point(x);
+}
+
+void BackendRecorder::line_to(const vfloat2_t &x) {
+  write_command(Command::line_to);
+  write_point(x);
+}
+
+void BackendRecorder::polyline(const int n, const float *x, const float *y,
+                               const int stride) {
+  write_command(Command::polyline);
+  write(static_cast<std::int32_t>(n));
+  write_array(n, x, stride);
+  write_array(n, y, stride);
+}
+
+void BackendRecorder::stroke() { write_command(Command::stroke); }
+
+void BackendRecorder::fill() { write_command(Command::fill); }
+
+void BackendRecorder::begin_animated_path() {
+  write_command(Command::begin_animated_path);
+}
+
+void BackendRecorder::add_animated_path(const float time) {
+  write_command(Command::add_animated_path);
+  write(time);
+}
+
+void BackendRecorder::end_animated_path(const float time) {
+  write_command(Command::end_animated_path);
+  write(time);
+}
+
+void BackendRecorder::rounded_rect(const bfloat2_t &x, const float r) {
+  write_command(Command::rounded_rect);
+  write_box(x);
+  write(r);
+}
+
+void BackendRecorder::rect(const bfloat2_t &x, const float r) {
+  if (r != 0.f) {
+    rounded_rect(x, r);
+    return;
+  }
+  write_command(Command::rect);
+  write_box(x);
+}
+
+void BackendRecorder::rects(const int n, const float *xmin, const float *ymin,
+                            const float *xmax, const float *ymax,
+                            const RGBA *stroke, const RGBA *fill) {
+  write_command(Command::rects);
+  write(static_cast<std::int32_t>(n));
+  write_array(n, xmin);
+  write_array(n, ymin);
+  write_array(n, xmax);
+  write_array(n, ymax);
+  write(static_cast<std::uint8_t>((stroke ? has_stroke : 0) |
+                                  (fill ? has_fill : 0)));
+  for (const RGBA *colors : {stroke, fill}) {
+    if (colors) {
+      for (int i = 0; i < n; ++i) {
+        write_color(colors[i]);
+      }
+    }
+  }
+}
+
+void BackendRecorder::add_animated_rect(const bfloat2_t &x, const float time) {
+  write_command(Command::add_animated_rect);
+  write_box(x);
+  write(time);
+}
+
+void BackendRecorder::add_animated_stroke(const RGBA &color) {
+  write_command(Command::add_animated_stroke);
+  write_color(color);
+}
+
+void BackendRecorder::add_animated_fill(const RGBA &color) {
+  write_command(Command::add_animated_fill);
+  write_color(color);
+}
+
+void BackendRecorder::end_animated_rect() {
+  write_command(Command::end_animated_rect);
+}
+
+void BackendRecorder::circle(const vfloat2_t &centre, const float r) {
+  write_command(Command::circle);
+  write_point(centre);
+  write(r);
+}
+
+void BackendRecorder::circles(const int n, const float *x, const float *y,
+                              const float *r, const RGBA *fill) {
+  write_command(Command::circles);
+  write(static_cast<std::int32_t>(n));
+  write_array(n, x);
+  write_array(n, y);
+  write_array(n, r);
+  write(static_cast<std::uint8_t>(fill ? has_fill : 0));
+  if (fill) {
+    for (int i = 0; i < n; ++i) {
+      write_color(fill[i]);
+    }
+  }
+}
+
+void BackendRecorder::add_animated_circle(const vfloat2_t &centre,
+                                          const float radius,
+                                          const float time) {
+  write_command(Command::add_animated_circle);
+  write_point(centre);
+  write(radius);
+  write(time);
+}
+
+void BackendRecorder::end_animated_circle() {
+  write_command(Command::end_animated_circle);
+}
+
+void BackendRecorder::stroke_color(const RGBA &color) {
+  write_command(Command::stroke_color);
+  write_color(color);
+}
+
+void BackendRecorder::stroke_color(const RGBA &color,
+                                   const RGBA &color_mouseover) {
+  write_command(Command::stroke_color_mouseover);
+  write_color(color);
+  write_color(color_mouseover);
+}
+
+void BackendRecorder::fill_color(const RGBA &color) {
+  write_command(Command::fill_color);
+  write_color(color);
+}
+
+void BackendRecorder::fill_color(const RGBA &color,
+                                 const RGBA &color_mouseover) {
+  write_command(Command::fill_color_mouseover);
+  write_color(color);
+  write_color(color_mouseover);
+}
+
+void BackendRecorder::tooltip(const vfloat2_t &x, const char *string) {
+  write_command(Command::tooltip);
+  write_point(x);
+  write_string(string, nullptr);
+}
+
+void BackendRecorder::clear_tooltip() {
+  write_command(Command::clear_tooltip);
+}
+
+void BackendRecorder::stroke_width(const float lw) {
+  write_command(Command::stroke_width);
+  write(lw);
+}
+
+void BackendRecorder::font_size(const float size) {
+  write_command(Command::font_size);
+  write(size);
+}
+
+void BackendRecorder::font_face(const char *face) {
+  write_command(Command::font_face);
+  write_string(face, nullptr);
+}
+
+void BackendRecorder::font_blur(const float blur) {
+  write_command(Command::font_blur);
+  write(blur);
+}
+
+void BackendRecorder::text_align(const unsigned int align) {
+  write_command(Command::text_align);
+  write(static_cast<std::uint32_t>(align));
+}
+
+void BackendRecorder::text(const vfloat2_t &x, const char *string,
+                           const char *end) {
+  write_command(Command::text);
+  write_point(x);
+  write_string(string, end);
+}
+
+} // namespace trase
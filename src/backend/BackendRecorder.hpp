@@ -0,0 +1,466 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file BackendRecorder.hpp
+
+#ifndef BACKENDRECORDER_H_
+#define BACKENDRECORDER_H_
+
+#include "backend/Backend.hpp"
+#include "util/BBox.hpp"
+#include "util/Colors.hpp"
+#include "util/Exception.hpp"
+#include "util/Vector.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace trase {
+
+/// A backend that records the drawing commands it is given into a compact
+/// display list, rather than drawing them
+///
+/// The recording can be replayed into any other backend (e.g. BackendSVG,
+/// BackendGL or another BackendRecorder) any number of times, so that a
+/// figure is drawn once and written out many times. It can also be saved to
+/// a stream and loaded again.
+///
+/// Each command is stored in a single byte buffer as a one byte opcode
+/// followed by its arguments. Strings and colors are interned in tables, so
+/// that commands refer to them by index.
+class BackendRecorder : public AnimatedBackend {
+public:
+  /// the drawing commands that can be recorded, named after the backend
+  /// function that records them
+  enum class Command : std::uint8_t {
+    init,
+    finalise,
+    scissor,
+    reset_scissor,
+    rotate,
+    reset_transform,
+    translate,
+    begin_path,
+    move_to,
+    line_to,
+    polyline,
+    stroke,
+    fill,
+    begin_animated_path,
+    add_animated_path,
+    end_animated_path,
+    rounded_rect,
+    rect,
+    rects,
+    add_animated_rect,
+    add_animated_stroke,
+    add_animated_fill,
+    end_animated_rect,
+    circle,
+    circles,
+    add_animated_circle,
+    end_animated_circle,
+    stroke_color,
+    stroke_color_mouseover,
+    fill_color,
+    fill_color_mouseover,
+    tooltip,
+    clear_tooltip,
+    stroke_width,
+    font_size,
+    font_face,
+    font_blur,
+    text_align,
+    text,
+    count ///< the number of commands
+  };
+
+private:
+  /// the arguments of a single recorded command, filled by next()
+  struct Arguments {
+    vfloat2_t point;
+    bfloat2_t box;
+    float value{0.f};
+    float time{0.f};
+    const std::string *string{nullptr};
+    RGBA color;
+    RGBA color_mouseover;
+    unsigned int align{0};
+    int n{0};
+
+    /// coordinate arrays of the bulk commands (e.g. x, y and r of circles)
+    std::array<std::vector<float>, 4> arrays;
+
+    /// per element stroke and fill colors of the bulk commands, empty if not
+    /// given
+    std::vector<RGBA> strokes;
+    std::vector<RGBA> fills;
+  };
+
+  /// the recorded commands and their arguments
+  std::vector<char> m_buffer;
+
+  /// the number of commands recorded
+  std::size_t m_size{0};
+
+  /// interned strings
+  std::vector<std::string> m_strings;
+  std::unordered_map<std::string, std::uint32_t> m_string_index;
+
+  /// interned colors
+  std::vector<RGBA> m_colors;
+  std::unordered_map<std::uint64_t, std::uint32_t> m_color_index;
+
+  template <typename T> void write(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be written to the buffer");
+    const std::size_t offset = m_buffer.size();
+    m_buffer.resize(offset + sizeof(T));
+    std::memcpy(&m_buffer[offset], &value, sizeof(T));
+  }
+
+  void write_command(Command command);
+  void write_point(const vfloat2_t &x);
+  void write_box(const bfloat2_t &x);
+  void write_string(const char *begin, const char *end);
+  void write_color(const RGBA &color);
+  void write_array(int n, const float *x, int stride = 1);
+
+  /// reads the command at @p offset of the buffer into @p args, and returns
+  /// it, moving @p offset to the next command. Throws if the command or its
+  /// arguments are not valid
+  Command next(std::size_t &offset, Arguments &args) const;
+
+  template <typename Target>
+  static void replay_animated(Target &backend, Command command,
+                              const Arguments &args, std::true_type);
+
+  template <typename Target>
+  static void replay_animated(Target &backend, Command command,
+                              const Arguments &args, std::false_type);
+
+public:
+  BackendRecorder() = default;
+
+  TRASE_BACKEND_VISITABLE()
+  TRASE_ANIMATED_BACKEND_VISITABLE()
+
+  /// Replay the recorded commands into @p backend, in order
+  ///
+  /// Backends that do not support animation (i.e. that are not derived from
+  /// AnimatedBackend) draw the mouseover colors as plain colors and skip the
+  /// tooltips, but cannot replay animated paths and shapes.
+  ///
+  /// @param backend the backend to draw with
+  template <typename Target> void replay(Target &backend) const;
+
+  /// returns the recorded commands, in order
+  std::vector<Command> commands() const;
+
+  /// returns the number of commands recorded
+  std::size_t size() const { return m_size; }
+
+  /// returns the size of the recorded commands and their arguments in bytes,
+  /// not including the string and color tables
+  std::size_t bytes() const { return m_buffer.size(); }
+
+  /// returns the interned strings (the figure name, fonts and text)
+  const std::vector<std::string> &strings() const { return m_strings; }
+
+  /// returns the interned colors
+  const std::vector<RGBA> &colors() const { return m_colors; }
+
+  /// removes all recorded commands
+  void clear();
+
+  /// Write the recording to @p out in a binary format, in the byte order of
+  /// this machine
+  void save(std::ostream &out) const;
+
+  /// Replace the recording with one read from @p in, as written by save()
+  ///
+  /// Throws an Exception if @p in does not hold a valid recording, in which
+  /// case the recording is unchanged
+  void load(std::istream &in);
+
+  /// Initialise the recording. The recorder does not remove any previous
+  /// commands, so several figures can be recorded in turn
+  ///
+  /// @param pixels the image resolution in pixels
+  /// @param name the name of the image
+  /// @param time_span the total time span of the animation
+  void init(const vfloat2_t &pixels, const char *name, float time_span = 0.f);
+
+  void finalise();
+
+  // a recording is not interactive, so these do nothing
+  bool is_interactive() { return false; }
+  bool should_close() { return true; }
+  vfloat2_t begin_frame() { return vfloat2_t(); }
+  void end_frame() {}
+  vfloat2_t get_mouse_pos() { return vfloat2_t(0, 0); }
+  float get_time() { return 0.f; }
+  static void set_mouse_down(const vfloat2_t &mouse_pos) {}
+  static void set_mouse_up() {}
+  bool mouse_dragging() { return false; }
+  vfloat2_t mouse_drag_delta() { return vfloat2_t(); }
+  void mouse_drag_reset_delta() {}
+  float mouse_scroll_delta() { return 0.f; }
+  void mouse_scroll_reset_delta() {}
+
+  void scissor(const bfloat2_t &x);
+  void reset_scissor();
+  void rotate(float angle);
+  void reset_transform();
+  void translate(const vfloat2_t &v);
+
+  void begin_path();
+  void move_to(const vfloat2_t &x);
+  void line_to(const vfloat2_t &x);
+  void polyline(int n, const float *x, const float *y, int stride = 1);
+  void stroke();
+  void fill();
+
+  void begin_animated_path();
+  void add_animated_path(float time);
+  void end_animated_path(float time);
+
+  void rounded_rect(const bfloat2_t &x, float r);
+  void rect(const bfloat2_t &x, float r = 0.f);
+  void rects(int n, const float *xmin, const float *ymin, const float *xmax,
+             const float *ymax, const RGBA *stroke = nullptr,
+             const RGBA *fill = nullptr);
+  void add_animated_rect(const bfloat2_t &x, float time);
+  void add_animated_stroke(const RGBA &color);
+  void add_animated_fill(const RGBA &color);
+  void end_animated_rect();
+
+  void circle(const vfloat2_t &centre, float r);
+  void circles(int n, const float *x, const float *y, const float *r,
+               const RGBA *fill = nullptr);
+  void add_animated_circle(const vfloat2_t &centre, float radius, float time);
+  void end_animated_circle();
+
+  void stroke_color(const RGBA &color);
+  void stroke_color(const RGBA &color, const RGBA &color_mouseover);
+  void fill_color(const RGBA &color);
+  void fill_color(const RGBA &color, const RGBA &color_mouseover);
+  void tooltip(const vfloat2_t &x, const char *string);
+  void clear_tooltip();
+  void stroke_width(float lw);
+
+  void font_size(float size);
+  void font_face(const char *face);
+  void font_blur(float blur);
+  void text_align(unsigned int align);
+  void text(const vfloat2_t &x, const char *string, const char *end);
+};
+
+template <typename Target>
+void BackendRecorder::replay(Target &backend) const {
+  using animated = typename std::is_base_of<AnimatedBackend, Target>::type;
+  Arguments args;
+  std::size_t offset = 0;
+  while (offset < m_buffer.size()) {
+    const Command command = next(offset, args);
+    switch (command) {
+    case Command::finalise:
+      backend.finalise();
+      break;
+    case Command::scissor:
+      backend.scissor(args.box);
+      break;
+    case Command::reset_scissor:
+      backend.reset_scissor();
+      break;
+    case Command::rotate:
+      backend.rotate(args.value);
+      break;
+    case Command::reset_transform:
+      backend.reset_transform();
+      break;
+    case Command::translate:
+      backend.translate(args.point);
+      break;
+    case Command::begin_path:
+      backend.begin_path();
+      break;
+    case Command::move_to:
+      backend.move_to(args.point);
+      break;
+    case Command::line_to:
+      backend.line_to(args.point);
+      break;
+    case Command::polyline:
+      backend.polyline(args.n, args.arrays[0].data(), args.arrays[1].data());
+      break;
+    case Command::stroke:
+      backend.stroke();
+      break;
+    case Command::fill:
+      backend.fill();
+      break;
+    case Command::rounded_rect:
+      backend.rounded_rect(args.box, args.value);
+      break;
+    case Command::rect:
+      backend.rect(args.box);
+      break;
+    case Command::rects:
+      backend.rects(args.n, args.arrays[0].data(), args.arrays[1].data(),
+                    args.arrays[2].data(), args.arrays[3].data(),
+                    args.strokes.empty() ? nullptr : args.strokes.data(),
+                    args.fills.empty() ? nullptr : args.fills.data());
+      break;
+    case Command::circle:
+      backend.circle(args.point, args.value);
+      break;
+    case Command::circles:
+      backend.circles(args.n, args.arrays[0].data(), args.arrays[1].data(),
+                      args.arrays[2].data(),
+                      args.fills.empty() ? nullptr : args.fills.data());
+      break;
+    case Command::stroke_color:
+      backend.stroke_color(args.color);
+      break;
+    case Command::fill_color:
+      backend.fill_color(args.color);
+      break;
+    case Command::stroke_width:
+      backend.stroke_width(args.value);
+      break;
+    case Command::font_size:
+      backend.font_size(args.value);
+      break;
+    case Command::font_face:
+      backend.font_face(args.string->c_str());
+      break;
+    case Command::font_blur:
+      backend.font_blur(args.value);
+      break;
+    case Command::text_align:
+      backend.text_align(args.align);
+      break;
+    case Command::text:
+      backend.text(args.point, args.string->c_str(), nullptr);
+      break;
+    default:
+      replay_animated(backend, command, args, animated());
+      break;
+    }
+  }
+}
+
+template <typename Target>
+void BackendRecorder::replay_animated(Target &backend, const Command command,
+                                      const Arguments &args, std::true_type) {
+  switch (command) {
+  case Command::init:
+    backend.init(args.point, args.string->c_str(), args.time);
+    break;
+  case Command::begin_animated_path:
+    backend.begin_animated_path();
+    break;
+  case Command::add_animated_path:
+    backend.add_animated_path(args.time);
+    break;
+  case Command::end_animated_path:
+    backend.end_animated_path(args.time);
+    break;
+  case Command::add_animated_rect:
+    backend.add_animated_rect(args.box, args.time);
+    break;
+  case Command::add_animated_stroke:
+    backend.add_animated_stroke(args.color);
+    break;
+  case Command::add_animated_fill:
+    backend.add_animated_fill(args.color);
+    break;
+  case Command::end_animated_rect:
+    backend.end_animated_rect();
+    break;
+  case Command::add_animated_circle:
+    backend.add_animated_circle(args.point, args.value, args.time);
+    break;
+  case Command::end_animated_circle:
+    backend.end_animated_circle();
+    break;
+  case Command::stroke_color_mouseover:
+    backend.stroke_color(args.color, args.color_mouseover);
+    break;
+  case Command::fill_color_mouseover:
+    backend.fill_color(args.color, args.color_mouseover);
+    break;
+  case Command::tooltip:
+    backend.tooltip(args.point, args.string->c_str());
+    break;
+  case Command::clear_tooltip:
+    backend.clear_tooltip();
+    break;
+  default:
+    break;
+  }
+}
+
+template <typename Target>
+void BackendRecorder::replay_animated(Target &backend, const Command command,
+                                      const Arguments &args, std::false_type) {
+  switch (command) {
+  case Command::init:
+    backend.init(args.point, args.string->c_str());
+    break;
+  case Command::stroke_color_mouseover:
+    backend.stroke_color(args.color);
+    break;
+  case Command::fill_color_mouseover:
+    backend.fill_color(args.color);
+    break;
+  case Command::tooltip:
+  case Command::clear_tooltip:
+    break;
+  default:
+    throw Exception("BackendRecorder: cannot replay an animation into a "
+                    "backend that does not support animation");
+  }
+}
+
+} // namespace trase
+
+#endif // BACKENDRECORDER_H_
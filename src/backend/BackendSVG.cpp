@@ -33,8 +33,95 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "backend/BackendSVG.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
 namespace trase {
 
+namespace {
+
+/// copies the string @p string to @p out, returning the end of the output
+char *write_string(char *out, const char *string) {
+  const std::size_t length = std::strlen(string);
+  std::memcpy(out, string, length);
+  return out + length;
+}
+
+/// writes @p value to @p out as std::to_string() does (printf's "%f", six
+/// decimal places), as move_to() and line_to() write path coordinates,
+/// returning the end of the output. This is much faster than formatting with
+/// printf, for the bulk drawing calls
+char *write_fixed(char *out, const float value) {
+  // a float has 24 significant bits, so the scaled value is exact in a
+  // double and rounding it to nearest (ties to even, as printf does) gives
+  // the same digits
+  const double scaled = std::nearbyint(std::abs(double(value)) * 1e6);
+  if (!(scaled < 1e15)) {
+    // not finite, or too large for the integer conversion
+    return out + std::sprintf(out, "%f", value);
+  }
+  if (std::signbit(value)) {
+    *out++ = '-';
+  }
+  auto micros = static_cast<unsigned long long>(scaled);
+  const auto fraction = static_cast<int>(micros % 1000000);
+  unsigned long long integer = micros / 1000000;
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = static_cast<char>('0' + integer % 10);
+    integer /= 10;
+  } while (integer != 0);
+  while (count > 0) {
+    *out++ = digits[--count];
+  }
+  *out++ = '.';
+  for (int divisor = 100000, rest = fraction; divisor > 0; divisor /= 10) {
+    *out++ = static_cast<char>('0' + rest / divisor);
+    rest %= divisor;
+  }
+  return out;
+}
+
+/// writes @p value to @p out with four significant digits, as the
+/// AttributeFormatter writes the attributes of circle() and rect(),
+/// returning the end of the output
+char *write_general(char *out, const float value) {
+  return out + std::sprintf(out, "%.4g", value);
+}
+
+/// writes ' name="#rrggbb" name-opacity="a"' for @p color to @p out, as
+/// fill_color() and stroke_color() do, returning the end of the output
+char *write_color(char *out, const char *name, const RGBA &color) {
+  static const char hex[] = "0123456789abcdef";
+  static const std::array<std::string, 256> opacities = [] {
+    std::array<std::string, 256> result;
+    for (int i = 0; i < 256; ++i) {
+      result[i] = std::to_string(i / 255.0);
+    }
+    return result;
+  }();
+  *out++ = ' ';
+  out = write_string(out, name);
+  out = write_string(out, "=\"#");
+  for (const int channel : {color.r(), color.g(), color.b()}) {
+    *out++ = hex[(channel >> 4) & 15];
+    *out++ = hex[channel & 15];
+  }
+  out = write_string(out, "\" ");
+  out = write_string(out, name);
+  out = write_string(out, "-opacity=\"");
+  out = write_string(out, opacities[color.a() & 255].c_str());
+  *out++ = '"';
+  return out;
+}
+
+} // namespace
+
 BackendSVG::BackendSVG(std::ostream &out) : m_out(out) {
   stroke_color({0, 0, 0, 255});
   fill_color({0, 0, 0, 255});
@@ -49,6 +136,8 @@ bool BackendSVG::mouseover() const noexcept {
 void BackendSVG::init(const vfloat2_t &pixels, const char *name,
                       const float time_span) noexcept {
   m_time_span = time_span;
+  m_clip_count = 0;
+  m_clipping = false;
   m_out << R"del(<?xml version="1.0" encoding="utf-8" standalone="no"?>
 <!DOCTYPE svg PUBLIC "-//W3C//DTD SVG 1.1//EN"
   "http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd">
@@ -105,19 +194,138 @@ vfloat2_t BackendSVG::mouse_drag_delta() { return vfloat2_t(); }
 
 void BackendSVG::mouse_drag_reset_delta() {}
 
-void BackendSVG::scissor(const bfloat2_t &x) {}
+float BackendSVG::mouse_scroll_delta() { return 0.f; }
+
+void BackendSVG::mouse_scroll_reset_delta() {}
 
-void BackendSVG::reset_scissor() {}
+void BackendSVG::scissor(const bfloat2_t &x) {
+  reset_scissor();
+  const vfloat2_t delta = x.delta();
+  m_out << "<clipPath id=\"clip" << m_clip_count << "\">\n<rect "
+        << m_att("x", x.bmin[0]) << m_att("y", x.bmin[1])
+        << m_att("width", delta[0]) << m_att("height", delta[1])
+        << "/>\n</clipPath>\n";
+  m_out << "<g clip-path=\"url(#clip" << m_clip_count << ")\">\n";
+  ++m_clip_count;
+  m_clipping = true;
+}
+
+void BackendSVG::reset_scissor() {
+  if (m_clipping) {
+    m_out << "</g>\n";
+    m_clipping = false;
+  }
+}
 
 void BackendSVG::rotate(const float angle) { m_transform.rotate(angle); }
 void BackendSVG::reset_transform() { m_transform.clear(); }
 void BackendSVG::translate(const vfloat2_t &v) { m_transform.translate(v); }
 
 void BackendSVG::finalise() noexcept {
+  reset_scissor();
   m_out << "</svg>\n";
   m_out.flush();
 }
 
+bool SVGState::operator==(const SVGState &other) const {
+  return linewidth == other.linewidth && line_color == other.line_color &&
+         fill_color == other.fill_color && font_face == other.font_face &&
+         font_size == other.font_size && font_align == other.font_align &&
+         font_size_base == other.font_size_base &&
+         font_face_base == other.font_face_base &&
+         onmouseover_stroke == other.onmouseover_stroke &&
+         onmouseout_stroke == other.onmouseout_stroke &&
+         onmouseover_fill == other.onmouseover_fill &&
+         onmouseout_fill == other.onmouseout_fill &&
+         onmouseover_tooltip == other.onmouseover_tooltip &&
+         onmouseout_tooltip == other.onmouseout_tooltip &&
+         transform == other.transform && time_span == other.time_span &&
+         clip_count == other.clip_count && clipping == other.clipping;
+}
+
+SVGState BackendSVG::state() const {
+  SVGState state;
+  state.linewidth = m_linewidth;
+  state.line_color = m_line_color;
+  state.fill_color = m_fill_color;
+  state.font_face = m_font_face;
+  state.font_size = m_font_size;
+  state.font_align = m_font_align;
+  state.font_size_base = m_font_size_base;
+  state.font_face_base = m_font_face_base;
+  state.onmouseover_stroke = m_onmouseover_stroke;
+  state.onmouseout_stroke = m_onmouseout_stroke;
+  state.onmouseover_fill = m_onmouseover_fill;
+  state.onmouseout_fill = m_onmouseout_fill;
+  state.onmouseover_tooltip = m_onmouseover_tooltip;
+  state.onmouseout_tooltip = m_onmouseout_tooltip;
+  state.transform = m_transform;
+  state.time_span = m_time_span;
+  state.clip_count = m_clip_count;
+  state.clipping = m_clipping;
+  return state;
+}
+
+void BackendSVG::set_state(const SVGState &state) {
+  m_linewidth = state.linewidth;
+  m_line_color = state.line_color;
+  m_fill_color = state.fill_color;
+  m_font_face = state.font_face;
+  m_font_size = state.font_size;
+  m_font_align = state.font_align;
+  m_font_size_base = state.font_size_base;
+  m_font_face_base = state.font_face_base;
+  m_onmouseover_stroke = state.onmouseover_stroke;
+  m_onmouseout_stroke = state.onmouseout_stroke;
+  m_onmouseover_fill = state.onmouseover_fill;
+  m_onmouseout_fill = state.onmouseout_fill;
+  m_onmouseover_tooltip = state.onmouseover_tooltip;
+  m_onmouseout_tooltip = state.onmouseout_tooltip;
+  m_transform = state.transform;
+  m_time_span = state.time_span;
+  m_clip_count = state.clip_count;
+  m_clipping = state.clipping;
+}
+
+void BackendSVG::begin_fragment() {
+  if (m_recorded_buf != nullptr) {
+    throw Exception("BackendSVG fragments cannot be nested");
+  }
+  m_recording_state = state();
+  m_recording.str("");
+  m_recorded_buf = m_out.rdbuf(&m_recording);
+}
+
+std::shared_ptr<const SVGFragment> BackendSVG::end_fragment() {
+  if (m_recorded_buf == nullptr) {
+    throw Exception("BackendSVG::end_fragment called without begin_fragment");
+  }
+  m_out.rdbuf(m_recorded_buf);
+  m_recorded_buf = nullptr;
+
+  auto fragment = std::make_shared<SVGFragment>();
+  fragment->svg = m_recording.str();
+  fragment->before = std::move(m_recording_state);
+  fragment->after = state();
+  m_out << fragment->svg;
+  return fragment;
+}
+
+bool BackendSVG::replay(
+    const std::vector<std::shared_ptr<const SVGFragment>> &fragments) {
+  if (fragments.empty()) {
+    return true;
+  }
+  if (fragments.front()->before != state()) {
+    return false;
+  }
+  for (const auto &fragment : fragments) {
+    m_out << fragment->svg;
+  }
+  set_state(fragments.back()->after);
+  return true;
+}
+
 void BackendSVG::begin_animated_path() {
   if (m_animate_values.empty()) {
     m_animate_values.resize(1);
@@ -224,6 +432,17 @@ void BackendSVG::move_to(const vfloat2_t &x) {
 void BackendSVG::line_to(const vfloat2_t &x) {
   m_path += " L " + std::to_string(x[0]) + ' ' + std::to_string(x[1]);
 }
+void BackendSVG::polyline(const int n, const float *x, const float *y,
+                          const int stride) {
+  char buffer[128];
+  for (int i = 0; i < n; ++i) {
+    char *out = write_string(buffer, i == 0 ? " M " : " L ");
+    out = write_fixed(out, x[i * stride]);
+    *out++ = ' ';
+    out = write_fixed(out, y[i * stride]);
+    m_path.append(buffer, out - buffer);
+  }
+}
 void BackendSVG::close_path() { m_path += " Z"; }
 
 void BackendSVG::stroke_color(const RGBA &color) {
@@ -483,4 +702,85 @@ void BackendSVG::circle(const vfloat2_t &centre, float r) noexcept {
   circle_end();
 }
 
+void BackendSVG::circles(const int n, const float *x, const float *y,
+                         const float *r, const RGBA *fill) {
+  if (mouseover()) {
+    // event handlers are written per circle
+    const std::string current_fill = m_fill_color;
+    for (int i = 0; i < n; ++i) {
+      if (fill) {
+        fill_color(fill[i]);
+      }
+      circle({x[i], y[i]}, r[i]);
+    }
+    m_fill_color = current_fill;
+    return;
+  }
+
+  m_out << "<g " << (fill ? "" : m_fill_color) << ' ' << m_line_color << ' '
+        << m_linewidth << ">\n";
+  char buffer[256];
+  for (int i = 0; i < n; ++i) {
+    char *out = write_string(buffer, "<circle cx=\"");
+    out = write_general(out, x[i]);
+    out = write_string(out, "\" cy=\"");
+    out = write_general(out, y[i]);
+    out = write_string(out, "\" r=\"");
+    out = write_general(out, r[i]);
+    *out++ = '"';
+    if (fill) {
+      out = write_color(out, "fill", fill[i]);
+    }
+    out = write_string(out, "/>\n");
+    m_out.write(buffer, out - buffer);
+  }
+  m_out << "</g>\n";
+}
+
+void BackendSVG::rects(const int n, const float *xmin, const float *ymin,
+                       const float *xmax, const float *ymax,
+                       const RGBA *stroke, const RGBA *fill) {
+  if (mouseover()) {
+    // event handlers are written per rectangle
+    const std::string current_stroke = m_line_color;
+    const std::string current_fill = m_fill_color;
+    for (int i = 0; i < n; ++i) {
+      if (stroke) {
+        stroke_color(stroke[i]);
+      }
+      if (fill) {
+        fill_color(fill[i]);
+      }
+      rect(bfloat2_t({xmin[i], ymin[i]}, {xmax[i], ymax[i]}));
+    }
+    m_line_color = current_stroke;
+    m_fill_color = current_fill;
+    return;
+  }
+
+  m_out << "<g " << (fill ? "" : m_fill_color) << ' '
+        << (stroke ? "" : m_line_color) << ' ' << m_linewidth << ">\n";
+  char buffer[320];
+  for (int i = 0; i < n; ++i) {
+    char *out = write_string(buffer, "<rect x=\"");
+    out = write_general(out, std::min(xmin[i], xmax[i]));
+    out = write_string(out, "\" y=\"");
+    out = write_general(out, std::min(ymin[i], ymax[i]));
+    out = write_string(out, "\" width=\"");
+    out = write_general(out, std::abs(xmax[i] - xmin[i]));
+    out = write_string(out, "\" height=\"");
+    out = write_general(out, std::abs(ymax[i] - ymin[i]));
+    *out++ = '"';
+    if (fill) {
+      out = write_color(out, "fill", fill[i]);
+    }
+    if (stroke) {
+      out = write_color(out, "stroke", stroke[i]);
+    }
+    out = write_string(out, "/>\n");
+    m_out.write(buffer, out - buffer);
+  }
+  m_out << "</g>\n";
+}
+
 } // namespace trase
@@ -43,8 +43,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "util/Vector.hpp"
 
 #include <iomanip>
+#include <memory>
 #include <ostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 namespace trase {
 
@@ -70,6 +73,48 @@ public:
   }
 };
 
+/// The drawing state of a BackendSVG that carries over from one drawing call
+/// to the next (styles, transform, mouseover handlers and clipping)
+///
+/// Paths and animations are begun and ended within a single Drawable, so
+/// are not included
+struct SVGState {
+  std::string linewidth;
+  std::string line_color;
+  std::string fill_color;
+  std::string font_face;
+  std::string font_size;
+  std::string font_align;
+  std::string font_size_base;
+  std::string font_face_base;
+  std::string onmouseover_stroke;
+  std::string onmouseout_stroke;
+  std::string onmouseover_fill;
+  std::string onmouseout_fill;
+  std::string onmouseover_tooltip;
+  std::string onmouseout_tooltip;
+  TransformMatrix transform;
+  float time_span{0.f};
+  int clip_count{0};
+  bool clipping{false};
+
+  bool operator==(const SVGState &other) const;
+  bool operator!=(const SVGState &other) const { return !(*this == other); }
+};
+
+/// The output of part of a drawing, recorded by BackendSVG::end_fragment()
+/// so that it can be written again by BackendSVG::replay() without redrawing
+struct SVGFragment {
+  /// the svg written
+  std::string svg;
+
+  /// the state of the backend before the svg was written
+  SVGState before;
+
+  /// the state of the backend after the svg was written
+  SVGState after;
+};
+
 class BackendSVG : public AnimatedBackend {
   /// the output file stream that the svg is written to
   std::ostream &m_out;
@@ -94,12 +139,28 @@ class BackendSVG : public AnimatedBackend {
   std::string m_animate_fill;
   std::string m_animate_fill_opacity;
   std::string m_animate_times;
-  float m_time_span;
+  float m_time_span{0.f};
   std::string m_font_size_base;
   std::string m_font_face_base;
   TransformMatrix m_transform;
   AttributeFormatter m_att;
 
+  /// the number of clip paths written, used to give each a unique id
+  int m_clip_count{0};
+
+  /// true if a group clipped by scissor() is open
+  bool m_clipping{false};
+
+  /// output written while recording a fragment (see begin_fragment())
+  std::stringbuf m_recording;
+
+  /// the buffer of m_out while recording a fragment, or null if not
+  /// recording
+  std::streambuf *m_recorded_buf{nullptr};
+
+  /// the state when the current fragment was begun
+  SVGState m_recording_state;
+
   /// Add the opening circle tag to m_out
   /// @param centre coordinates of the centre of the circle
   /// @param r radius of the circle
@@ -121,6 +182,12 @@ class BackendSVG : public AnimatedBackend {
   /// set
   bool mouseover() const noexcept;
 
+  /// returns the current drawing state
+  SVGState state() const;
+
+  /// restores the drawing state @p state
+  void set_state(const SVGState &state);
+
 public:
   /// create a new backend which will write out an animated SVG to the output
   /// stream @p out
@@ -144,6 +211,25 @@ public:
   /// This function must be called after all drawing is complete
   void finalise() noexcept;
 
+  /// Start recording the output of subsequent drawing calls, which is still
+  /// written to the output stream. Fragments cannot be nested
+  ///
+  /// @see end_fragment()
+  void begin_fragment();
+
+  /// Stop recording output and return the fragment recorded since the call
+  /// to begin_fragment()
+  std::shared_ptr<const SVGFragment> end_fragment();
+
+  /// Write the fragments @p fragments again, in order, and restore the
+  /// drawing state that followed the last of them, as if the drawing calls
+  /// that recorded them were repeated
+  ///
+  /// @return false, without writing anything, if the current drawing state
+  /// differs from the state the first fragment was recorded in (the output
+  /// could then differ)
+  bool replay(const std::vector<std::shared_ptr<const SVGFragment>> &fragments);
+
   /// returns false
   bool is_interactive();
 
@@ -177,7 +263,16 @@ public:
   /// not used (only used for interactive backends)
   void mouse_drag_reset_delta();
 
+  /// not used (only used for interactive backends)
+  float mouse_scroll_delta();
+
+  /// not used (only used for interactive backends)
+  void mouse_scroll_reset_delta();
+
   /// all subsequent drawing calls will be cut to within this box
+  ///
+  /// The box is written as a clipPath, and the following elements are put in
+  /// a group clipped by it until reset_scissor() or the next scissor()
   void scissor(const bfloat2_t &x);
 
   /// resets any previous calls to @ref scissor()
@@ -209,6 +304,15 @@ public:
   /// @see begin_path()
   void line_to(const vfloat2_t &x);
 
+  /// add a polyline of @p n points to the path, moving the "pen" to the
+  /// first point and drawing lines to the rest. Point i is (@p x[i * @p
+  /// stride], @p y[i * @p stride]), so that interleaved coordinates can be
+  /// passed with a stride of 2. The path is the same as that given by
+  /// move_to() and line_to()
+  ///
+  /// @see begin_path()
+  void polyline(int n, const float *x, const float *y, int stride = 1);
+
   /// draw a line to the first point of the path
   ///
   /// @see begin_path()
@@ -256,6 +360,23 @@ public:
   /// @param r the radius of the circle used to round the corners, default 0.f
   void rect(const bfloat2_t &x, float r = 0.f) noexcept;
 
+  /// draw @p n rectangles, rectangle i having opposite corners (@p xmin[i],
+  /// @p ymin[i]) and (@p xmax[i], @p ymax[i])
+  ///
+  /// Gives the same result as calling stroke_color(), fill_color() and rect()
+  /// for each (with the numbers written to the same precision), but the
+  /// shared styling is written once for the group and each rectangle is
+  /// written in a tight loop. Mouseover styling and tooltips are still
+  /// written per rectangle. The current colors are not changed
+  ///
+  /// @param stroke the stroke color of each rectangle, or nullptr to use the
+  /// current stroke color
+  /// @param fill the fill color of each rectangle, or nullptr to use the
+  /// current fill color
+  void rects(int n, const float *xmin, const float *ymin, const float *xmax,
+             const float *ymax, const RGBA *stroke = nullptr,
+             const RGBA *fill = nullptr);
+
   /// start/continue an animated rectangle.
   /// subsequent calls to this method will add extra keyframe to the animation.
   ///
@@ -291,6 +412,20 @@ public:
   /// @param r the radius of the circle
   void circle(const vfloat2_t &centre, float r) noexcept;
 
+  /// draw @p n circles, circle i centred at (@p x[i], @p y[i]) with radius
+  /// @p r[i]
+  ///
+  /// Gives the same result as calling fill_color() and circle() for each
+  /// (with the numbers written to the same precision), but the shared styling
+  /// is written once for the group and each circle is written in a tight
+  /// loop. Mouseover styling and tooltips are still written per circle. The
+  /// current colors are not changed
+  ///
+  /// @param fill the fill color of each circle, or nullptr to use the current
+  /// fill color
+  void circles(int n, const float *x, const float *y, const float *r,
+               const RGBA *fill = nullptr);
+
   /// start/continue an animated circle
   /// subsequent calls to this method will add extra keyframe to the animation.
   ///
@@ -50,6 +50,28 @@ std::shared_ptr<Geometry> Axis::plot(int n) {
   return std::dynamic_pointer_cast<Geometry>(m_children.at(n));
 }
 
+void Axis::update_view() {
+  mark_subtree_dirty();
+  for (const auto &child : m_children) {
+    if (auto geometry = std::dynamic_pointer_cast<Geometry>(child)) {
+      geometry->set_view(m_limits);
+    }
+  }
+}
+
+Pick Axis::pick(const vfloat2_t &pixel, const float max_distance) const {
+  Pick result;
+  for (const auto &child : m_children) {
+    if (auto geometry = std::dynamic_pointer_cast<Geometry>(child)) {
+      const Pick picked = geometry->pick(pixel, max_distance);
+      if (picked && picked.distance < result.distance) {
+        result = picked;
+      }
+    }
+  }
+  return result;
+}
+
 std::shared_ptr<Geometry> Axis::plot_impl(const std::shared_ptr<Geometry> &plot,
                                           const Transform &transform,
                                           const DataWithAesthetic &values) {
@@ -58,6 +80,7 @@ std::shared_ptr<Geometry> Axis::plot_impl(const std::shared_ptr<Geometry> &plot,
 
   plot->style().color(RGBA::defaults[m_children.size()]);
   m_children.push_back(plot);
+  mark_dirty();
   add_geometry_to_legend(plot);
   return plot;
 }
@@ -176,6 +199,7 @@ std::shared_ptr<Legend> Axis::add_legend() {
     }
   }
   m_children.push_back(new_legend);
+  mark_dirty();
   m_has_legend = true;
   return new_legend;
 }
@@ -110,6 +110,9 @@ class Axis : public Drawable {
   /// tick helper
   TickInfo m_tick_info;
 
+  /// the version of this axis that m_tick_info was calculated for
+  std::size_t m_tick_version{0};
+
   /// true if axis has a Legend
   bool m_has_legend;
 
@@ -127,29 +130,49 @@ public:
   /// returns the current Aesthetic limits
   const Limits &limits() const { return m_limits; }
 
-  /// returns the current Aesthetic limits, allowing them to be set manually
-  Limits &limits() { return m_limits; }
+  /// set the Aesthetic limits
+  void set_limits(const Limits &limits) {
+    m_limits = limits;
+    mark_subtree_dirty();
+  }
+
+  /// extend the Aesthetic limits to include @p limits
+  void extend_limits(const Limits &limits) {
+    m_limits += limits;
+    mark_subtree_dirty();
+  }
 
   /// a helper function to set the x Aesthetic limits manually
   void xlim(std::array<float, 2> xlimits) {
     m_limits.bmin[Aesthetic::x::index] = xlimits[0];
     m_limits.bmax[Aesthetic::x::index] = xlimits[1];
+    mark_subtree_dirty();
   }
 
   /// a helper function to set the y Aesthetic limits manually
   void ylim(std::array<float, 2> ylimits) {
     m_limits.bmin[Aesthetic::y::index] = ylimits[0];
     m_limits.bmax[Aesthetic::y::index] = ylimits[1];
+    mark_subtree_dirty();
   }
 
   /// set the label on the x axis
-  void xlabel(const char *string) { m_xlabel.assign(string); }
+  void xlabel(const char *string) {
+    m_xlabel.assign(string);
+    mark_dirty();
+  }
 
   /// set the label on the y axis
-  void ylabel(const char *string) { m_ylabel.assign(string); }
+  void ylabel(const char *string) {
+    m_ylabel.assign(string);
+    mark_dirty();
+  }
 
   /// set the title of the Axis
-  void title(const char *string) { m_title.assign(string); }
+  void title(const char *string) {
+    m_title.assign(string);
+    mark_dirty();
+  }
 
   /// show a legend identifying each Geometry in the Axis
   std::shared_ptr<Legend> legend();
@@ -192,6 +215,19 @@ public:
   /// \return a shared pointer to the nth plot
   std::shared_ptr<Geometry> plot(int n);
 
+  /// Informs each plot that the limits of the axis have been changed
+  /// interactively, see Geometry::set_view
+  void update_view();
+
+  /// Returns the plot and row nearest to a point on the display, searching
+  /// each plot at the time it was last drawn (see Geometry::pick)
+  /// \param pixel the point in display coordinates
+  /// \param max_distance only rows within this distance (in pixels) of the
+  /// point are picked
+  /// \return the plot and row picked, which converts to false if there is
+  /// none in range
+  Pick pick(const vfloat2_t &pixel, float max_distance = 5.f) const;
+
   template <typename AnimatedBackend> void draw(AnimatedBackend &backend);
   template <typename Backend> void draw(Backend &backend, float time);
 
@@ -214,6 +250,7 @@ public:
   void set_ticks(Vector<int, 2> arg) {
     m_nx_ticks = arg[0];
     m_ny_ticks = arg[1];
+    mark_dirty();
   }
 
   /// gets the number of ticks on this axis
@@ -42,19 +42,26 @@ namespace trase {
 
 template <typename Backend>
 void Axis::draw(Backend &backend, const float time) {
+  // the scissor of a previous axis must not cut this axis' decorations
+  backend.reset_scissor();
   draw_common(backend);
   // make sure all child elements are cut to the axis pixel limits
   backend.scissor(m_pixels);
 }
 
 template <typename AnimatedBackend> void Axis::draw(AnimatedBackend &backend) {
+  // the scissor of a previous axis must not cut this axis' decorations
+  backend.reset_scissor();
   draw_common(backend);
   // make sure all child elements are cut to the axis pixel limits
   backend.scissor(m_pixels);
 }
 
 template <typename Backend> void Axis::draw_common(Backend &backend) {
-  update_tick_information();
+  if (m_tick_version != m_version) {
+    update_tick_information();
+    m_tick_version = m_version;
+  }
 
   draw_common_axis_box(backend);
   draw_common_ticks(backend);
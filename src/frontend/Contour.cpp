@@ -0,0 +1,404 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frontend/Contour.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "frontend/Axis.hpp"
+#include "util/Exception.hpp"
+#include "util/Parallel.hpp"
+#include "util/Simplify.hpp"
+
+namespace trase {
+
+Contour::Contour(std::vector<float> levels) : m_levels(std::move(levels)) {
+  value<Aesthetic::fill>();
+}
+
+Contour::Contour(const int number_of_levels)
+    : m_number_of_levels(number_of_levels) {
+  value<Aesthetic::fill>();
+}
+
+Contour::Contour(std::vector<float> levels, const int nx, const int ny,
+                 const bfloat2_t &span)
+    : m_levels(std::move(levels)), m_nx(nx), m_ny(ny), m_span(span) {
+  if (nx < 2 || ny < 2) {
+    throw Exception("Contour grid requires at least 2 nodes in each "
+                    "direction");
+  }
+  value<Aesthetic::fill>();
+}
+
+Contour &Contour::tolerance(const float x, const float y) {
+  m_tolerance = vfloat2_t{x, y};
+  return *this;
+}
+
+Contour &Contour::tolerance(const Axis &axis, const float pixels) {
+  const auto &limits = axis.limits();
+  const vfloat2_t size = axis.pixels().delta();
+  const float dx = limits.bmax[Aesthetic::x::index] -
+                   limits.bmin[Aesthetic::x::index];
+  const float dy = limits.bmax[Aesthetic::y::index] -
+                   limits.bmin[Aesthetic::y::index];
+  return tolerance(size[0] > 0 ? pixels * std::abs(dx) / size[0] : 0.f,
+                   size[1] > 0 ? pixels * std::abs(dy) / size[1] : 0.f);
+}
+
+namespace {
+
+/// number of rows of cells in each band processed in parallel
+const int contour_band_rows = 64;
+
+/// a polyline, given by the ids of the grid edges it crosses in order. The
+/// id of the edge from node k to node k + 1 is 2k, and from node k to node
+/// k + nx is 2k + 1. A closed polyline repeats its first id at the end
+using Chain = std::vector<std::int64_t>;
+
+/// a single segment of a contour line within a cell
+using Segment = std::pair<std::int64_t, std::int64_t>;
+
+std::int64_t front(const Segment &segment) { return segment.first; }
+std::int64_t back(const Segment &segment) { return segment.second; }
+std::int64_t front(const Chain &chain) { return chain.front(); }
+std::int64_t back(const Chain &chain) { return chain.back(); }
+
+/// appends @p segment to @p chain, which ends at one end of the segment
+void append(Chain &chain, const Segment &segment) {
+  chain.push_back(segment.first == chain.back() ? segment.second
+                                                : segment.first);
+}
+
+/// appends @p piece to @p chain, which ends at one end of the piece
+void append(Chain &chain, const Chain &piece) {
+  if (piece.front() == chain.back()) {
+    chain.insert(chain.end(), piece.begin() + 1, piece.end());
+  } else {
+    chain.insert(chain.end(), piece.rbegin() + 1, piece.rend());
+  }
+}
+
+Chain to_chain(const Segment &segment) {
+  return {segment.first, segment.second};
+}
+Chain to_chain(Chain &&chain) { return std::move(chain); }
+
+/// joins the @p pieces (segments or chains) that share an end into the
+/// longest possible chains. Each edge is shared by at most two pieces, as it
+/// borders at most two cells
+template <typename Piece> std::vector<Chain> stitch(std::vector<Piece> pieces) {
+  const int n = static_cast<int>(pieces.size());
+  std::vector<char> used(n, 0);
+  std::unordered_map<std::int64_t, std::array<int, 2>> ends;
+  ends.reserve(2 * n);
+  auto add_end = [&](const std::int64_t id, const int piece) {
+    auto &end = ends.emplace(id, std::array<int, 2>{{-1, -1}}).first->second;
+    end[end[0] < 0 ? 0 : 1] = piece;
+  };
+  for (int i = 0; i < n; ++i) {
+    if (front(pieces[i]) != back(pieces[i])) {
+      add_end(front(pieces[i]), i);
+      add_end(back(pieces[i]), i);
+    }
+  }
+  auto next_piece = [&](const std::int64_t id) {
+    const auto &end = ends[id];
+    for (const int piece : end) {
+      if (piece >= 0 && !used[piece]) {
+        return piece;
+      }
+    }
+    return -1;
+  };
+
+  std::vector<Chain> chains;
+  for (int i = 0; i < n; ++i) {
+    if (used[i]) {
+      continue;
+    }
+    used[i] = 1;
+    Chain chain = to_chain(std::move(pieces[i]));
+    // extend the back of the chain, then reverse it and extend the front
+    for (int side = 0; side < 2 && chain.front() != chain.back(); ++side) {
+      for (int piece = next_piece(chain.back());
+           piece >= 0 && chain.front() != chain.back();
+           piece = next_piece(chain.back())) {
+        used[piece] = 1;
+        append(chain, pieces[piece]);
+      }
+      std::reverse(chain.begin(), chain.end());
+    }
+    chains.push_back(std::move(chain));
+  }
+  return chains;
+}
+
+} // namespace
+
+std::vector<DataWithAesthetic>
+Contour::lines(const DataWithAesthetic &data) const {
+  // node coordinates
+  int nx = m_nx;
+  int ny = m_ny;
+  std::vector<float> node_x;
+  std::vector<float> node_y;
+  const int rows = data.rows();
+  if (nx > 0) {
+    for (int i = 0; i < nx; ++i) {
+      node_x.push_back(m_span.bmin[0] + i * m_span.delta()[0] / (nx - 1));
+    }
+    for (int j = 0; j < ny; ++j) {
+      node_y.push_back(m_span.bmin[1] + j * m_span.delta()[1] / (ny - 1));
+    }
+  } else if (rows > 0) {
+    auto xmin = data.begin<Aesthetic::xmin>();
+    auto xmax = data.begin<Aesthetic::xmax>();
+    auto ymin = data.begin<Aesthetic::ymin>();
+    auto ymax = data.begin<Aesthetic::ymax>();
+    nx = 1;
+    while (nx < rows && ymin[nx] == ymin[0]) {
+      ++nx;
+    }
+    ny = rows / nx;
+    for (int i = 0; i < nx; ++i) {
+      node_x.push_back(0.5f * (xmin[i] + xmax[i]));
+    }
+    for (int j = 0; j < ny; ++j) {
+      node_y.push_back(0.5f * (ymin[j * nx] + ymax[j * nx]));
+    }
+  }
+  if (rows != nx * ny) {
+    throw Exception("Contour requires one value for each node of the grid");
+  }
+
+  auto value = m_value_begin(data);
+  std::vector<float> values(rows);
+  for (int i = 0; i < rows; ++i) {
+    values[i] = value[i];
+  }
+
+  std::vector<float> levels = m_levels;
+  if (m_number_of_levels > 0) {
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    for (const float v : values) {
+      if (!std::isnan(v)) {
+        min = std::min(min, v);
+        max = std::max(max, v);
+      }
+    }
+    for (int k = 0; k < m_number_of_levels && max > min; ++k) {
+      levels.push_back(min + (k + 1) * (max - min) / (m_number_of_levels + 1));
+    }
+  }
+
+  const int bands = nx >= 2 && ny >= 2
+                        ? parallel_blocks(ny - 1, contour_band_rows)
+                        : 0;
+  std::vector<DataWithAesthetic> result;
+  for (const float level : levels) {
+    // marching squares in each band of cells, joining the segments within
+    // each band
+    std::vector<std::vector<Chain>> band_chains(bands);
+    parallel_for_blocks(
+        std::max(ny - 1, 0), contour_band_rows,
+        [&](const int, const int band, const int begin, const int end) {
+          std::vector<Segment> segments;
+          for (int j = begin; j < end; ++j) {
+            for (int i = 0; i + 1 < nx; ++i) {
+              const std::int64_t k = std::int64_t(j) * nx + i;
+              const float v00 = values[k];
+              const float v10 = values[k + 1];
+              const float v11 = values[k + nx + 1];
+              const float v01 = values[k + nx];
+              if (std::isnan(v00) || std::isnan(v10) || std::isnan(v11) ||
+                  std::isnan(v01)) {
+                continue;
+              }
+              const int index = (v00 >= level) | (v10 >= level) << 1 |
+                                (v11 >= level) << 2 | (v01 >= level) << 3;
+              // bottom, right, top and left edges of the cell
+              const std::int64_t b = 2 * k;
+              const std::int64_t r = 2 * (k + 1) + 1;
+              const std::int64_t t = 2 * (k + nx);
+              const std::int64_t l = 2 * k + 1;
+              const bool centre_above =
+                  0.25f * (v00 + v10 + v11 + v01) >= level;
+              switch (index) {
+              case 1:
+              case 14:
+                segments.emplace_back(l, b);
+                break;
+              case 2:
+              case 13:
+                segments.emplace_back(b, r);
+                break;
+              case 3:
+              case 12:
+                segments.emplace_back(l, r);
+                break;
+              case 4:
+              case 11:
+                segments.emplace_back(r, t);
+                break;
+              case 6:
+              case 9:
+                segments.emplace_back(b, t);
+                break;
+              case 7:
+              case 8:
+                segments.emplace_back(l, t);
+                break;
+              case 5:
+                // bottom left and top right above the level
+                if (centre_above) {
+                  segments.emplace_back(l, t);
+                  segments.emplace_back(b, r);
+                } else {
+                  segments.emplace_back(l, b);
+                  segments.emplace_back(r, t);
+                }
+                break;
+              case 10:
+                // bottom right and top left above the level
+                if (centre_above) {
+                  segments.emplace_back(l, b);
+                  segments.emplace_back(r, t);
+                } else {
+                  segments.emplace_back(l, t);
+                  segments.emplace_back(b, r);
+                }
+                break;
+              default:
+                break;
+              }
+            }
+          }
+          band_chains[band] = stitch(std::move(segments));
+        });
+
+    // join the chains across the band boundaries
+    std::vector<Chain> pieces;
+    for (auto &chains : band_chains) {
+      std::move(chains.begin(), chains.end(), std::back_inserter(pieces));
+    }
+    const std::vector<Chain> chains = stitch(std::move(pieces));
+
+    // convert to points by interpolating along each edge, and simplify
+    auto point = [&](const std::int64_t id) {
+      const std::int64_t a = id / 2;
+      const std::int64_t b = id % 2 == 0 ? a + 1 : a + nx;
+      const float s = (level - values[a]) / (values[b] - values[a]);
+      const int i = static_cast<int>(a % nx);
+      const int j = static_cast<int>(a / nx);
+      const vfloat2_t pa{node_x[i], node_y[j]};
+      const vfloat2_t pb = id % 2 == 0 ? vfloat2_t{node_x[i + 1], node_y[j]}
+                                       : vfloat2_t{node_x[i], node_y[j + 1]};
+      return pa + s * (pb - pa);
+    };
+    const bool simplify = m_tolerance[0] > 0 && m_tolerance[1] > 0;
+    const int number_of_chains = static_cast<int>(chains.size());
+    std::vector<std::vector<vfloat2_t>> polylines(number_of_chains);
+    parallel_for_blocks(
+        number_of_chains, 64,
+        [&](const int, const int, const int begin, const int end) {
+          for (int c = begin; c < end; ++c) {
+            auto &polyline = polylines[c];
+            for (const std::int64_t id : chains[c]) {
+              polyline.push_back(point(id));
+            }
+            if (simplify) {
+              // simplify in units of the tolerance
+              std::vector<vfloat2_t> scaled(polyline.size());
+              for (std::size_t p = 0; p < polyline.size(); ++p) {
+                scaled[p] = polyline[p] / m_tolerance;
+              }
+              const auto kept = douglas_peucker(scaled, 1.f);
+              std::vector<vfloat2_t> simplified;
+              simplified.reserve(kept.size());
+              for (const int p : kept) {
+                simplified.push_back(polyline[p]);
+              }
+              polyline.swap(simplified);
+            }
+          }
+        });
+
+    // polylines separated by missing values
+    std::vector<float> x;
+    std::vector<float> y;
+    for (const auto &polyline : polylines) {
+      if (!x.empty()) {
+        x.push_back(std::numeric_limits<float>::quiet_NaN());
+        y.push_back(std::numeric_limits<float>::quiet_NaN());
+      }
+      for (const auto &p : polyline) {
+        x.push_back(p[0]);
+        y.push_back(p[1]);
+      }
+    }
+    result.push_back(create_data().x(x).y(y));
+  }
+  return result;
+}
+
+DataWithAesthetic Contour::operator()(const DataWithAesthetic &data) const {
+  std::vector<float> x;
+  std::vector<float> y;
+  for (const auto &level : lines(data)) {
+    if (level.rows() == 0) {
+      continue;
+    }
+    if (!x.empty()) {
+      x.push_back(std::numeric_limits<float>::quiet_NaN());
+      y.push_back(std::numeric_limits<float>::quiet_NaN());
+    }
+    auto level_x = level.begin<Aesthetic::x>();
+    auto level_y = level.begin<Aesthetic::y>();
+    for (int i = 0; i < level.rows(); ++i) {
+      x.push_back(level_x[i]);
+      y.push_back(level_y[i]);
+    }
+  }
+  return create_data().x(x).y(y);
+}
+
+} // namespace trase
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Contour.hpp
+
+#ifndef CONTOUR_H_
+#define CONTOUR_H_
+
+#include <string>
+#include <vector>
+
+#include "frontend/Data.hpp"
+#include "frontend/TransformCache.hpp"
+#include "util/BBox.hpp"
+
+namespace trase {
+
+class Axis;
+
+/// contour lines (iso-lines) of values on a regular grid, found by marching
+/// squares
+///
+/// The grid is either given explicitly, as the number of nodes in each
+/// direction and their span, with the value of node (i, j) in row j * nx + i
+/// of the value aesthetic, or taken from data with one row per grid cell in
+/// the xmin, xmax, ymin and ymax aesthetics (x index varying fastest), such
+/// as the output of BinXY, with a node at the centre of each cell. By default
+/// the values are given by the fill aesthetic, as output by BinXY.
+///
+/// The cells are processed in bands of rows in parallel. The segments found
+/// in each band are joined into polylines within the band, and then the
+/// polylines ending on the band boundaries are joined across bands. Cells
+/// with a missing corner value are skipped, and saddle cells are resolved
+/// using the mean of the corners. The polylines can be simplified using the
+/// Douglas-Peucker algorithm, e.g. to the size of a pixel (see tolerance()).
+///
+/// lines() gives one data set for each level, holding the polylines
+/// separated by missing values in the x and y aesthetics, ready for drawing
+/// with Axis::line. Used as a transform, all the levels are given together.
+class Contour {
+  std::vector<float> m_levels;
+  int m_number_of_levels{0};
+  int m_nx{0};
+  int m_ny{0};
+  bfloat2_t m_span;
+  vfloat2_t m_tolerance{0.f, 0.f};
+  ColumnIterator (*m_value_begin)(const DataWithAesthetic &);
+
+public:
+  /// contour the given @p levels of the values of a grid of cells
+  explicit Contour(std::vector<float> levels);
+
+  /// contour @p number_of_levels evenly spaced levels strictly between the
+  /// smallest and largest values of a grid of cells
+  explicit Contour(int number_of_levels);
+
+  /// contour the given @p levels of the values on a grid of @p nx by @p ny
+  /// nodes spanning @p span
+  Contour(std::vector<float> levels, int nx, int ny, const bfloat2_t &span);
+
+  /// the values of the grid are given by Aesthetic
+  template <typename Aesthetic> Contour &value() {
+    m_value_begin = [](const DataWithAesthetic &data) {
+      return data.begin<Aesthetic>();
+    };
+    return *this;
+  }
+
+  /// simplify the lines so that no point is moved more than @p x in the x
+  /// direction or @p y in the y direction (in data coordinates). A tolerance
+  /// of zero (the default) keeps every point
+  Contour &tolerance(float x, float y);
+
+  /// simplify the lines to a tolerance of @p pixels pixels on @p axis, at
+  /// its current limits
+  Contour &tolerance(const Axis &axis, float pixels = 1.f);
+
+  /// returns the contour lines of each level in @p data
+  std::vector<DataWithAesthetic> lines(const DataWithAesthetic &data) const;
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data) const;
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    std::string key = make_cache_key(
+        m_number_of_levels, m_nx, m_ny, m_span.bmin[0], m_span.bmin[1],
+        m_span.bmax[0], m_span.bmax[1], m_tolerance[0], m_tolerance[1],
+        m_value_begin, m_levels.size());
+    for (const float level : m_levels) {
+      append_cache_key(key, level);
+    }
+    return key;
+  }
+};
+
+} // namespace trase
+
+#endif // CONTOUR_H_
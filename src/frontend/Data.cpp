@@ -33,8 +33,130 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "frontend/Data.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "util/Parallel.hpp"
+
 namespace trase {
 
+namespace {
+
+/// number of rows processed together when calculating column statistics. The
+/// partial statistics of each block are combined in block order, so the
+/// result does not depend on the number of threads
+const int statistics_block_size = 1 << 16;
+
+/// partial statistics of a block of values, shifted by a pivot value to avoid
+/// cancellation when computing the variance
+struct PartialStatistics {
+  int count{0};
+  float min{std::numeric_limits<float>::max()};
+  float max{-std::numeric_limits<float>::max()};
+  double sum{0};
+  double sq_sum{0};
+
+  void add(const float x, const float pivot) {
+    min = std::min(min, x);
+    max = std::max(max, x);
+    const double diff = static_cast<double>(x) - pivot;
+    sum += diff;
+    sq_sum += diff * diff;
+    ++count;
+  }
+
+  void merge(const PartialStatistics &other) {
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+    sq_sum += other.sq_sum;
+  }
+};
+
+ColumnStatistics calculate_statistics(const ColumnIterator x,
+                                      const ValidityBitmap &valid) {
+  ColumnStatistics result;
+  const int n = valid.size() - valid.null_count();
+  if (n == 0) {
+    return result;
+  }
+
+  int first = 0;
+  while (!valid.test(first)) {
+    ++first;
+  }
+  const float pivot = x[first];
+
+  const int rows = valid.size();
+  std::vector<PartialStatistics> blocks(
+      parallel_blocks(rows, statistics_block_size));
+  parallel_for_blocks(
+      rows, statistics_block_size,
+      [&](const int, const int block, const int begin, const int end) {
+        PartialStatistics partial;
+        if (valid.all_valid()) {
+          for (int i = begin; i < end; ++i) {
+            partial.add(x[i], pivot);
+          }
+        } else {
+          valid.for_each_valid(begin, end,
+                               [&](const int i) { partial.add(x[i], pivot); });
+        }
+        blocks[block] = partial;
+      });
+
+  PartialStatistics total;
+  for (const auto &block : blocks) {
+    total.merge(block);
+  }
+
+  result.count = total.count;
+  result.min = total.min;
+  result.max = total.max;
+  result.mean = pivot + total.sum / n;
+  result.variance =
+      std::max(0.0, (total.sq_sum - total.sum * total.sum / n) / n);
+  return result;
+}
+
+/// combines the hash @p value into @p seed
+std::uint64_t hash_combine(const std::uint64_t seed,
+                           const std::uint64_t value) {
+  return seed ^ (value + UINT64_C(0x9e3779b97f4a7c15) + (seed << 6) +
+                 (seed >> 2));
+}
+
+/// FNV-1a hash of the bits of each value in each block, with the hashes of
+/// the blocks combined in block order
+std::uint64_t calculate_hash(const ColumnIterator x, const int rows) {
+  const std::uint64_t offset = UINT64_C(0xcbf29ce484222325);
+  const std::uint64_t prime = UINT64_C(0x100000001b3);
+  std::vector<std::uint64_t> blocks(
+      parallel_blocks(rows, statistics_block_size));
+  parallel_for_blocks(
+      rows, statistics_block_size,
+      [&](const int, const int block, const int begin, const int end) {
+        std::uint64_t hash = offset;
+        for (int i = begin; i < end; ++i) {
+          const float value = x[i];
+          std::uint32_t bits;
+          std::memcpy(&bits, &value, sizeof(bits));
+          hash = (hash ^ bits) * prime;
+        }
+        blocks[block] = hash;
+      });
+
+  std::uint64_t hash = hash_combine(offset, static_cast<std::uint64_t>(rows));
+  for (const auto block : blocks) {
+    hash = hash_combine(hash, block);
+  }
+  return hash;
+}
+
+} // namespace
+
 template <>
 float cast_to_float<std::string>(const std::string &arg,
                                  const std::set<std::string> &string_data) {
@@ -65,6 +187,114 @@ const std::set<std::string> &RawData::string_data(int i) const {
   return m_string_data[i];
 }
 
+const ValidityBitmap &RawData::valid(const int i) const {
+  if (i < 0 || i >= cols()) {
+    throw std::out_of_range("column does not exist");
+  }
+  return m_valid[i];
+}
+
+ColumnStatistics RawData::statistics(const int i) const {
+  if (i < 0 || i >= cols()) {
+    throw std::out_of_range("column does not exist");
+  }
+  // the cache is updated atomically, so that statistics can be requested
+  // from several threads
+  auto cached = std::atomic_load(&m_statistics[i]);
+  if (!cached) {
+    cached = std::make_shared<const ColumnStatistics>(
+        calculate_statistics(begin(i), m_valid[i]));
+    std::atomic_store(&m_statistics[i], cached);
+  }
+  return *cached;
+}
+
+std::uint64_t RawData::content_hash(const int i) const {
+  if (i < 0 || i >= cols()) {
+    throw std::out_of_range("column does not exist");
+  }
+  auto cached = std::atomic_load(&m_hashes[i]);
+  if (!cached) {
+    std::uint64_t hash = calculate_hash(begin(i), m_rows);
+    hash = hash_combine(hash,
+                        static_cast<std::uint64_t>(m_valid[i].null_count()));
+    for (const auto &label : m_string_data[i]) {
+      hash = hash_combine(hash, std::hash<std::string>()(label));
+    }
+    cached = std::make_shared<const std::uint64_t>(hash);
+    std::atomic_store(&m_hashes[i], cached);
+  }
+  return *cached;
+}
+
+std::size_t RawData::memory_usage() const {
+  std::size_t size = sizeof(RawData) + sizeof(float) * m_matrix.capacity() +
+                     sizeof(float) * m_tmp.capacity();
+  for (int i = 0; i < m_cols; ++i) {
+    if (!m_valid[i].all_valid()) {
+      size += sizeof(ValidityBitmap::word_t) *
+              ((m_rows + ValidityBitmap::word_bits - 1) /
+               ValidityBitmap::word_bits);
+    }
+    for (const auto &label : m_string_data[i]) {
+      // approximate the node overhead of the set by three pointers
+      size += label.capacity() + sizeof(std::string) + 3 * sizeof(void *);
+    }
+    if (std::atomic_load(&m_statistics[i])) {
+      size += sizeof(ColumnStatistics);
+    }
+    if (std::atomic_load(&m_hashes[i])) {
+      size += sizeof(std::uint64_t);
+    }
+    if (auto index = std::atomic_load(&m_indices[i])) {
+      size += sizeof(HistogramIndex) + sizeof(float) * index->sorted().size();
+    }
+  }
+  return size;
+}
+
+std::shared_ptr<const HistogramIndex>
+RawData::histogram_index(const int i) const {
+  if (i < 0 || i >= cols()) {
+    throw std::out_of_range("column does not exist");
+  }
+  auto cached = std::atomic_load(&m_indices[i]);
+  if (!cached) {
+    cached = std::make_shared<const HistogramIndex>(begin(i), end(i),
+                                                    m_valid[i]);
+    std::atomic_store(&m_indices[i], cached);
+  }
+  return cached;
+}
+
+bool RawData::has_histogram_index(const int i) const {
+  if (i < 0 || i >= cols()) {
+    throw std::out_of_range("column does not exist");
+  }
+  return std::atomic_load(&m_indices[i]) != nullptr;
+}
+
+std::uint64_t DataWithAesthetic::content_hash() const {
+  // combine the columns in order of aesthetic, so the result does not
+  // depend on the order of the map
+  std::vector<std::pair<int, int>> columns(m_map.begin(), m_map.end());
+  std::sort(columns.begin(), columns.end());
+  std::uint64_t hash = static_cast<std::uint64_t>(rows());
+  for (const auto &column : columns) {
+    hash = hash_combine(hash, static_cast<std::uint64_t>(column.first));
+    hash = hash_combine(hash, m_data->content_hash(column.second));
+  }
+  return hash;
+}
+
+DataWithAesthetic DataWithAesthetic::copy() const {
+  return {std::make_shared<RawData>(*m_data), m_map, m_limits};
+}
+
+std::size_t DataWithAesthetic::memory_usage() const {
+  return m_data->memory_usage();
+}
+
 int DataWithAesthetic::rows() const { return m_data->rows(); }
 
 int DataWithAesthetic::cols() const { return m_data->cols(); }
@@ -91,6 +321,51 @@ template <typename Aesthetic> ColumnIterator DataWithAesthetic::end() const {
   return m_data->end(search->second);
 }
 
+template <typename Aesthetic>
+const ValidityBitmap &DataWithAesthetic::valid() const {
+
+  auto search = m_map.find(Aesthetic::index);
+
+  if (search == m_map.end()) {
+    throw Exception(Aesthetic::name + std::string(" aestheic not provided"));
+  }
+  return m_data->valid(search->second);
+}
+
+template <typename Aesthetic>
+ColumnStatistics DataWithAesthetic::statistics() const {
+
+  auto search = m_map.find(Aesthetic::index);
+
+  if (search == m_map.end()) {
+    throw Exception(Aesthetic::name + std::string(" aestheic not provided"));
+  }
+  return m_data->statistics(search->second);
+}
+
+template <typename Aesthetic>
+std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index() const {
+
+  auto search = m_map.find(Aesthetic::index);
+
+  if (search == m_map.end()) {
+    throw Exception(Aesthetic::name + std::string(" aestheic not provided"));
+  }
+  return m_data->histogram_index(search->second);
+}
+
+template <typename Aesthetic>
+bool DataWithAesthetic::has_histogram_index() const {
+
+  auto search = m_map.find(Aesthetic::index);
+
+  if (search == m_map.end()) {
+    throw Exception(Aesthetic::name + std::string(" aestheic not provided"));
+  }
+  return m_data->has_histogram_index(search->second);
+}
+
 template ColumnIterator DataWithAesthetic::begin<Aesthetic::x>() const;
 template ColumnIterator DataWithAesthetic::begin<Aesthetic::y>() const;
 template ColumnIterator DataWithAesthetic::begin<Aesthetic::color>() const;
@@ -111,6 +386,68 @@ template ColumnIterator DataWithAesthetic::end<Aesthetic::ymin>() const;
 template ColumnIterator DataWithAesthetic::end<Aesthetic::xmax>() const;
 template ColumnIterator DataWithAesthetic::end<Aesthetic::ymax>() const;
 
+template const ValidityBitmap &DataWithAesthetic::valid<Aesthetic::x>() const;
+template const ValidityBitmap &DataWithAesthetic::valid<Aesthetic::y>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::color>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::size>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::fill>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::xmin>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::ymin>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::xmax>() const;
+template const ValidityBitmap &
+DataWithAesthetic::valid<Aesthetic::ymax>() const;
+
+template ColumnStatistics DataWithAesthetic::statistics<Aesthetic::x>() const;
+template ColumnStatistics DataWithAesthetic::statistics<Aesthetic::y>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::color>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::size>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::fill>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::xmin>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::ymin>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::xmax>() const;
+template ColumnStatistics
+DataWithAesthetic::statistics<Aesthetic::ymax>() const;
+
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::x>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::y>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::color>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::size>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::fill>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::xmin>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::ymin>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::xmax>() const;
+template std::shared_ptr<const HistogramIndex>
+DataWithAesthetic::histogram_index<Aesthetic::ymax>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::x>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::y>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::color>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::size>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::fill>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::xmin>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::ymin>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::xmax>() const;
+template bool DataWithAesthetic::has_histogram_index<Aesthetic::ymax>() const;
+
 const int Aesthetic::N;
 const int Aesthetic::x::index;
 const char *Aesthetic::x::name = "x";
@@ -143,9 +480,9 @@ float Aesthetic::x::to_display(const float data, const Limits &data_lim,
 float Aesthetic::x::from_display(const float display, const Limits &data_lim,
                                  const bfloat2_t &display_lim) {
   float len_ratio = (data_lim.bmax[index] - data_lim.bmin[index]) /
-                    (display_lim.bmax[1] - display_lim.bmin[1]);
+                    (display_lim.bmax[0] - display_lim.bmin[0]);
 
-  float rel_pos = display - display_lim.bmin[1];
+  float rel_pos = display - display_lim.bmin[0];
   return data_lim.bmin[index] + rel_pos * len_ratio;
 }
 
@@ -38,7 +38,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DATA_H_
 
 #include <cassert>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -49,10 +51,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "util/Colors.hpp"
 #include "util/ColumnIterator.hpp"
 #include "util/Exception.hpp"
+#include "util/HistogramIndex.hpp"
+#include "util/ValidityBitmap.hpp"
 
 namespace trase {
 
+/// summary statistics of the valid entries of a data column
+struct ColumnStatistics {
+  /// number of valid entries
+  int count{0};
+  float min{std::numeric_limits<float>::max()};
+  float max{-std::numeric_limits<float>::max()};
+  double mean{0};
+
+  /// population variance
+  double variance{0};
+};
+
 /// Raw data class, impliments a matrix with row major order
+///
+/// Missing values are given as NaN, and are recorded in a ValidityBitmap for
+/// each column so that they can be cheaply skipped by later calculations
 class RawData {
   // raw data set, in row major order
   std::vector<float> m_matrix;
@@ -60,6 +79,18 @@ class RawData {
   // sets for non-numeric string data
   std::vector<std::set<std::string>> m_string_data;
 
+  // validity of each entry, one bitmap per column
+  std::vector<ValidityBitmap> m_valid;
+
+  // statistics of each column, calculated when first needed
+  mutable std::vector<std::shared_ptr<const ColumnStatistics>> m_statistics;
+
+  // hash of the contents of each column, calculated when first needed
+  mutable std::vector<std::shared_ptr<const std::uint64_t>> m_hashes;
+
+  // histogram index of each column, built when first needed
+  mutable std::vector<std::shared_ptr<const HistogramIndex>> m_indices;
+
   /// temporary data
   std::vector<float> m_tmp;
 
@@ -104,6 +135,37 @@ public:
   /// the returned set will be empty if column i contains numeric data
   const std::set<std::string> &string_data(int i) const;
 
+  /// return the validity bitmap for column i
+  ///
+  /// an entry is invalid (i.e. missing) if it was given as NaN
+  const ValidityBitmap &valid(int i) const;
+
+  /// return the statistics of the valid entries of column i
+  ///
+  /// these are calculated in a single parallel pass the first time they are
+  /// needed, and cached until the column is modified
+  ColumnStatistics statistics(int i) const;
+
+  /// return a hash of the contents of column i, including its validity and
+  /// the strings of non-numeric data (so that columns with the same codes
+  /// but different labels differ)
+  ///
+  /// this is calculated in a single parallel pass the first time it is
+  /// needed, and cached until the column is modified
+  std::uint64_t content_hash(int i) const;
+
+  /// return an estimate of the memory used in bytes, counting the values,
+  /// validity bitmaps, string sets and any cached statistics, hashes and
+  /// histogram indices
+  std::size_t memory_usage() const;
+
+  /// return the histogram index of column i, building it the first time it
+  /// is needed. The index is kept until the column is modified
+  std::shared_ptr<const HistogramIndex> histogram_index(int i) const;
+
+  /// return true if the histogram index of column i has already been built
+  bool has_histogram_index(int i) const;
+
   /// facets the data based on the input data column
   ///
   /// The input data column (of the same number of rows as this dataset)
@@ -269,6 +331,28 @@ public:
   /// throws if a has not yet been set
   template <typename Aesthetic> ColumnIterator end() const;
 
+  /// return the validity bitmap of the data column for aesthetic a, throws if
+  /// a has not yet been set
+  template <typename Aesthetic> const ValidityBitmap &valid() const;
+
+  /// return the (cached) statistics of the data column for aesthetic a,
+  /// throws if a has not yet been set
+  template <typename Aesthetic> ColumnStatistics statistics() const;
+
+  /// return a hash of the contents of the data columns for each aesthetic.
+  /// Two data sets with the same hash hold the same values for the same
+  /// aesthetics (barring hash collisions), wherever they are stored
+  std::uint64_t content_hash() const;
+
+  /// return the histogram index of the data column for aesthetic a, building
+  /// it if needed. Throws if a has not yet been set
+  template <typename Aesthetic>
+  std::shared_ptr<const HistogramIndex> histogram_index() const;
+
+  /// return true if the histogram index of the data column for aesthetic a
+  /// has already been built
+  template <typename Aesthetic> bool has_histogram_index() const;
+
   /// if aesthetic a is not yet been set, this creates a new data column and
   /// copies in `data` (throws if data does not have the correct number of
   /// rows). If aesthetic a has been previously set, its data column is
@@ -285,6 +369,14 @@ public:
   /// returns true if Aesthetic has been set
   template <typename Aesthetic> bool has() const;
 
+  /// return a copy of the data set with its own RawData, so that setting a
+  /// column of the copy does not change this data set (or vice versa)
+  DataWithAesthetic copy() const;
+
+  /// return an estimate of the memory used by the RawData in bytes, see
+  /// RawData::memory_usage
+  std::size_t memory_usage() const;
+
   /// returns number of rows in the data set
   int rows() const;
 
@@ -340,7 +432,7 @@ public:
 
 private:
   template <typename Aesthetic, typename T>
-  void calculate_limits(T begin, T end);
+  void calculate_limits(T begin, T end, const ValidityBitmap &valid);
 };
 
 /// creates a new, empty dataset
@@ -144,6 +144,12 @@ template <typename T> void RawData::add_column(T new_col_begin, T new_col_end) {
         [this](auto i) { return cast_to_float(i, m_string_data.back()); });
   }
   ++m_cols;
+
+  m_valid.push_back(
+      ValidityBitmap::from_nan(begin(m_cols - 1), end(m_cols - 1)));
+  m_statistics.emplace_back();
+  m_hashes.emplace_back();
+  m_indices.emplace_back();
 }
 
 template <typename T> void RawData::add_row(T new_row_begin, T new_row_end) {
@@ -160,6 +166,15 @@ template <typename T> void RawData::add_row(T new_row_begin, T new_row_end) {
   // is not float)
   std::transform(new_row_begin, new_row_end, m_matrix.begin() + oldn,
                  [this](auto i) { return static_cast<float>(i); });
+
+  m_string_data.resize(m_cols);
+  m_valid.resize(m_cols);
+  for (int j = 0; j < m_cols; ++j) {
+    m_valid[j].push_back(!std::isnan(m_matrix[oldn + j]));
+  }
+  m_statistics.assign(m_cols, nullptr);
+  m_hashes.assign(m_cols, nullptr);
+  m_indices.assign(m_cols, nullptr);
 }
 
 template <typename T> void RawData::add_column(const std::vector<T> &new_col) {
@@ -190,6 +205,11 @@ void RawData::set_column(const int i, const std::vector<T> &new_col) {
   for (int j = 0; j < m_rows; ++j) {
     m_matrix[j * m_cols + i] = cast_to_float(new_col[j], m_string_data[i]);
   }
+
+  m_valid[i] = ValidityBitmap::from_nan(begin(i), end(i));
+  m_statistics[i].reset();
+  m_hashes[i].reset();
+  m_indices[i].reset();
 }
 
 template <typename T>
@@ -290,12 +310,26 @@ DataWithAesthetic::facet(const std::vector<T1> &data1,
 }
 
 template <typename Aesthetic, typename T>
-void DataWithAesthetic::calculate_limits(T begin, T end) {
+void DataWithAesthetic::calculate_limits(T begin, T end,
+                                         const ValidityBitmap &valid) {
+  if (valid.null_count() == valid.size()) {
+    // no valid data, leave limits unset
+    return;
+  }
   if (begin != end) {
-    // set m_limits with new data
-    auto min_max = std::minmax_element(begin, end);
-    float min = *min_max.first;
-    float max = *min_max.second;
+    // set m_limits with new data, skipping any missing values
+    float min = std::numeric_limits<float>::max();
+    float max = -std::numeric_limits<float>::max();
+    if (valid.all_valid()) {
+      auto min_max = std::minmax_element(begin, end);
+      min = *min_max.first;
+      max = *min_max.second;
+    } else {
+      valid.for_each_valid([&](const int i) {
+        min = std::min(min, begin[i]);
+        max = std::max(max, begin[i]);
+      });
+    }
 
     // if limits are equal spread them out by 2*1e4*eps to stop zeros later on
     if (min == max) {
@@ -322,7 +356,8 @@ void DataWithAesthetic::set(const std::vector<T> &data) {
   }
 
   calculate_limits<Aesthetic>(m_data->begin(search->second),
-                              m_data->end(search->second));
+                              m_data->end(search->second),
+                              m_data->valid(search->second));
 }
 
 /// returns true if Aesthetic has been set
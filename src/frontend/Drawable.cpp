@@ -45,6 +45,7 @@ Drawable::Drawable(Drawable *parent, const bfloat2_t &area_of_parent)
 }
 
 void Drawable::resize(const bfloat2_t &parent_pixels) {
+  mark_dirty();
   m_pixels.bmin = m_area.bmin * parent_pixels.delta() + parent_pixels.min();
   m_pixels.bmax = m_area.bmax * parent_pixels.delta() + parent_pixels.min();
   for (auto &i : m_children) {
@@ -73,6 +74,7 @@ void Drawable::add_frame_time(const float time) {
   }
   m_times.push_back(time);
   update_time_span(time);
+  mark_dirty();
 }
 
 void Drawable::update_time_span(const float time) {
@@ -86,6 +88,58 @@ void Drawable::update_time_span(const float time) {
   }
 }
 
-Style &Drawable::style() noexcept { return m_style; }
+Style &Drawable::style() noexcept {
+  mark_dirty();
+  return m_style;
+}
+
+void Drawable::mark_dirty() {
+  ++m_version;
+  for (Drawable *i = this; i != nullptr; i = i->m_parent) {
+    ++i->m_tree_version;
+  }
+}
+
+void Drawable::mark_subtree_dirty() {
+  mark_dirty();
+  for (auto &i : m_children) {
+    i->mark_subtree_dirty();
+  }
+}
+
+void Drawable::dispatch_cached(
+    BackendSVG &backend, const float time, const bool animated,
+    const std::function<void()> &draw,
+    const std::function<void(Drawable &)> &dispatch_child) {
+  // the tree version alone misses changes to what version() depends on
+  // outside this object (e.g. the entries of a Legend), so include both
+  const std::size_t tree_version = m_tree_version + version();
+  if (m_tree_cache.matches(tree_version, time, animated) &&
+      backend.replay(m_tree_cache.fragments)) {
+    return;
+  }
+
+  const std::size_t version = this->version();
+  if (!m_cache.matches(version, time, animated) ||
+      !backend.replay(m_cache.fragments)) {
+    backend.begin_fragment();
+    try {
+      draw();
+    } catch (...) {
+      backend.end_fragment();
+      throw;
+    }
+    m_cache.store({backend.end_fragment()}, version, time, animated);
+  }
+
+  // the output of the tree is that of this object followed by each child's
+  auto fragments = m_cache.fragments;
+  for (auto &i : m_children) {
+    dispatch_child(*i);
+    fragments.insert(fragments.end(), i->m_tree_cache.fragments.begin(),
+                     i->m_tree_cache.fragments.end());
+  }
+  m_tree_cache.store(std::move(fragments), tree_version, time, animated);
+}
 
 } // namespace trase
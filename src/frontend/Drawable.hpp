@@ -37,8 +37,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DRAWABLE_H_
 
 #include <array>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <ostream>
+#include <utility>
 #include <vector>
 
 #include "util/BBox.hpp"
@@ -52,10 +55,10 @@ class AnimatedBackend;
 /// A helper struct for Drawable that holds frame-related information
 struct FrameInfo {
 
-  int frame_above;
-  float frame;
-  float w1;
-  float w2;
+  int frame_above{0};
+  float frame{0.f};
+  float w1{1.f};
+  float w2{0.f};
 
   void update(std::vector<float> &times, const float time_now) {
     frame_above = static_cast<int>(std::distance(
@@ -77,6 +80,40 @@ struct FrameInfo {
 // forward declare all backends here
 class BackendGL;
 class BackendSVG;
+class BackendRecorder;
+struct SVGFragment;
+
+/// A helper struct for Drawable that holds the recorded output of a draw,
+/// along with the version of the Drawable and the time that was drawn
+struct DrawCache {
+  /// the recorded output, in drawing order
+  std::vector<std::shared_ptr<const SVGFragment>> fragments;
+
+  /// the version drawn, or 0 if nothing has been recorded
+  std::size_t version{0};
+
+  /// the time drawn, if not animated
+  float time{0.f};
+
+  /// true if all the frames were drawn as an animation
+  bool animated{false};
+
+  /// returns true if the recorded output is of the given version and time
+  bool matches(const std::size_t version, const float time,
+               const bool animated) const {
+    return this->version == version && this->animated == animated &&
+           (animated || this->time == time);
+  }
+
+  void store(std::vector<std::shared_ptr<const SVGFragment>> fragments,
+             const std::size_t version, const float time,
+             const bool animated) {
+    this->fragments = std::move(fragments);
+    this->version = version;
+    this->time = time;
+    this->animated = animated;
+  }
+};
 
 /// Base class for drawable objects in a figure
 ///
@@ -96,6 +133,11 @@ class BackendSVG;
 /// function is implemented in a header file ending in *Draw.hpp (e.g.
 /// AxisDraw.hpp), and included when compiling each Backend
 ///
+/// Any change to a Drawable that alters how it is drawn (its data, limits,
+/// style or size) must call mark_dirty(). Backends that can record their
+/// output (currently BackendSVG) then replay the last output of every
+/// Drawable that is unchanged, rather than drawing it again
+///
 class Drawable {
 protected:
   /// a list of Drawables that are children of this object
@@ -122,6 +164,18 @@ protected:
   /// fully styling information for each drawable
   Style m_style;
 
+  /// incremented by mark_dirty() whenever the output of draw() changes
+  std::size_t m_version{1};
+
+  /// incremented by mark_dirty() on this object or any of its descendants
+  std::size_t m_tree_version{1};
+
+  /// the output of the last call to draw()
+  DrawCache m_cache;
+
+  /// the output of this object and all its descendants in the last draw
+  DrawCache m_tree_cache;
+
 public:
   /// constructs a Drawable under \p parent in the tree structure, and assigns
   /// it an drawable area given by \p area_of_parent
@@ -167,45 +221,84 @@ public:
   /// returns time span of the animation
   const float &time_span() const { return m_time_span; }
 
+  /// marks the output of this object as out of date, so that it is drawn
+  /// again rather than replayed, and informs all its ancestors
+  void mark_dirty();
+
+  /// marks this object and all its descendants as out of date, for changes
+  /// (e.g. to the limits of an Axis) that alter how the children are drawn
+  void mark_subtree_dirty();
+
+  /// returns a number that changes whenever the output of draw() may change
+  virtual std::size_t version() const { return m_version; }
+
 #ifdef TRASE_BACKEND_GL
   virtual void dispatch(BackendGL &figure, float time) = 0;
 #endif
   virtual void dispatch(BackendSVG &file, float time) = 0;
   virtual void dispatch(BackendSVG &file) = 0;
+  virtual void dispatch(BackendRecorder &recorder, float time) = 0;
+  virtual void dispatch(BackendRecorder &recorder) = 0;
 
   /// draw this object using the given AnimatedBackend
   template <typename AnimatedBackend> void draw(AnimatedBackend &backend);
 
   /// draw this object using the given Backend
   template <typename Backend> void draw(Backend &backend, float time);
+
+protected:
+  /// draws this object using @p draw, then each child using
+  /// @p dispatch_child, replaying the last output of every part of the tree
+  /// that has not changed since it was recorded
+  ///
+  /// \param time the time drawn, if not @p animated
+  /// \param animated true if all the frames are drawn as an animation
+  void dispatch_cached(BackendSVG &backend, float time, bool animated,
+                       const std::function<void()> &draw,
+                       const std::function<void(Drawable &)> &dispatch_child);
+
+  /// draws this object using @p draw, then each child using
+  /// @p dispatch_child, for backends that cannot replay their output
+  template <typename Backend>
+  void dispatch_cached(Backend &backend, float time, bool animated,
+                       const std::function<void()> &draw,
+                       const std::function<void(Drawable &)> &dispatch_child) {
+    draw();
+    for (auto &i : m_children) {
+      dispatch_child(*i);
+    }
+  }
 };
 
 } // namespace trase
 
 #define TRASE_DISPATCH(backend_type)                                           \
   void dispatch(backend_type &backend, float time) override {                  \
-    draw(backend, time);                                                       \
-    for (auto &i : m_children) {                                               \
-      i->dispatch(backend, time);                                              \
-    }                                                                          \
+    dispatch_cached(backend, time, false, [&] { draw(backend, time); },        \
+                    [&](Drawable &child) { child.dispatch(backend, time); });  \
   }
 
 #define TRASE_ANIMATED_DISPATCH(backend_type)                                  \
   void dispatch(backend_type &backend) override {                              \
-    if (m_times.size() == 1) {                                                 \
-      draw(backend, 0);                                                        \
-    } else {                                                                   \
-      draw(backend);                                                           \
-    }                                                                          \
-    for (auto &i : m_children) {                                               \
-      i->dispatch(backend);                                                    \
-    }                                                                          \
+    dispatch_cached(backend, 0.f, true,                                        \
+                    [&] {                                                      \
+                      if (m_times.size() == 1) {                               \
+                        draw(backend, 0);                                      \
+                      } else {                                                 \
+                        draw(backend);                                         \
+                      }                                                        \
+                    },                                                         \
+                    [&](Drawable &child) { child.dispatch(backend); });        \
   }
 
 #define TRASE_DISPATCH_SVG                                                     \
   TRASE_DISPATCH(BackendSVG)                                                   \
   TRASE_ANIMATED_DISPATCH(BackendSVG)
 
+#define TRASE_DISPATCH_RECORDER                                                \
+  TRASE_DISPATCH(BackendRecorder)                                              \
+  TRASE_ANIMATED_DISPATCH(BackendRecorder)
+
 #ifdef TRASE_BACKEND_GL
 #define TRASE_DISPATCH_GL TRASE_DISPATCH(BackendGL)
 #else
@@ -214,11 +307,13 @@ public:
 
 #define TRASE_DISPATCH_BACKENDS                                                \
   TRASE_DISPATCH_SVG                                                           \
+  TRASE_DISPATCH_RECORDER                                                      \
   TRASE_DISPATCH_GL
 
 #ifdef TRASE_BACKEND_GL
 #include "backend/BackendGL.hpp"
 #endif
+#include "backend/BackendRecorder.hpp"
 #include "backend/BackendSVG.hpp"
 
 #endif // DRAWABLE_H_
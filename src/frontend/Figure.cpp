@@ -103,6 +103,7 @@ std::shared_ptr<Axis> Figure::axis() { return axis(0, 0); }
 std::shared_ptr<Axis> Figure::axis(int i, int j) {
   auto new_axis = update_layout({j, i});
   m_children.push_back(new_axis);
+  mark_dirty();
   return new_axis;
 }
 
@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <array>
+#include <cmath>
 #include <string>
 
 #include "frontend/Figure.hpp"
@@ -70,19 +71,42 @@ void Figure::render_interactive_frame(Backend &backend) {
       vfloat2_t ax_delta = delta / (axis->pixels().bmax * vfloat2_t(-1, 1));
 
       // scale by axis limits
-      ax_delta[0] *= axis->limits().bmax[Aesthetic::x::index] -
-                     axis->limits().bmin[Aesthetic::x::index];
-      ax_delta[1] *= axis->limits().bmax[Aesthetic::y::index] -
-                     axis->limits().bmin[Aesthetic::y::index];
-
-      axis->limits().bmin[Aesthetic::x::index] += ax_delta[0];
-      axis->limits().bmax[Aesthetic::x::index] += ax_delta[0];
-      axis->limits().bmin[Aesthetic::y::index] += ax_delta[1];
-      axis->limits().bmax[Aesthetic::y::index] += ax_delta[1];
+      Limits limits = axis->limits();
+      ax_delta[0] *= limits.bmax[Aesthetic::x::index] -
+                     limits.bmin[Aesthetic::x::index];
+      ax_delta[1] *= limits.bmax[Aesthetic::y::index] -
+                     limits.bmin[Aesthetic::y::index];
+
+      limits.bmin[Aesthetic::x::index] += ax_delta[0];
+      limits.bmax[Aesthetic::x::index] += ax_delta[0];
+      limits.bmin[Aesthetic::y::index] += ax_delta[1];
+      limits.bmax[Aesthetic::y::index] += ax_delta[1];
+      axis->set_limits(limits);
+      axis->update_view();
     }
     backend.mouse_drag_reset_delta();
   }
 
+  const float scroll = backend.mouse_scroll_delta();
+  if (scroll != 0.f) {
+    // zoom in (scrolling up) or out about the centre of each axis
+    const float scale = std::pow(0.9f, scroll);
+    for (const auto &drawable : m_children) {
+      auto axis = std::dynamic_pointer_cast<Axis>(drawable);
+      Limits limits = axis->limits();
+      for (const int i : {Aesthetic::x::index, Aesthetic::y::index}) {
+        const float centre = 0.5f * (limits.bmin[i] + limits.bmax[i]);
+        const float half_width =
+            0.5f * scale * (limits.bmax[i] - limits.bmin[i]);
+        limits.bmin[i] = centre - half_width;
+        limits.bmax[i] = centre + half_width;
+      }
+      axis->set_limits(limits);
+      axis->update_view();
+    }
+    backend.mouse_scroll_reset_delta();
+  }
+
   const float time = backend.get_time();
   const float looped_time = std::fmod(time, m_time_span);
 
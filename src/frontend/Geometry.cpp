@@ -34,8 +34,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "frontend/Axis.hpp"
 #include "frontend/Geometry.hpp"
 
+#include <cmath>
 #include <numeric>
+#include <utility>
 
+#include "util/Parallel.hpp"
 #include "util/Vector.hpp"
 
 namespace trase {
@@ -47,6 +50,8 @@ Geometry::Geometry(Axis *parent)
 void Geometry::add_frame(const DataWithAesthetic &data, float time) {
   // add new data frame
   m_data.push_back(m_transform(data));
+  m_spatial_indices.emplace_back();
+  mark_dirty();
 
   // add new frame time
   if (time > 0) {
@@ -58,8 +63,130 @@ void Geometry::add_frame(const DataWithAesthetic &data, float time) {
 
   // communicate limits to parent axis
   const float buffer = 1.05f;
-  dynamic_cast<Axis *>(m_parent)->limits() +=
-      m_limits * Limits::vector_t::Constant(buffer);
+  dynamic_cast<Axis *>(m_parent)->extend_limits(
+      m_limits * Limits::vector_t::Constant(buffer));
+}
+
+void Geometry::add_frames(
+    const std::vector<std::pair<DataWithAesthetic, float>> &frames) {
+  const int n = static_cast<int>(frames.size());
+  if (n == 0) {
+    return;
+  }
+
+  // check all the times before adding any frames
+  float last_time = m_times.back();
+  for (const auto &frame : frames) {
+    if (frame.second > 0) {
+      if (frame.second < last_time) {
+        throw Exception("cannot add frame with time less than max frame time");
+      }
+      last_time = frame.second;
+    }
+  }
+
+  // transform the first frame, which may fix the state of the transform (e.g.
+  // the span of BinX), then the rest using a copy of it for each thread
+  std::vector<DataWithAesthetic> transformed(n);
+  transformed[0] = m_transform(frames[0].first);
+  if (m_transform.is_concurrent()) {
+    std::vector<Transform> transforms(
+        parallel_threads(parallel_blocks(n - 1, 1)), m_transform);
+    parallel_for_blocks(
+        n - 1, 1,
+        [&](const int thread, const int, const int begin, const int end) {
+          for (int i = begin; i < end; ++i) {
+            transformed[i + 1] = transforms[thread](frames[i + 1].first);
+          }
+        });
+  } else {
+    for (int i = 1; i < n; ++i) {
+      transformed[i] = m_transform(frames[i].first);
+    }
+  }
+
+  m_data.reserve(m_data.size() + n);
+  m_times.reserve(m_times.size() + n);
+  for (int i = 0; i < n; ++i) {
+    m_limits += transformed[i].limits();
+    m_data.push_back(std::move(transformed[i]));
+    if (frames[i].second > 0) {
+      m_times.push_back(frames[i].second);
+    }
+  }
+  m_spatial_indices.resize(m_data.size());
+  update_time_span(m_times.back());
+  mark_dirty();
+
+  // communicate limits to parent axis
+  const float buffer = 1.05f;
+  dynamic_cast<Axis *>(m_parent)->extend_limits(
+      m_limits * Limits::vector_t::Constant(buffer));
+}
+
+Pick Geometry::pick(const vfloat2_t &pixel, const float max_distance) const {
+  Pick result;
+  if (m_data.empty()) {
+    return result;
+  }
+  const int frame = nearest_frame();
+  const vfloat2_t point = {m_axis->from_display<Aesthetic::x>(pixel[0]),
+                           m_axis->from_display<Aesthetic::y>(pixel[1])};
+  const auto nearest =
+      spatial_index(frame)->nearest(point, pixel_scale(), max_distance);
+  if (nearest.id >= 0) {
+    result.geometry = this;
+    result.frame = frame;
+    result.row = nearest.id;
+    result.distance = std::sqrt(nearest.distance2);
+  }
+  return result;
+}
+
+std::shared_ptr<const SpatialIndex> Geometry::spatial_index(const int i) const {
+  auto cached = std::atomic_load(&m_spatial_indices[i]);
+  if (!cached) {
+    cached = std::make_shared<const SpatialIndex>(
+        build_spatial_index(m_data[i]));
+    std::atomic_store(&m_spatial_indices[i], cached);
+  }
+  return cached;
+}
+
+SpatialIndex
+Geometry::build_spatial_index(const DataWithAesthetic &data) const {
+  std::vector<vfloat2_t> points;
+  std::vector<int> rows;
+  if (data.has<Aesthetic::x>() && data.has<Aesthetic::y>()) {
+    auto x = data.begin<Aesthetic::x>();
+    auto y = data.begin<Aesthetic::y>();
+    points.reserve(data.rows());
+    rows.reserve(data.rows());
+    for (int i = 0; i < data.rows(); ++i) {
+      if (std::isfinite(x[i]) && std::isfinite(y[i])) {
+        points.emplace_back(x[i], y[i]);
+        rows.push_back(i);
+      }
+    }
+  }
+  return SpatialIndex(std::move(points), std::move(rows));
+}
+
+int Geometry::nearest_frame() const {
+  int frame = m_frame_info.frame_above;
+  if (frame > 0 && m_frame_info.w2 > m_frame_info.w1) {
+    --frame;
+  }
+  return std::min(frame, static_cast<int>(m_data.size()) - 1);
+}
+
+vfloat2_t Geometry::pixel_scale() const {
+  const auto &limits = m_axis->limits();
+  const vfloat2_t pixels = m_axis->pixels().delta();
+  return {std::abs(pixels[0] / (limits.bmax[Aesthetic::x::index] -
+                                limits.bmin[Aesthetic::x::index])),
+          std::abs(pixels[1] / (limits.bmax[Aesthetic::y::index] -
+                                limits.bmin[Aesthetic::y::index]))};
 }
 
 } // namespace trase
@@ -36,7 +36,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef GEOMETRY_H_
 #define GEOMETRY_H_
 
+#include <limits>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "frontend/Data.hpp"
@@ -45,11 +47,33 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "util/BBox.hpp"
 #include "util/Colors.hpp"
 #include "util/Exception.hpp"
+#include "util/SpatialIndex.hpp"
 
 namespace trase {
 
 // forward declare to be able to store a pointer in Axis
 class Axis;
+class Geometry;
+
+/// The row of a Geometry nearest to a point on the display, see
+/// Geometry::pick() and Axis::pick()
+struct Pick {
+  /// the geometry picked, or nullptr if no row was in range
+  const Geometry *geometry{nullptr};
+
+  /// the data frame of the geometry holding the row
+  int frame{-1};
+
+  /// the row picked
+  int row{-1};
+
+  /// the distance in pixels from the point to the row (zero if the point is
+  /// inside it)
+  float distance{std::numeric_limits<float>::max()};
+
+  /// returns true if a row was picked
+  explicit operator bool() const { return geometry != nullptr; }
+};
 
 class Geometry : public Drawable {
 protected:
@@ -71,6 +95,14 @@ protected:
   /// parent axis
   Axis *m_axis;
 
+  /// spatial index of each data frame, built on first use (see
+  /// spatial_index())
+  mutable std::vector<std::shared_ptr<const SpatialIndex>> m_spatial_indices;
+
+  /// the version of this geometry whose frames were last checked to be
+  /// consistent with each other
+  std::size_t m_validated_version{0};
+
 public:
   explicit Geometry(Axis *parent);
 
@@ -82,12 +114,58 @@ public:
   /// \param data the new data frame
   /// \param time the timestamp for this frame. This must be greater than the
   /// time for all previously added frames
-  void add_frame(const DataWithAesthetic &data, float time);
+  virtual void add_frame(const DataWithAesthetic &data, float time);
+
+  /// Adds many new data frames to this plot, giving the same result as
+  /// calling add_frame() for each in turn
+  ///
+  /// The frame times are checked before any frame is added. The transform is
+  /// applied to the first frame, then to the remaining frames in parallel if
+  /// it allows (see Transform::is_concurrent()), and the limits of the plot
+  /// and the parent axis are updated once
+  ///
+  /// \param frames the new data frames, each with its timestamp. These must
+  /// be in order, and greater than the time for all previously added frames
+  virtual void
+  add_frames(const std::vector<std::pair<DataWithAesthetic, float>> &frames);
+
+  /// Called when the visible limits of the parent axis are changed
+  /// interactively (e.g. by zooming), so that geometries whose display
+  /// depends on the visible range can update it. Does nothing by default
+  ///
+  /// \param limits the new limits of the parent axis
+  virtual void set_view(const Limits &limits) {}
+
+  /// Returns the row nearest to a point on the display
+  ///
+  /// The frame searched is the one nearest to the time the geometry was last
+  /// drawn. Rows are found using the spatial index of the frame, so that the
+  /// query is fast enough for hover highlighting of large plots
+  ///
+  /// \param pixel the point in display coordinates
+  /// \param max_distance only rows within this distance (in pixels) of the
+  /// point are picked
+  virtual Pick pick(const vfloat2_t &pixel, float max_distance) const;
+
+  /// Returns the spatial index of data frame @p i, building it on first use
+  ///
+  /// The index is kept until the frame is replaced through set_data()
+  std::shared_ptr<const SpatialIndex> spatial_index(int i) const;
 
   float get_time(const int i) const { return m_times[i]; }
 
   const DataWithAesthetic &get_data(const int i) const { return m_data[i]; }
-  DataWithAesthetic &get_data(const int i) { return m_data[i]; }
+
+  /// Replaces data frame @p i
+  ///
+  /// The data is stored as given, without the transform applied
+  void set_data(const int i, const DataWithAesthetic &data) {
+    m_data[i] = data;
+    mark_dirty();
+    std::atomic_store(&m_spatial_indices[i],
+                      std::shared_ptr<const SpatialIndex>());
+  }
+
   size_t data_size() const { return m_data.size(); }
 
   /// Sets the transform
@@ -96,14 +174,20 @@ public:
   ///
   /// All new data frames added to the plot will have this transform applied
   /// before the data is stored internally
-  void set_transform(const Transform &transform) { m_transform = transform; }
+  void set_transform(const Transform &transform) {
+    m_transform = transform;
+    mark_dirty();
+  }
 
   /// Set the label
   ///
   /// This label describes the plot and is shown on the axis legend
   ///
   /// \param label a string description of the plot
-  void set_label(const std::string &label) { m_label = label; }
+  void set_label(const std::string &label) {
+    m_label = label;
+    mark_dirty();
+  }
 
   const std::string &get_label() const { return m_label; }
   const Colormap &get_colormap() const { return *m_colormap; }
@@ -115,6 +199,10 @@ public:
   virtual void dispatch_legend(BackendSVG &file, float time,
                                const bfloat2_t &box) = 0;
   virtual void dispatch_legend(BackendSVG &file, const bfloat2_t &box) = 0;
+  virtual void dispatch_legend(BackendRecorder &recorder, float time,
+                               const bfloat2_t &box) = 0;
+  virtual void dispatch_legend(BackendRecorder &recorder,
+                               const bfloat2_t &box) = 0;
 
   template <typename AnimatedBackend> void draw(AnimatedBackend &backend);
   template <typename Backend> void draw(Backend &backend, float time);
@@ -122,6 +210,32 @@ public:
   void draw_legend(AnimatedBackend &backend, const bfloat2_t &box);
   template <typename Backend>
   void draw_legend(Backend &backend, float time, const bfloat2_t &box);
+
+protected:
+  /// Builds the spatial index of a data frame, by default from the x and y
+  /// aesthetics. Rows with missing coordinates are left out
+  virtual SpatialIndex build_spatial_index(const DataWithAesthetic &data) const;
+
+  /// returns the data frame nearest to the time last drawn
+  int nearest_frame() const;
+
+  /// returns the number of pixels per data unit along x and y
+  vfloat2_t pixel_scale() const;
+
+  /// returns true if any of the box @p pixels is within the axis, so that
+  /// primitives entirely outside it can be skipped when drawing
+  bool in_view(const bfloat2_t &pixels) const {
+    return m_pixels.intersects(pixels);
+  }
+
+  /// returns true if a box animated from @p from to @p to is within the axis
+  /// at any time in between. The box is interpolated linearly, so it stays
+  /// inside the box covering both ends
+  bool in_view(const bfloat2_t &from, const bfloat2_t &to) const {
+    bfloat2_t swept = from;
+    swept += to;
+    return in_view(swept);
+  }
 };
 
 } // namespace trase
@@ -141,6 +255,10 @@ public:
   TRASE_DISPATCH_LEGEND(BackendSVG)                                            \
   TRASE_ANIMATED_DISPATCH_LEGEND(BackendSVG)
 
+#define TRASE_DISPATCH_LEGEND_RECORDER                                         \
+  TRASE_DISPATCH_LEGEND(BackendRecorder)                                       \
+  TRASE_ANIMATED_DISPATCH_LEGEND(BackendRecorder)
+
 #ifdef TRASE_BACKEND_GL
 #define TRASE_DISPATCH_LEGEND_GL TRASE_DISPATCH_LEGEND(BackendGL)
 #else
@@ -149,8 +267,10 @@ public:
 
 #define TRASE_GEOMETRY_DISPATCH_BACKENDS                                       \
   TRASE_DISPATCH_SVG                                                           \
+  TRASE_DISPATCH_RECORDER                                                      \
   TRASE_DISPATCH_GL                                                            \
   TRASE_DISPATCH_LEGEND_SVG                                                    \
+  TRASE_DISPATCH_LEGEND_RECORDER                                               \
   TRASE_DISPATCH_LEGEND_GL
 
 #include "frontend/Geometry.tcc"
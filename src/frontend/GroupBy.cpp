@@ -0,0 +1,217 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frontend/GroupBy.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "util/Parallel.hpp"
+
+namespace trase {
+
+namespace {
+
+/// number of rows processed together by the group by kernel
+const int group_block_size = 1 << 16;
+
+/// open addressing hash table of groups, using linear probing. Empty slots
+/// have a count of zero
+class GroupTable {
+  std::vector<GroupBy::Group> m_slots;
+  int m_size{0};
+  int m_bits;
+
+public:
+  GroupTable() : m_slots(std::size_t(1) << 10, empty()), m_bits(10) {}
+
+  /// adds a row with @p key and @p value
+  void add(const float key, const float value) {
+    GroupBy::Group &group = find(key);
+    ++group.count;
+    group.sum += value;
+    group.min = std::min(group.min, value);
+    group.max = std::max(group.max, value);
+  }
+
+  /// adds all the rows of @p other
+  void merge(const GroupTable &other) {
+    for (const auto &other_group : other.m_slots) {
+      if (other_group.count > 0) {
+        GroupBy::Group &group = find(other_group.key);
+        group.count += other_group.count;
+        group.sum += other_group.sum;
+        group.min = std::min(group.min, other_group.min);
+        group.max = std::max(group.max, other_group.max);
+      }
+    }
+  }
+
+  /// returns the groups, ordered by key
+  std::vector<GroupBy::Group> groups() const {
+    std::vector<GroupBy::Group> result;
+    result.reserve(m_size);
+    std::copy_if(m_slots.begin(), m_slots.end(), std::back_inserter(result),
+                 [](const GroupBy::Group &group) { return group.count > 0; });
+    std::sort(result.begin(), result.end(),
+              [](const GroupBy::Group &a, const GroupBy::Group &b) {
+                return a.key < b.key;
+              });
+    return result;
+  }
+
+private:
+  static GroupBy::Group empty() {
+    return {0.f, 0, 0.0, std::numeric_limits<float>::max(),
+            -std::numeric_limits<float>::max()};
+  }
+
+  /// fibonacci hash of the bits of @p key
+  std::size_t slot(const float key) const {
+    std::uint32_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return static_cast<std::size_t>(
+        (bits * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - m_bits));
+  }
+
+  /// returns the group with @p key, inserting an empty group if needed
+  GroupBy::Group &find(float key) {
+    // -0 and +0 are the same key
+    key += 0.f;
+    if (2 * (m_size + 1) > static_cast<int>(m_slots.size())) {
+      grow();
+    }
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = slot(key);; i = (i + 1) & mask) {
+      GroupBy::Group &group = m_slots[i];
+      if (group.count == 0) {
+        group.key = key;
+        ++m_size;
+        return group;
+      }
+      if (group.key == key) {
+        return group;
+      }
+    }
+  }
+
+  void grow() {
+    std::vector<GroupBy::Group> old(m_slots.size() * 2, empty());
+    old.swap(m_slots);
+    ++m_bits;
+    const std::size_t mask = m_slots.size() - 1;
+    for (const auto &group : old) {
+      if (group.count > 0) {
+        std::size_t i = slot(group.key);
+        while (m_slots[i].count > 0) {
+          i = (i + 1) & mask;
+        }
+        m_slots[i] = group;
+      }
+    }
+  }
+};
+
+} // namespace
+
+GroupBy::GroupBy(const float width) : m_width(width) {}
+
+std::vector<GroupBy::Group>
+GroupBy::aggregate(const DataWithAesthetic &data) const {
+  auto key = data.begin<Aesthetic::x>();
+  const bool have_value = m_statistic != Statistic::count;
+  auto value = have_value ? m_value_begin(data) : key;
+  auto valid = data.valid<Aesthetic::x>();
+  if (have_value) {
+    valid = valid & m_value_valid(data);
+  }
+  const int rows = valid.size();
+
+  std::vector<GroupTable> tables(
+      parallel_threads(parallel_blocks(rows, group_block_size)));
+  parallel_for_blocks(
+      rows, group_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &table = tables[thread];
+        if (have_value) {
+          valid.for_each_valid(begin, end, [&](const int i) {
+            table.add(key[i], value[i]);
+          });
+        } else {
+          valid.for_each_valid(begin, end,
+                               [&](const int i) { table.add(key[i], 0.f); });
+        }
+      });
+
+  for (std::size_t i = 1; i < tables.size(); ++i) {
+    tables[0].merge(tables[i]);
+  }
+  return tables.empty() ? std::vector<Group>() : tables[0].groups();
+}
+
+DataWithAesthetic GroupBy::operator()(const DataWithAesthetic &data) const {
+  const auto groups = aggregate(data);
+  const int n = static_cast<int>(groups.size());
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  std::vector<float> xmin(n);
+  std::vector<float> xmax(n);
+  std::vector<float> ymin(n, 0.f);
+  for (int i = 0; i < n; ++i) {
+    const Group &group = groups[i];
+    x[i] = group.key;
+    xmin[i] = group.key - 0.5f * m_width;
+    xmax[i] = group.key + 0.5f * m_width;
+    switch (m_statistic) {
+    case Statistic::count:
+      y[i] = static_cast<float>(group.count);
+      break;
+    case Statistic::sum:
+      y[i] = static_cast<float>(group.sum);
+      break;
+    case Statistic::mean:
+      y[i] = static_cast<float>(group.sum / group.count);
+      break;
+    case Statistic::min:
+      y[i] = group.min;
+      break;
+    case Statistic::max:
+      y[i] = group.max;
+      break;
+    }
+  }
+  return create_data().x(x).y(y).xmin(xmin).xmax(xmax).ymin(ymin).ymax(y);
+}
+
+} // namespace trase
@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file GroupBy.hpp
+
+#ifndef GROUPBY_H_
+#define GROUPBY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frontend/Data.hpp"
+#include "frontend/TransformCache.hpp"
+
+namespace trase {
+
+/// aggregates a value over the rows sharing each distinct x value (the key)
+///
+/// The rows are aggregated in parallel into thread-local hash tables that are
+/// merged at the end, so the cost is linear in the number of rows. Columns of
+/// strings are dictionary encoded by RawData, so the keys may be either
+/// numbers or strings (in which case the output keys are the string codes).
+/// Rows with a missing key or value are skipped. The output has one row per
+/// group, ordered by key, giving the key in the x aesthetic and the statistic
+/// in the y aesthetic, so that it can be drawn using Axis::points. The bars
+/// from zero to each statistic are also given in the xmin, xmax, ymin and
+/// ymax aesthetics for drawing with Axis::rectangle. Requires x aesthetic,
+/// and the value aesthetic for statistics other than the count.
+class GroupBy {
+public:
+  /// the statistic of each group
+  enum class Statistic {
+    count, ///< number of rows in the group
+    sum,   ///< sum of the value aesthetic over the group
+    mean,  ///< mean of the value aesthetic over the group
+    min,   ///< minimum of the value aesthetic over the group
+    max    ///< maximum of the value aesthetic over the group
+  };
+
+  /// aggregate of the rows in one group
+  struct Group {
+    float key;
+    std::int64_t count;
+    double sum;
+    float min;
+    float max;
+  };
+
+private:
+  Statistic m_statistic{Statistic::count};
+  float m_width;
+  ColumnIterator (*m_value_begin)(const DataWithAesthetic &){nullptr};
+  const ValidityBitmap &(*m_value_valid)(const DataWithAesthetic &){nullptr};
+
+public:
+  /// count the rows in each group, outputting bars of width @p width in data
+  /// coordinates
+  explicit GroupBy(float width = 0.8f);
+
+  /// each group gives the sum of Aesthetic over its rows
+  template <typename Aesthetic> GroupBy &sum() {
+    return value<Aesthetic>(Statistic::sum);
+  }
+
+  /// each group gives the mean of Aesthetic over its rows
+  template <typename Aesthetic> GroupBy &mean() {
+    return value<Aesthetic>(Statistic::mean);
+  }
+
+  /// each group gives the minimum of Aesthetic over its rows
+  template <typename Aesthetic> GroupBy &min() {
+    return value<Aesthetic>(Statistic::min);
+  }
+
+  /// each group gives the maximum of Aesthetic over its rows
+  template <typename Aesthetic> GroupBy &max() {
+    return value<Aesthetic>(Statistic::max);
+  }
+
+  /// returns the aggregate of each group in @p data, ordered by key
+  std::vector<Group> aggregate(const DataWithAesthetic &data) const;
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data) const;
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_statistic, m_width, m_value_begin);
+  }
+
+private:
+  template <typename Aesthetic> GroupBy &value(const Statistic statistic) {
+    m_statistic = statistic;
+    m_value_begin = [](const DataWithAesthetic &data) {
+      return data.begin<Aesthetic>();
+    };
+    m_value_valid =
+        [](const DataWithAesthetic &data) -> const ValidityBitmap & {
+      return data.valid<Aesthetic>();
+    };
+    return *this;
+  }
+};
+
+} // namespace trase
+
+#endif // GROUPBY_H_
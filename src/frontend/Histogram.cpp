@@ -31,6 +31,105 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "frontend/Axis.hpp"
 #include "frontend/Histogram.hpp"
 
-namespace trase {} // namespace trase
+#include <algorithm>
+#include <cmath>
+
+namespace trase {
+
+void Histogram::add_frame(const DataWithAesthetic &data, const float time) {
+  Geometry::add_frame(data, time);
+  add_samples(data);
+}
+
+void Histogram::add_frames(
+    const std::vector<std::pair<DataWithAesthetic, float>> &frames) {
+  Geometry::add_frames(frames);
+  for (const auto &frame : frames) {
+    add_samples(frame.first);
+  }
+}
+
+void Histogram::add_samples(const DataWithAesthetic &data) {
+  if (!m_transform.is<BinX>()) {
+    return;
+  }
+  m_indices.push_back(data.histogram_index<Aesthetic::x>());
+
+  // keep the re-binned frames in step with the frames
+  if (!m_view.empty() && m_view.size() + 1 == m_indices.size()) {
+    m_view.push_back(rebin(*m_indices.back()));
+  } else {
+    m_view.clear();
+  }
+}
+
+DataWithAesthetic Histogram::rebin(const HistogramIndex &index) const {
+  const float min = m_view_limits.bmin[Aesthetic::x::index];
+  const float max = m_view_limits.bmax[Aesthetic::x::index];
+  const auto counts = index.counts(m_data[0].rows(), min, max);
+  std::vector<float> y(counts.begin(), counts.end());
+  DataWithAesthetic frame;
+  frame.x(min, max).y(y);
+  return frame;
+}
+
+void Histogram::set_view(const Limits &limits) {
+  mark_dirty();
+  m_view_limits = limits;
+  m_view.clear();
+  if (m_data.empty() || m_indices.size() != m_data.size()) {
+    return;
+  }
+  for (const auto &index : m_indices) {
+    m_view.push_back(rebin(*index));
+  }
+}
+
+Pick Histogram::pick(const vfloat2_t &pixel, const float max_distance) const {
+  Pick result;
+  const auto &data = m_view.empty() ? m_data : m_view;
+  if (data.empty() || data[0].rows() == 0) {
+    return result;
+  }
+  const int frame = nearest_frame();
+  const int n = data[0].rows();
+  const float x0 = data[0].limits().bmin[Aesthetic::x::index];
+  const float dx = (data[0].limits().bmax[Aesthetic::x::index] - x0) / n;
+  const vfloat2_t point = {m_axis->from_display<Aesthetic::x>(pixel[0]),
+                           m_axis->from_display<Aesthetic::y>(pixel[1])};
+  const vfloat2_t scale = pixel_scale();
+
+  // the range of bins within max_distance of the point along x
+  const float reach = max_distance / scale[0];
+  const float lower = std::floor((point[0] - reach - x0) / dx);
+  const float upper = std::floor((point[0] + reach - x0) / dx);
+  const int first = static_cast<int>(std::max(lower, 0.f));
+  const int last = static_cast<int>(std::min(upper, n - 1.f));
+
+  auto y = data[frame].begin<Aesthetic::y>();
+  float best = max_distance * max_distance;
+  for (int i = first; i <= last; ++i) {
+    const float bar_x = std::max(std::max(x0 + i * dx - point[0],
+                                          point[0] - x0 - (i + 1) * dx),
+                                 0.f) *
+                        scale[0];
+    const float bar_y = std::max(std::max(std::min(y[i], 0.f) - point[1],
+                                          point[1] - std::max(y[i], 0.f)),
+                                 0.f) *
+                        scale[1];
+    const float d2 = bar_x * bar_x + bar_y * bar_y;
+    if (d2 < best || (!result && d2 <= best)) {
+      best = d2;
+      result.geometry = this;
+      result.frame = frame;
+      result.row = i;
+      result.distance = std::sqrt(d2);
+    }
+  }
+  return result;
+}
+
+} // namespace trase
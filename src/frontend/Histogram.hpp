@@ -36,6 +36,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef HISTOGRAM_H_
 #define HISTOGRAM_H_
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "frontend/Geometry.hpp"
 
 namespace trase {
@@ -50,12 +54,45 @@ namespace trase {
 /// Default Transform:
 ///   - BinX
 class Histogram : public Geometry {
+  /// the histogram index of the x samples of each frame, kept if the
+  /// transform is BinX so that the histogram can be re-binned over the
+  /// visible range.
+  ///
+  /// Memory: the index is a sorted copy of the valid x values (4 bytes per
+  /// sample), built when the frame is added and shared with the index cached
+  /// by the data. The samples themselves (the other columns of the data) are
+  /// not kept alive
+  std::vector<std::shared_ptr<const HistogramIndex>> m_indices;
+
+  /// the frames re-binned over the visible range, empty if the view has not
+  /// been changed (or cannot be re-binned), otherwise one per frame
+  std::vector<DataWithAesthetic> m_view;
+
+  /// the limits given to the last call of set_view()
+  Limits m_view_limits;
+
 public:
   /// create a new Histogram, connecting it to the @p parent
   explicit Histogram(Axis *parent) : Geometry(parent) {}
   virtual ~Histogram() = default;
   TRASE_GEOMETRY_DISPATCH_BACKENDS
 
+  void add_frame(const DataWithAesthetic &data, float time) override;
+
+  /// add many frames, keeping their samples as for add_frame()
+  void add_frames(const std::vector<std::pair<DataWithAesthetic, float>>
+                      &frames) override;
+
+  /// re-bin each frame over the visible x range of @p limits, with the same
+  /// number of bins. The counts come from the histogram index of the samples
+  /// (built when the frame was added), so the samples are not scanned.
+  /// Frames added afterwards are re-binned over the same range
+  void set_view(const Limits &limits) override;
+
+  /// pick the bar nearest to @p pixel. The bins are regularly spaced, so
+  /// only the bars within @p max_distance along x are checked
+  Pick pick(const vfloat2_t &pixel, float max_distance) const override;
+
   /// draw the full histogram animation using the AnimatedBackend
   ///
   /// @param backend the AnimatedBackend to use when drawing
@@ -81,10 +118,28 @@ public:
   void draw_legend(Backend &backend, float time, const bfloat2_t &box);
 
 private:
+  /// index the samples of @p data, and re-bin them if the view is active
+  void add_samples(const DataWithAesthetic &data);
+
+  /// returns the frame given by re-binning the samples of @p index over the
+  /// view
+  DataWithAesthetic rebin(const HistogramIndex &index) const;
+
   template <typename AnimatedBackend>
   void draw_frames(AnimatedBackend &backend);
   template <typename Backend> void draw_plot(Backend &backend);
   template <typename Backend> void draw_highlights(Backend &backend);
+
+  /// returns true if any of the bar @p bar (in pixels), including its
+  /// stroke, is within the axis
+  bool bar_in_view(const bfloat2_t &bar) const {
+    const float stroke = 0.5f * m_style.line_width();
+    return in_view(bfloat2_t(
+        vfloat2_t(std::min(bar.bmin[0], bar.bmax[0]) - stroke,
+                  std::min(bar.bmin[1], bar.bmax[1]) - stroke),
+        vfloat2_t(std::max(bar.bmin[0], bar.bmax[0]) + stroke,
+                  std::max(bar.bmin[1], bar.bmax[1]) + stroke)));
+  }
 };
 
 } // namespace trase
@@ -74,15 +74,24 @@ void Histogram::draw_frames(AnimatedBackend &backend) {
   const float dx =
       (m_data[0].limits().bmax[Aesthetic::x::index] - x0) / m_data[0].rows();
 
+  std::vector<bfloat2_t> bars(m_times.size());
   for (int i = 0; i < m_data[0].rows(); ++i) {
+    // skip bars that are outside the axis in every frame
+    bool visible = false;
     for (size_t f = 0; f < m_times.size(); ++f) {
       auto y_data = m_data[f].begin<Aesthetic::y>()[i];
       auto y_min = m_axis->to_display<Aesthetic::y>(y_data);
       auto y_max = m_axis->to_display<Aesthetic::y>(0.f);
       auto x_min = m_axis->to_display<Aesthetic::x>(i * dx + x0);
       auto x_max = m_axis->to_display<Aesthetic::x>((i + 1.f) * dx + x0);
-      backend.add_animated_rect(bfloat2_t({x_min, y_min}, {x_max, y_max}),
-                                m_times[f]);
+      bars[f] = bfloat2_t({x_min, y_min}, {x_max, y_max});
+      visible = visible || bar_in_view(bars[f]);
+    }
+    if (!visible) {
+      continue;
+    }
+    for (size_t f = 0; f < m_times.size(); ++f) {
+      backend.add_animated_rect(bars[f], m_times[f]);
     }
     backend.end_animated_rect();
   }
@@ -98,34 +107,48 @@ template <typename Backend> void Histogram::draw_plot(Backend &backend) {
   backend.stroke_width(m_style.line_width());
   backend.fill_color(m_style.color());
 
+  // draw the frames re-binned over the visible range, if there are any
+  const auto &data = m_view.empty() ? m_data : m_view;
+
   // x should be constant and regular spaced with a dx calculated by the limits
   // and the number of rows
-  const float x0 = m_data[0].limits().bmin[Aesthetic::x::index];
+  const float x0 = data[0].limits().bmin[Aesthetic::x::index];
   const float dx =
-      (m_data[0].limits().bmax[Aesthetic::x::index] - x0) / m_data[0].rows();
+      (data[0].limits().bmax[Aesthetic::x::index] - x0) / data[0].rows();
+
+  // the visible bars of the frame, submitted to the backend together
+  std::vector<float> xmins;
+  std::vector<float> ymins;
+  std::vector<float> xmaxs;
+  std::vector<float> ymaxs;
+  auto add_bar = [&](const int i, const float y_min) {
+    auto x_min = m_axis->to_display<Aesthetic::x>(i * dx + x0);
+    auto x_max = m_axis->to_display<Aesthetic::x>((i + 1.f) * dx + x0);
+    auto y_max = m_axis->to_display<Aesthetic::y>(0.f);
+    if (bar_in_view(bfloat2_t({x_min, y_min}, {x_max, y_max}))) {
+      xmins.push_back(x_min);
+      ymins.push_back(y_min);
+      xmaxs.push_back(x_max);
+      ymaxs.push_back(y_max);
+    }
+  };
 
   if (w2 == 0.0f) {
     // exactly on a single frame
-    auto y_data = m_data[f].begin<Aesthetic::y>();
-    for (int i = 0; i < m_data[0].rows(); ++i) {
-      auto x_min = m_axis->to_display<Aesthetic::x>(i * dx + x0);
-      auto x_max = m_axis->to_display<Aesthetic::x>((i + 1.f) * dx + x0);
-      auto y_min = m_axis->to_display<Aesthetic::y>(y_data[i]);
-      auto y_max = m_axis->to_display<Aesthetic::y>(0.f);
-      backend.rect(bfloat2_t({x_min, y_min}, {x_max, y_max}));
+    auto y_data = data[f].begin<Aesthetic::y>();
+    for (int i = 0; i < data[0].rows(); ++i) {
+      add_bar(i, m_axis->to_display<Aesthetic::y>(y_data[i]));
     }
   } else {
-    auto y0 = m_data[f - 1].begin<Aesthetic::y>();
-    auto y1 = m_data[f].begin<Aesthetic::y>();
-    for (int i = 0; i < m_data[0].rows(); ++i) {
-      auto x_min = m_axis->to_display<Aesthetic::x>(i * dx + x0);
-      auto x_max = m_axis->to_display<Aesthetic::x>((i + 1.f) * dx + x0);
-      auto y_min = w1 * m_axis->to_display<Aesthetic::y>(y1[i]) +
-                   w2 * m_axis->to_display<Aesthetic::y>(y0[i]);
-      auto y_max = m_axis->to_display<Aesthetic::y>(0.f);
-      backend.rect(bfloat2_t({x_min, y_min}, {x_max, y_max}));
+    auto y0 = data[f - 1].begin<Aesthetic::y>();
+    auto y1 = data[f].begin<Aesthetic::y>();
+    for (int i = 0; i < data[0].rows(); ++i) {
+      add_bar(i, w1 * m_axis->to_display<Aesthetic::y>(y1[i]) +
+                     w2 * m_axis->to_display<Aesthetic::y>(y0[i]));
     }
   }
+  backend.rects(static_cast<int>(xmins.size()), xmins.data(), ymins.data(),
+                xmaxs.data(), ymaxs.data());
 }
 
 } // namespace trase
@@ -54,6 +54,17 @@ public:
 
   void add_entry(const std::shared_ptr<Geometry> &entry) {
     m_entries.push_back(entry);
+    mark_dirty();
+  }
+
+  /// returns a number that changes whenever the legend or any of its entries
+  /// change
+  std::size_t version() const override {
+    std::size_t result = m_version;
+    for (const auto &entry : m_entries) {
+      result += entry->version();
+    }
+    return result;
   }
 
   template <typename AnimatedBackend> void draw(AnimatedBackend &backend);
@@ -36,10 +36,196 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef LINE_H_
 #define LINE_H_
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
 #include "frontend/Geometry.hpp"
+#include "util/Simplify.hpp"
 
 namespace trase {
 
+/// Streaming M4 decimation of the points of a line in display coordinates
+///
+/// Jugel, U., Jerzak, Z., Hackenbroich, G. and Markl, V. 2014.
+/// M4: A Visualization-Oriented Time Series Data Aggregation.
+/// Proceedings of the VLDB Endowment, 7(10):797-808.
+///
+/// Consecutive points falling in the same pixel column are reduced to the
+/// first, last, minimum and maximum points, which rasterize to the same
+/// pixels as the full line. Points left or right of the visible range are
+/// grouped into a single column on either side. The kept points are passed
+/// in order to `sink(point, connected)`, where connected is false if the
+/// point starts a new piece of the line (i.e. after a missing value).
+template <typename Sink> class M4Decimator {
+  struct Vertex {
+    int row;
+    vfloat2_t point;
+  };
+
+  Sink m_sink;
+  bool m_enabled;
+  float m_left;
+  float m_right;
+  int m_width;
+
+  bool m_active{false};
+  int m_column{0};
+  Vertex m_first;
+  Vertex m_last;
+  Vertex m_min;
+  Vertex m_max;
+
+  /// row of the last point of the previous group
+  int m_previous_row{-2};
+
+public:
+  /// decimate to the pixel columns of @p pixels, or pass every point
+  /// through if @p enabled is false
+  M4Decimator(Sink sink, const bfloat2_t &pixels, const bool enabled)
+      : m_sink(sink), m_enabled(enabled), m_left(pixels.bmin[0]),
+        m_right(pixels.bmax[0]),
+        m_width(static_cast<int>(std::ceil(pixels.bmax[0] - pixels.bmin[0]))) {
+  }
+
+  /// add the point of row @p row, at @p point in display coordinates
+  void add(const int row, const vfloat2_t &point) {
+    if (!m_enabled) {
+      m_sink(point, row == m_previous_row + 1);
+      m_previous_row = row;
+      return;
+    }
+    const int column = column_of(point[0]);
+    if (m_active && (column != m_column || row != m_last.row + 1)) {
+      flush();
+    }
+    const Vertex vertex{row, point};
+    if (!m_active) {
+      m_active = true;
+      m_column = column;
+      m_first = m_last = m_min = m_max = vertex;
+      return;
+    }
+    m_last = vertex;
+    if (point[1] < m_min.point[1]) {
+      m_min = vertex;
+    }
+    if (point[1] > m_max.point[1]) {
+      m_max = vertex;
+    }
+  }
+
+  /// pass on the points of the current group, call after the last point
+  void flush() {
+    if (!m_active) {
+      return;
+    }
+    Vertex vertices[4] = {m_first, m_min, m_max, m_last};
+    std::sort(std::begin(vertices), std::end(vertices),
+              [](const Vertex &a, const Vertex &b) { return a.row < b.row; });
+    m_sink(vertices[0].point, vertices[0].row == m_previous_row + 1);
+    for (int i = 1; i < 4; ++i) {
+      if (vertices[i].row != vertices[i - 1].row) {
+        m_sink(vertices[i].point, true);
+      }
+    }
+    m_previous_row = m_last.row;
+    m_active = false;
+  }
+
+private:
+  int column_of(const float x) const {
+    if (x < m_left) {
+      return -1;
+    }
+    if (x >= m_right) {
+      return m_width;
+    }
+    return static_cast<int>(x - m_left);
+  }
+};
+
+/// returns a M4Decimator passing points to @p sink
+template <typename Sink>
+M4Decimator<Sink> make_m4_decimator(Sink sink, const bfloat2_t &pixels,
+                                    const bool enabled) {
+  return M4Decimator<Sink>(sink, pixels, enabled);
+}
+
+/// Streaming removal of the points of a line that cannot be seen
+///
+/// Points are passed on to `sink(row, point)` only if one of the segments
+/// joining them to the previous or next row crosses the box @p pixels, or if
+/// the point itself is inside it, so that the visible part of the line is
+/// drawn unchanged. The points kept either side of a run of removed points
+/// are not adjacent rows, so the path is broken there.
+template <typename Sink> class ViewportCuller {
+  Sink m_sink;
+  bfloat2_t m_pixels;
+
+  int m_last_row{-2};
+  vfloat2_t m_last;
+  bool m_last_sent{false};
+
+public:
+  /// pass on the points near the box @p pixels, expanded by @p margin on
+  /// each side (e.g. for the line width)
+  ViewportCuller(Sink sink, const bfloat2_t &pixels, const float margin)
+      : m_sink(sink),
+        m_pixels(pixels.bmin - vfloat2_t::Constant(margin),
+                 pixels.bmax + vfloat2_t::Constant(margin)) {}
+
+  /// add the point of row @p row, at @p point in display coordinates
+  void add(const int row, const vfloat2_t &point) {
+    const bool connected = row == m_last_row + 1;
+    if (connected && crosses(m_last, point)) {
+      if (!m_last_sent) {
+        m_sink(m_last_row, m_last);
+      }
+      m_sink(row, point);
+      m_last_sent = true;
+    } else if (m_pixels.intersects(bfloat2_t(point, point))) {
+      m_sink(row, point);
+      m_last_sent = true;
+    } else {
+      m_last_sent = false;
+    }
+    m_last_row = row;
+    m_last = point;
+  }
+
+private:
+  /// returns true if the segment from @p a to @p b crosses the box, using
+  /// the separating axes of the box and the normal of the segment
+  bool crosses(const vfloat2_t &a, const vfloat2_t &b) const {
+    const bfloat2_t bounds(
+        vfloat2_t(std::min(a[0], b[0]), std::min(a[1], b[1])),
+        vfloat2_t(std::max(a[0], b[0]), std::max(a[1], b[1])));
+    if (!m_pixels.intersects(bounds)) {
+      return false;
+    }
+    const vfloat2_t ab = b - a;
+    int above = 0;
+    int below = 0;
+    for (int corner = 0; corner < 4; ++corner) {
+      const vfloat2_t c = {corner & 1 ? m_pixels.bmax[0] : m_pixels.bmin[0],
+                           corner & 2 ? m_pixels.bmax[1] : m_pixels.bmin[1]};
+      const float side = ab[0] * (c[1] - a[1]) - ab[1] * (c[0] - a[0]);
+      above += side >= 0.f;
+      below += side <= 0.f;
+    }
+    return above > 0 && below > 0;
+  }
+};
+
+/// returns a ViewportCuller passing points to @p sink
+template <typename Sink>
+ViewportCuller<Sink> make_viewport_culler(Sink sink, const bfloat2_t &pixels,
+                                          const float margin) {
+  return ViewportCuller<Sink>(sink, pixels, margin);
+}
+
 /// A single line made up of one or more points connected by straight lines
 ///
 /// Aesthetics:
@@ -49,6 +235,19 @@ namespace trase {
 /// Default Transform:
 ///   - Identity 
 class Line : public Geometry {
+public:
+  /// how the points of the line are reduced before drawing
+  enum class Decimation {
+    none, ///< draw every point
+    m4    ///< keep the first, last, minimum and maximum point in each pixel
+          ///< column of the axis, which draws identical pixels with at most
+          ///< four points per column (see M4Decimator)
+  };
+
+private:
+  Decimation m_decimation{Decimation::none};
+  float m_simplification{0.f};
+
 public:
   /// create a new Line, connecting it to the @p parent
   explicit Line(Axis *parent) : Geometry(parent) {}
@@ -56,6 +255,31 @@ public:
 
   TRASE_GEOMETRY_DISPATCH_BACKENDS
 
+  /// set how the points of the line are reduced before drawing. Decimation
+  /// is done against the current limits of the axis each time the line is
+  /// drawn, so it follows any pan or zoom. Lines with more than one frame are
+  /// not decimated when drawn by an AnimatedBackend, which needs the same
+  /// path commands in every frame
+  void set_decimation(Decimation decimation) {
+    m_decimation = decimation;
+    mark_dirty();
+  }
+
+  Decimation get_decimation() const { return m_decimation; }
+
+  /// simplify the line with the Douglas-Peucker algorithm so that it moves
+  /// by no more than @p pixels pixels (e.g. 0.5), removing the many nearly
+  /// collinear points of smooth curves. Like decimation (which is done
+  /// first), this is done in display coordinates each time the line is drawn
+  /// (except for animations, as for decimation). A tolerance of zero (the
+  /// default) keeps every point
+  void set_simplification(float pixels) {
+    m_simplification = pixels;
+    mark_dirty();
+  }
+
+  float get_simplification() const { return m_simplification; }
+
   /// draw the full line animation using the AnimatedBackend
   ///
   /// @param backend the AnimatedBackend to use when drawing
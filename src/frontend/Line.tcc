@@ -77,32 +77,102 @@ void Line::draw_frames(AnimatedBackend &backend) {
                      m_axis->to_display<Aesthetic::y>(y)};
   };
 
-  // find maximum length of all datasets
-  // AnimatedBackend requires that an animated path be the same number of
-  // points. Therefore we will find the maximum line length needed, and, for
-  // shorter lines, simply repeat the last point the required number of times
-  const int n =
-      std::accumulate(m_data.begin(), m_data.end(), 0,
-                      [](int a, auto b) { return std::max(a, b.rows()); });
-
-  auto x = m_data[0].begin<Aesthetic::x>();
-  auto y = m_data[0].begin<Aesthetic::y>();
-  backend.move_to(to_pixel(x[0], y[0]));
-  for (int i = 1; i < n; ++i) {
-    const int clip_i = std::min(m_data[0].rows() - 1, i);
-    backend.line_to(to_pixel(x[clip_i], y[clip_i]));
+  // a single frame is not interpolated, so it can be culled, decimated and
+  // simplified like a snapshot
+  if (m_times.size() == 1) {
+    auto x = m_data[0].begin<Aesthetic::x>();
+    auto y = m_data[0].begin<Aesthetic::y>();
+    const auto valid =
+        m_data[0].valid<Aesthetic::x>() & m_data[0].valid<Aesthetic::y>();
+    auto simplifier = make_polyline_simplifier(
+        [&](const vfloat2_t &point, const bool connected) {
+          if (connected) {
+            backend.line_to(point);
+          } else {
+            backend.move_to(point);
+          }
+        },
+        m_simplification);
+    auto decimator = make_m4_decimator(
+        [&](const vfloat2_t &point, const bool connected) {
+          simplifier.add(point, connected);
+        },
+        m_axis->pixels(), m_decimation == Decimation::m4);
+    auto culler = make_viewport_culler(
+        [&](const int i, const vfloat2_t &point) { decimator.add(i, point); },
+        m_axis->pixels(), m_style.line_width());
+    valid.for_each_valid(
+        [&](const int i) { culler.add(i, to_pixel(x[i], y[i])); });
+    decimator.flush();
+    simplifier.flush();
+    backend.end_animated_path(m_times.back());
+    return;
   }
 
-  // other frames
-  for (size_t f = 1; f < m_times.size(); ++f) {
+  // AnimatedBackend interpolates between frames, which requires every frame
+  // to be a path of the same commands. Every row (up to the longest frame)
+  // is drawn without culling, decimation or simplification, which would
+  // remove different points in each frame. A missing point is placed on
+  // the last valid point before it. Where the path is broken before a row
+  // in any frame, the row is drawn in every frame as a line to the point
+  // (or, in frames broken there, back to the previous point) followed by a
+  // move to the point
+  int rows = 0;
+  for (const auto &data : m_data) {
+    rows = std::max(rows, data.rows());
+  }
+  auto frame_valid = [&](const size_t f) {
+    return m_data[f].valid<Aesthetic::x>() & m_data[f].valid<Aesthetic::y>();
+  };
+  std::vector<char> broken(rows, 0);
+  for (size_t f = 0; f < m_times.size(); ++f) {
+    const auto valid = frame_valid(f);
+    const int frame_rows = m_data[f].rows();
+    for (int i = 1; i < rows; ++i) {
+      if (i >= frame_rows || !valid.test(i - 1) || !valid.test(i)) {
+        broken[i] = 1;
+      }
+    }
+  }
+
+  auto draw_frame = [&](const size_t f) {
     auto x = m_data[f].begin<Aesthetic::x>();
     auto y = m_data[f].begin<Aesthetic::y>();
-    backend.add_animated_path(m_times[f - 1]);
-    backend.move_to(to_pixel(x[0], y[0]));
-    for (int i = 1; i < n; ++i) {
-      const int clip_i = std::min(m_data[f].rows() - 1, i);
-      backend.line_to(to_pixel(x[clip_i], y[clip_i]));
+    const auto valid = frame_valid(f);
+    const int frame_rows = m_data[f].rows();
+    auto is_valid = [&](const int i) {
+      return i < frame_rows && valid.test(i);
+    };
+
+    // rows before the first valid point are placed on it
+    vfloat2_t previous = m_axis->pixels().bmin;
+    for (int i = 0; i < frame_rows; ++i) {
+      if (valid.test(i)) {
+        previous = to_pixel(x[i], y[i]);
+        break;
+      }
     }
+
+    for (int i = 0; i < rows; ++i) {
+      const vfloat2_t point = is_valid(i) ? to_pixel(x[i], y[i]) : previous;
+      if (i == 0) {
+        backend.move_to(point);
+      } else if (!broken[i]) {
+        backend.line_to(point);
+      } else {
+        backend.line_to(is_valid(i - 1) && is_valid(i) ? point : previous);
+        backend.move_to(point);
+      }
+      previous = point;
+    }
+  };
+
+  draw_frame(0);
+
+  // other frames
+  for (size_t f = 1; f < m_times.size(); ++f) {
+    backend.add_animated_path(m_times[f - 1]);
+    draw_frame(f);
   }
 
   backend.end_animated_path(m_times.back());
@@ -121,15 +191,20 @@ void Line::draw_anim_highlights(AnimatedBackend &backend) {
 
     auto x = m_data[0].begin<Aesthetic::x>();
     auto y = m_data[0].begin<Aesthetic::y>();
-    for (int i = 0; i < m_data[0].rows(); ++i) {
+    const auto valid =
+        m_data[0].valid<Aesthetic::x>() & m_data[0].valid<Aesthetic::y>();
+    valid.for_each_valid([&](const int i) {
       vfloat2_t point = {x[i], y[i]};
       vfloat2_t point_pixel = {m_axis->to_display<Aesthetic::x>(x[i]),
                                m_axis->to_display<Aesthetic::y>(y[i])};
+      if (!in_view(bfloat2_t(point_pixel, point_pixel))) {
+        return;
+      }
       std::snprintf(buffer, sizeof(buffer), "(%f,%f)", point[0], point[1]);
       backend.tooltip(
           point_pixel + 2.f * vfloat2_t(m_style.line_width(), -m_style.line_width()), buffer);
       backend.circle(point_pixel, 2 * m_style.line_width());
-    }
+    });
     backend.clear_tooltip();
   }
 }
@@ -146,31 +221,69 @@ template <typename Backend> void Line::draw_plot(Backend &backend) {
                      m_axis->to_display<Aesthetic::y>(y)};
   };
 
+  // points are connected only if they are adjacent rows, so that the path is
+  // broken wherever there are missing values or points removed by the culler.
+  // Each connected piece is passed to the backend as a single polyline
+  std::vector<float> xs;
+  std::vector<float> ys;
+  auto add_polyline = [&]() {
+    backend.polyline(static_cast<int>(xs.size()), xs.data(), ys.data());
+    xs.clear();
+    ys.clear();
+  };
+  auto simplifier = make_polyline_simplifier(
+      [&](const vfloat2_t &point, const bool connected) {
+        if (!connected) {
+          add_polyline();
+        }
+        xs.push_back(point[0]);
+        ys.push_back(point[1]);
+      },
+      m_simplification);
+  auto decimator = make_m4_decimator(
+      [&](const vfloat2_t &point, const bool connected) {
+        simplifier.add(point, connected);
+      },
+      m_axis->pixels(), m_decimation == Decimation::m4);
+  auto culler = make_viewport_culler(
+      [&](const int i, const vfloat2_t &point) { decimator.add(i, point); },
+      m_axis->pixels(), m_style.line_width());
+  auto add_point = [&](const int i, const vfloat2_t &point) {
+    culler.add(i, point);
+  };
+
   if (w2 == 0.0f) {
     // exactly on a single frame
     auto x = m_data[f].begin<Aesthetic::x>();
     auto y = m_data[f].begin<Aesthetic::y>();
-    backend.move_to(to_pixel(x[0], y[0]));
-    for (int i = 1; i < m_data[0].rows(); ++i) {
-      backend.line_to(to_pixel(x[i], y[i]));
-    }
+    const auto valid =
+        m_data[f].valid<Aesthetic::x>() & m_data[f].valid<Aesthetic::y>();
+    valid.for_each_valid(
+        [&](const int i) { add_point(i, to_pixel(x[i], y[i])); });
   } else {
     // between two frames
     auto x0 = m_data[f - 1].begin<Aesthetic::x>();
     auto y0 = m_data[f - 1].begin<Aesthetic::y>();
     auto x1 = m_data[f].begin<Aesthetic::x>();
     auto y1 = m_data[f].begin<Aesthetic::y>();
-    backend.move_to(w1 * to_pixel(x1[0], y1[0]) + w2 * to_pixel(x0[0], y0[0]));
-    const int last_i = std::min(m_data[f - 1].rows(), m_data[f].rows());
-    for (int i = 1; i < last_i; ++i) {
-      backend.line_to(w1 * to_pixel(x1[i], y1[i]) +
-                      w2 * to_pixel(x0[i], y0[i]));
-    }
-    if (m_data[f].rows() > last_i) {
-      backend.line_to(w1 * to_pixel(x1[last_i], y1[last_i]) +
-                      w2 * to_pixel(x0[last_i - 1], y0[last_i - 1]));
+    const auto valid0 = m_data[f - 1].valid<Aesthetic::x>() &
+                        m_data[f - 1].valid<Aesthetic::y>();
+    const auto valid1 =
+        m_data[f].valid<Aesthetic::x>() & m_data[f].valid<Aesthetic::y>();
+    const auto valid = valid0 & valid1;
+    const int last_i = valid.size();
+    valid.for_each_valid([&](const int i) {
+      add_point(i, w1 * to_pixel(x1[i], y1[i]) + w2 * to_pixel(x0[i], y0[i]));
+    });
+    if (last_i > 0 && m_data[f].rows() > last_i && valid1.test(last_i) &&
+        valid0.test(last_i - 1)) {
+      add_point(last_i, w1 * to_pixel(x1[last_i], y1[last_i]) +
+                            w2 * to_pixel(x0[last_i - 1], y0[last_i - 1]));
     }
   }
+  decimator.flush();
+  simplifier.flush();
+  add_polyline();
 
   backend.stroke_color(m_style.color());
   backend.stroke_width(m_style.line_width());
@@ -179,55 +292,36 @@ template <typename Backend> void Line::draw_plot(Backend &backend) {
 
 template <typename Backend> void Line::draw_highlights(Backend &backend) {
 
-  // get mouse position
-  auto pos = vfloat2_t(std::numeric_limits<float>::max(),
-                       std::numeric_limits<float>::max());
-  auto mouse_pos = pos;
-
-  if (backend.is_interactive()) {
-    mouse_pos = backend.get_mouse_pos();
-    if ((mouse_pos > m_pixels.bmin).all() &&
-        (mouse_pos < m_pixels.bmax).all()) {
-      pos = {m_axis->from_display<Aesthetic::x>(mouse_pos[0]),
-             m_axis->from_display<Aesthetic::x>(mouse_pos[1])};
-    }
-  }
-
   // highlight mouse-over point if exactly on a frame (i.e. stationary line)
-  if (m_frame_info.w2 == 0.f) {
-    float min_r2 = std::numeric_limits<float>::max();
-    vfloat2_t min_point{};
-    // exactly on a frame
-    auto x = m_data[m_frame_info.frame_above].begin<Aesthetic::x>();
-    auto y = m_data[m_frame_info.frame_above].begin<Aesthetic::y>();
-    for (int i = 0; i < m_data[0].rows(); ++i) {
-      const vfloat2_t point = {x[i], y[i]};
-      auto point_r2 = (point - pos).squaredNorm();
-      if (point_r2 < min_r2) {
-        min_point = point;
-        min_r2 = point_r2;
-      }
-    }
+  if (!backend.is_interactive() || m_frame_info.w2 != 0.f) {
+    return;
+  }
+  const vfloat2_t mouse_pos = backend.get_mouse_pos();
+  if (!(mouse_pos > m_pixels.bmin).all() ||
+      !(mouse_pos < m_pixels.bmax).all()) {
+    return;
+  }
 
-    // define search radius
-    const vfloat2_t point_pixel = {
-        m_axis->to_display<Aesthetic::x>(min_point[0]),
-        m_axis->to_display<Aesthetic::x>(min_point[1])};
-
-    // if a point is within r2, then draw it
-    if ((mouse_pos - point_pixel).squaredNorm() <
-        std::pow(2.f * m_style.line_width(), 2)) {
-      backend.fill_color(m_style.color());
-      backend.text_align(ALIGN_LEFT | ALIGN_BOTTOM);
-      char buffer[100];
-      std::snprintf(buffer, sizeof(buffer), "(%f,%f)", min_point[0],
-                    min_point[1]);
-      backend.circle(point_pixel, m_style.line_width() * 2);
-      backend.fill_color(RGBA(0, 0, 0, 255));
-      backend.text(point_pixel + 2.f * vfloat2_t(m_style.line_width(), -m_style.line_width()),
-                   buffer, nullptr);
-    }
+  // find the nearest point within the highlight radius
+  const Pick picked = pick(mouse_pos, 2.f * m_style.line_width());
+  if (!picked) {
+    return;
   }
+  const auto &data = m_data[picked.frame];
+  const vfloat2_t point = {data.begin<Aesthetic::x>()[picked.row],
+                           data.begin<Aesthetic::y>()[picked.row]};
+  const vfloat2_t point_pixel = {m_axis->to_display<Aesthetic::x>(point[0]),
+                                 m_axis->to_display<Aesthetic::y>(point[1])};
+
+  backend.fill_color(m_style.color());
+  backend.text_align(ALIGN_LEFT | ALIGN_BOTTOM);
+  char buffer[100];
+  std::snprintf(buffer, sizeof(buffer), "(%f,%f)", point[0], point[1]);
+  backend.circle(point_pixel, m_style.line_width() * 2);
+  backend.fill_color(RGBA(0, 0, 0, 255));
+  backend.text(point_pixel +
+                   2.f * vfloat2_t(m_style.line_width(), -m_style.line_width()),
+               buffer, nullptr);
 }
 
 } // namespace trase
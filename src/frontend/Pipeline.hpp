@@ -0,0 +1,373 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Pipeline.hpp
+/// Composable transforms that are fused into a single pass over the data
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "frontend/Data.hpp"
+#include "util/Exception.hpp"
+#include "util/Parallel.hpp"
+
+namespace trase {
+
+/// A transform built from a chain of stages, e.g.
+///
+///     filter<Aesthetic::x>(is_positive) | bin<Aesthetic::x>(50) | normalize()
+///
+/// The chain is made of row stages (filters, combined with a logical and),
+/// followed by a single sink (either collecting the selected rows, or binning
+/// them), followed by output stages that act on the (small) binned output.
+/// Each stage is a template parameter, so the row stages are inlined into the
+/// sink's loop and the input is read in a single parallel pass, without
+/// creating intermediate DataWithAesthetic objects. A Pipeline can be used
+/// anywhere a Transform is accepted.
+template <typename Filter, typename Sink, typename Output> class Pipeline {
+  Filter m_filter;
+  Sink m_sink;
+  Output m_output;
+
+public:
+  Pipeline(Filter filter, Sink sink, Output output)
+      : m_filter(std::move(filter)), m_sink(std::move(sink)),
+        m_output(std::move(output)) {}
+
+  const Filter &filter() const { return m_filter; }
+  const Sink &sink() const { return m_sink; }
+  const Output &output() const { return m_output; }
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data) const {
+    return m_sink.run(data, m_filter.bind(data), m_output);
+  }
+};
+
+namespace pipeline {
+
+/// number of rows processed together by the pipeline kernels, a multiple of
+/// the validity bitmap word size
+const int block_size = 1 << 16;
+
+/// row stage that accepts every row
+struct AcceptAll {
+  struct Bound {
+    bool operator()(int) const { return true; }
+  };
+  Bound bind(const DataWithAesthetic &) const { return {}; }
+};
+
+/// row stage that accepts rows where Predicate(value of Aesthetic) is true.
+/// Rows with a missing value are rejected
+template <typename Aesthetic, typename Predicate> struct Filter {
+  Predicate predicate;
+
+  struct Bound {
+    ColumnIterator column;
+    const ValidityBitmap *valid;
+    Predicate predicate;
+    bool operator()(const int i) const {
+      return valid->test(i) && predicate(column[i]);
+    }
+  };
+  Bound bind(const DataWithAesthetic &data) const {
+    return {data.begin<Aesthetic>(), &data.valid<Aesthetic>(), predicate};
+  }
+};
+
+/// row stage that accepts rows accepted by both First and Second
+template <typename First, typename Second> struct And {
+  First first;
+  Second second;
+
+  struct Bound {
+    typename First::Bound first;
+    typename Second::Bound second;
+    bool operator()(const int i) const { return first(i) && second(i); }
+  };
+  Bound bind(const DataWithAesthetic &data) const {
+    return {first.bind(data), second.bind(data)};
+  }
+};
+
+/// output stage that does nothing
+struct NoOutput {
+  void operator()(std::vector<float> &, float) const {}
+};
+
+/// output stage applying First then Second
+template <typename First, typename Second> struct Then {
+  First first;
+  Second second;
+  void operator()(std::vector<float> &y, const float dx) const {
+    first(y, dx);
+    second(y, dx);
+  }
+};
+
+/// copies the value of Aesthetic for each selected row to @p out, if Aesthetic
+/// is set
+template <typename Aesthetic>
+void collect_column(const DataWithAesthetic &data,
+                    const std::vector<int> &rows, DataWithAesthetic &out) {
+  if (!data.has<Aesthetic>()) {
+    return;
+  }
+  auto column = data.begin<Aesthetic>();
+  std::vector<float> values(rows.size());
+  std::transform(rows.begin(), rows.end(), values.begin(),
+                 [&](const int i) { return column[i]; });
+  out.set<Aesthetic>(values);
+}
+
+/// sink that outputs the selected rows of every aesthetic
+struct Collect {
+  template <typename Bound, typename Output>
+  DataWithAesthetic run(const DataWithAesthetic &data, const Bound &filter,
+                        const Output &) const {
+    // select rows per block, then concatenate the blocks in order
+    const int rows = data.rows();
+    std::vector<std::vector<int>> selected(parallel_blocks(rows, block_size));
+    parallel_for_blocks(
+        rows, block_size,
+        [&](const int, const int block, const int begin, const int end) {
+          for (int i = begin; i < end; ++i) {
+            if (filter(i)) {
+              selected[block].push_back(i);
+            }
+          }
+        });
+    std::vector<int> selected_rows;
+    for (const auto &block : selected) {
+      selected_rows.insert(selected_rows.end(), block.begin(), block.end());
+    }
+
+    DataWithAesthetic out;
+    collect_column<Aesthetic::x>(data, selected_rows, out);
+    collect_column<Aesthetic::y>(data, selected_rows, out);
+    collect_column<Aesthetic::color>(data, selected_rows, out);
+    collect_column<Aesthetic::size>(data, selected_rows, out);
+    collect_column<Aesthetic::fill>(data, selected_rows, out);
+    collect_column<Aesthetic::xmin>(data, selected_rows, out);
+    collect_column<Aesthetic::ymin>(data, selected_rows, out);
+    collect_column<Aesthetic::xmax>(data, selected_rows, out);
+    collect_column<Aesthetic::ymax>(data, selected_rows, out);
+    return out;
+  }
+};
+
+/// sink that bins the value of Aesthetic for the selected rows into regular
+/// bins, giving output in the same form as BinX
+template <typename Aesthetic> struct Bin {
+  int number_of_bins;
+  float min;
+  float max;
+
+  template <typename Bound, typename Output>
+  DataWithAesthetic run(const DataWithAesthetic &data, const Bound &filter,
+                        const Output &output) const {
+    auto x = data.begin<Aesthetic>();
+    const ValidityBitmap &valid = data.valid<Aesthetic>();
+    const int rows = valid.size();
+    const int number_of_blocks = parallel_blocks(rows, block_size);
+
+    // calls f(i) for each selected row i in [begin, end)
+    auto for_each_selected = [&](const int begin, const int end, auto f) {
+      valid.for_each_valid(begin, end, [&](const int i) {
+        if (filter(i)) {
+          f(i);
+        }
+      });
+    };
+
+    float bmin = min;
+    float bmax = max;
+    if (!(bmin < bmax)) {
+      // span of the selected rows, combined in block order
+      std::vector<bfloat2_t> block_span(number_of_blocks);
+      parallel_for_blocks(
+          rows, block_size,
+          [&](const int, const int block, const int begin, const int end) {
+            auto &span = block_span[block];
+            for_each_selected(begin, end, [&](const int i) {
+              span.bmin[0] = std::min(span.bmin[0], x[i]);
+              span.bmax[0] = std::max(span.bmax[0], x[i]);
+            });
+          });
+      bmin = std::numeric_limits<float>::max();
+      bmax = -std::numeric_limits<float>::max();
+      for (const auto &span : block_span) {
+        bmin = std::min(bmin, span.bmin[0]);
+        bmax = std::max(bmax, span.bmax[0]);
+      }
+      if (bmax < bmin) {
+        // nothing selected, return an empty y aesthetic like BinX
+        return create_data().y(std::vector<float>());
+      }
+
+      // increase the span slightly so round-off doesn't cause points to fall
+      // outside the domain
+      bmin -= 1e4f * std::numeric_limits<float>::epsilon();
+      bmax += 1e4f * std::numeric_limits<float>::epsilon();
+    }
+
+    const int n = number_of_bins;
+    const float dx = (bmax - bmin) / n;
+    const auto n_f = static_cast<float>(n);
+    std::vector<std::vector<int>> thread_bins(
+        parallel_threads(number_of_blocks), std::vector<int>(n + 1));
+    parallel_for_blocks(
+        rows, block_size,
+        [&](const int thread, const int, const int begin, const int end) {
+          auto &bins = thread_bins[thread];
+          for_each_selected(begin, end, [&](const int i) {
+            const float t = (x[i] - bmin) / dx;
+            ++bins[(t >= 0.f && t < n_f) ? static_cast<int>(t) : n];
+          });
+        });
+
+    std::vector<float> y(n);
+    for (int i = 0; i < n; ++i) {
+      std::int64_t count = 0;
+      for (const auto &bins : thread_bins) {
+        count += bins[i];
+      }
+      y[i] = static_cast<float>(count);
+    }
+    output(y, dx);
+
+    // return new data set, making sure to set ymin to zero
+    DataWithAesthetic ret;
+    ret.x(bmin, bmax).y(y);
+    ret.y(0.f, ret.limits().bmax[trase::Aesthetic::y::index]);
+    return ret;
+  }
+};
+
+/// how the binned counts are normalised
+enum class Normalization {
+  density,     ///< the bins integrate to one
+  probability, ///< the bins sum to one
+  max          ///< the largest bin is one
+};
+
+/// output stage that normalises binned counts
+struct Normalize {
+  Normalization mode;
+  void operator()(std::vector<float> &y, const float dx) const {
+    float scale = 0.f;
+    switch (mode) {
+    case Normalization::density:
+      scale = std::accumulate(y.begin(), y.end(), 0.f) * dx;
+      break;
+    case Normalization::probability:
+      scale = std::accumulate(y.begin(), y.end(), 0.f);
+      break;
+    case Normalization::max:
+      scale = y.empty() ? 0.f : *std::max_element(y.begin(), y.end());
+      break;
+    }
+    if (scale > 0.f) {
+      for (auto &i : y) {
+        i /= scale;
+      }
+    }
+  }
+};
+
+} // namespace pipeline
+
+/// a pipeline that keeps the rows where @p predicate is true for the value of
+/// Aesthetic
+template <typename Aesthetic, typename Predicate>
+Pipeline<pipeline::Filter<Aesthetic, Predicate>, pipeline::Collect,
+         pipeline::NoOutput>
+filter(Predicate predicate) {
+  return {{predicate}, {}, {}};
+}
+
+/// a pipeline that bins the value of Aesthetic into @p number_of_bins regular
+/// bins covering the span of the data
+template <typename Aesthetic>
+Pipeline<pipeline::AcceptAll, pipeline::Bin<Aesthetic>, pipeline::NoOutput>
+bin(const int number_of_bins) {
+  if (number_of_bins <= 0) {
+    throw Exception("bin requires at least one bin");
+  }
+  return {{}, {number_of_bins, 0.f, 0.f}, {}};
+}
+
+/// a pipeline that bins the value of Aesthetic into @p number_of_bins regular
+/// bins between @p min and @p max
+template <typename Aesthetic>
+Pipeline<pipeline::AcceptAll, pipeline::Bin<Aesthetic>, pipeline::NoOutput>
+bin(const int number_of_bins, const float min, const float max) {
+  if (number_of_bins <= 0 || !(min < max)) {
+    throw Exception("bin requires at least one bin and min < max");
+  }
+  return {{}, {number_of_bins, min, max}, {}};
+}
+
+/// an output stage that normalises binned counts
+inline pipeline::Normalize normalize(
+    const pipeline::Normalization mode = pipeline::Normalization::density) {
+  return {mode};
+}
+
+/// chains two pipelines, the first of which must only filter rows. The
+/// result keeps the rows accepted by both, and then applies the sink and
+/// output stages of the second
+template <typename Filter1, typename Filter2, typename Sink, typename Output>
+Pipeline<pipeline::And<Filter1, Filter2>, Sink, Output>
+operator|(const Pipeline<Filter1, pipeline::Collect, pipeline::NoOutput> &a,
+          const Pipeline<Filter2, Sink, Output> &b) {
+  return {{a.filter(), b.filter()}, b.sink(), b.output()};
+}
+
+/// appends the output stage @p stage to a binning pipeline
+template <typename Filter, typename Aesthetic, typename Output, typename Stage>
+Pipeline<Filter, pipeline::Bin<Aesthetic>, pipeline::Then<Output, Stage>>
+operator|(const Pipeline<Filter, pipeline::Bin<Aesthetic>, Output> &a,
+          const Stage &stage) {
+  return {a.filter(), a.sink(), {a.output(), stage}};
+}
+
+} // namespace trase
+
+#endif // PIPELINE_H_
@@ -36,6 +36,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef POINTS_H_
 #define POINTS_H_
 
+#include <vector>
+
 #include "frontend/Geometry.hpp"
 
 namespace trase {
@@ -51,9 +53,35 @@ namespace trase {
 /// Note that the circles have no separate stroke color for their outer
 /// circumference, they are single solid color
 ///
+/// For large numbers of points the circles can instead be aggregated into a
+/// density image with one cell per pixel of the axis (see set_density()),
+/// costing O(n) to aggregate and O(pixels) to draw, independent of n.
+///
 /// Default Transform:
 ///   - Identity 
 class Points : public Geometry {
+public:
+  /// how each pixel cell is computed in density rendering
+  enum class Density {
+    none,  ///< draw a circle for every point
+    count, ///< the number of points in each pixel
+    mean,  ///< the mean color of the points in each pixel
+    max    ///< the maximum color of the points in each pixel
+  };
+
+  /// how the pixel cells are scaled to [0, 1] before the colormap
+  enum class Normalization {
+    linear,  ///< linear between zero (count) or the smallest cell and the
+             ///< largest cell
+    log,     ///< as linear, but on a log(1 + v) scale
+    equalize ///< the fraction of non-empty cells less than or equal to each
+             ///< cell, spreading the cells evenly over the colormap
+  };
+
+private:
+  Density m_density{Density::none};
+  Normalization m_normalization{Normalization::log};
+
 public:
   /// create a new Points, connecting it to the @p parent
   explicit Points(Axis *parent) : Geometry(parent) {}
@@ -62,6 +90,22 @@ public:
 
   TRASE_GEOMETRY_DISPATCH_BACKENDS
 
+  /// draw the points as a density image rather than as circles, aggregating
+  /// with @p density and mapping the cells through the colormap after
+  /// @p normalization. The mean and max densities use the color aesthetic,
+  /// falling back to count if none is given. Density::none restores the
+  /// circles. The animated backends draw the density of the first frame
+  void set_density(Density density,
+                   Normalization normalization = Normalization::log) {
+    m_density = density;
+    m_normalization = normalization;
+    mark_dirty();
+  }
+
+  Density get_density() const { return m_density; }
+
+  Normalization get_density_normalization() const { return m_normalization; }
+
   /// draw the full points animation using the AnimatedBackend
   ///
   /// @param backend the AnimatedBackend to use when drawing
@@ -92,6 +136,14 @@ private:
   template <typename AnimatedBackend>
   void draw_frames(AnimatedBackend &backend);
   template <typename Backend> void draw_plot(Backend &backend);
+  template <typename Backend>
+  void draw_density(Backend &backend, int f, float w1, float w2);
+
+  /// returns the bounding box of the circle @p p = (x, y, radius)
+  static bfloat2_t circle_bounds(const Vector<float, 3> &p) {
+    return bfloat2_t(vfloat2_t(p[0] - p[2], p[1] - p[2]),
+                     vfloat2_t(p[0] + p[2], p[1] + p[2]));
+  }
 };
 
 } // namespace trase
@@ -31,8 +31,14 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "frontend/Points.hpp"
 #include "util/Exception.hpp"
+#include "util/Parallel.hpp"
 
 namespace trase {
 
@@ -130,8 +136,12 @@ void Points::draw_legend(Backend &backend, const float time,
   backend.circle(p1, s);
 }
 
-void Points::validate_frames(const bool have_size, const bool have_color,
-                             const int n) {
+inline void Points::validate_frames(const bool have_size,
+                                    const bool have_color, const int n) {
+  // the frames have not changed since they were last validated
+  if (m_validated_version == m_version) {
+    return;
+  }
   for (size_t f = 0; f < m_times.size(); ++f) {
     const bool this_frame_have_color = m_data[f].has<Aesthetic::color>();
     const bool this_frame_have_size = m_data[f].has<Aesthetic::size>();
@@ -154,6 +164,7 @@ void Points::validate_frames(const bool have_size, const bool have_color,
                       "frame are the same.");
     }
   }
+  m_validated_version = m_version;
 }
 
 template <typename AnimatedBackend>
@@ -165,6 +176,11 @@ void Points::draw_frames(AnimatedBackend &backend) {
 
   validate_frames(have_size, have_color, n);
 
+  if (m_density != Density::none) {
+    draw_density(backend, 0, 1.0f, 0.0f);
+    return;
+  }
+
   auto to_pixel = [&](auto x, auto y, auto s) {
     // if color or size is not provided use the bottom of the scale
     return Vector<float, 3>{m_axis->to_display<Aesthetic::x>(x),
@@ -176,13 +192,25 @@ void Points::draw_frames(AnimatedBackend &backend) {
 
   backend.stroke_width(0);
   backend.fill_color(m_style.color());
+  std::vector<Vector<float, 3>> frames(m_times.size());
   for (int i = 0; i < n; ++i) {
+    // skip points that are outside the axis for the whole animation, which
+    // moves them between the frames
+    bool visible = false;
     for (size_t f = 0; f < m_times.size(); ++f) {
-      auto p =
+      frames[f] =
           to_pixel(m_data[f].begin<Aesthetic::x>()[i],
                    m_data[f].begin<Aesthetic::y>()[i],
                    have_size ? m_data[f].begin<Aesthetic::size>()[i] : 0.f);
-
+      const auto bounds = circle_bounds(frames[f]);
+      visible = visible ||
+                in_view(bounds, f > 0 ? circle_bounds(frames[f - 1]) : bounds);
+    }
+    if (!visible) {
+      continue;
+    }
+    for (size_t f = 0; f < m_times.size(); ++f) {
+      const auto &p = frames[f];
       backend.add_animated_circle({p[0], p[1]}, p[2], m_times[f]);
       if (have_color) {
         const auto color = m_axis->to_display<Aesthetic::color>(
@@ -206,6 +234,11 @@ template <typename Backend> void Points::draw_plot(Backend &backend) {
 
   validate_frames(have_size, have_color, n);
 
+  if (m_density != Density::none) {
+    draw_density(backend, f, w1, w2);
+    return;
+  }
+
   backend.stroke_width(0);
   backend.fill_color(m_style.color());
 
@@ -218,6 +251,24 @@ template <typename Backend> void Points::draw_plot(Backend &backend) {
                                 : (m_pixels.bmax[1] - m_pixels.bmin[1]) / 80.f};
   };
 
+  // the visible circles of the frame, submitted to the backend together
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<float> rs;
+  std::vector<RGBA> fills;
+  auto add_circle = [&](const Vector<float, 3> &p, const float color) {
+    if (!in_view(circle_bounds(p))) {
+      return;
+    }
+    xs.push_back(p[0]);
+    ys.push_back(p[1]);
+    rs.push_back(p[2]);
+    if (have_color) {
+      const auto c = m_axis->to_display<Aesthetic::color>(color);
+      fills.push_back(m_colormap->to_color(c));
+    }
+  };
+
   if (w2 == 0.0f) {
     // exactly on a single frame
     auto x = m_data[f].begin<Aesthetic::x>();
@@ -226,12 +277,7 @@ template <typename Backend> void Points::draw_plot(Backend &backend) {
     auto color = have_color ? m_data[f].begin<Aesthetic::color>() : x;
     auto size = have_size ? m_data[f].begin<Aesthetic::size>() : x;
     for (int i = 0; i < m_data[0].rows(); ++i) {
-      const auto p = to_pixel(x[i], y[i], size[i]);
-      if (have_color) {
-        const auto c = m_axis->to_display<Aesthetic::color>(color[i]);
-        backend.fill_color(m_colormap->to_color(c));
-      }
-      backend.circle({p[0], p[1]}, p[2]);
+      add_circle(to_pixel(x[i], y[i], size[i]), color[i]);
     }
   } else {
     // between two frames
@@ -246,16 +292,174 @@ template <typename Backend> void Points::draw_plot(Backend &backend) {
     auto color1 = have_color ? m_data[f].begin<Aesthetic::color>() : x1;
     auto size1 = have_size ? m_data[f].begin<Aesthetic::size>() : x1;
     for (int i = 0; i < m_data[0].rows(); ++i) {
-      const auto p = w1 * to_pixel(x1[i], y1[i], size1[i]) +
-                     w2 * to_pixel(x0[i], y0[i], size0[i]);
-      if (have_color) {
-        const auto c = m_axis->to_display<Aesthetic::color>(w1 * color1[i] +
-                                                            w2 * color0[i]);
-        backend.fill_color(m_colormap->to_color(c));
+      add_circle(w1 * to_pixel(x1[i], y1[i], size1[i]) +
+                     w2 * to_pixel(x0[i], y0[i], size0[i]),
+                 w1 * color1[i] + w2 * color0[i]);
+    }
+  }
+  backend.circles(static_cast<int>(xs.size()), xs.data(), ys.data(),
+                  rs.data(), have_color ? fills.data() : nullptr);
+}
+
+template <typename Backend>
+void Points::draw_density(Backend &backend, const int f, const float w1,
+                          const float w2) {
+  const int block_size = 1 << 16;
+  const Density density =
+      m_data[f].has<Aesthetic::color>() ? m_density : Density::count;
+  const bool have_value = density != Density::count;
+  const bool interpolate = w2 != 0.0f;
+  const int f0 = interpolate ? f - 1 : f;
+
+  // one cell per pixel of the axis
+  const bfloat2_t &pixels = m_axis->pixels();
+  const int width =
+      std::max(1, static_cast<int>(std::ceil(pixels.delta()[0])));
+  const int height =
+      std::max(1, static_cast<int>(std::ceil(pixels.delta()[1])));
+  const int cells = width * height;
+
+  ValidityBitmap valid = m_data[f].valid<Aesthetic::x>() &
+                         m_data[f].valid<Aesthetic::y>() &
+                         m_data[f0].valid<Aesthetic::x>() &
+                         m_data[f0].valid<Aesthetic::y>();
+  if (have_value) {
+    valid = valid & m_data[f].valid<Aesthetic::color>() &
+            m_data[f0].valid<Aesthetic::color>();
+  }
+  auto x1 = m_data[f].begin<Aesthetic::x>();
+  auto y1 = m_data[f].begin<Aesthetic::y>();
+  auto x0 = m_data[f0].begin<Aesthetic::x>();
+  auto y0 = m_data[f0].begin<Aesthetic::y>();
+  // if color not used give a dummy iterator here, not used
+  auto color1 = have_value ? m_data[f].begin<Aesthetic::color>() : x1;
+  auto color0 = have_value ? m_data[f0].begin<Aesthetic::color>() : x0;
+  auto mix = [&](const float a1, const float a0) {
+    return interpolate ? w1 * a1 + w2 * a0 : a1;
+  };
+
+  // aggregate into separate grids for each thread, so that no atomics are
+  // needed, then merge the grids in parallel over the cells
+  const double empty =
+      density == Density::max ? -std::numeric_limits<double>::infinity() : 0.0;
+  const int rows = valid.size();
+  const int threads = parallel_threads(parallel_blocks(rows, block_size));
+  std::vector<std::vector<int>> thread_counts(threads,
+                                              std::vector<int>(cells));
+  std::vector<std::vector<double>> thread_values(
+      have_value ? threads : 0, std::vector<double>(cells, empty));
+  parallel_for_blocks(
+      rows, block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &counts = thread_counts[thread];
+        valid.for_each_valid(begin, end, [&](const int i) {
+          const float px =
+              m_axis->to_display<Aesthetic::x>(mix(x1[i], x0[i])) -
+              pixels.bmin[0];
+          const float py =
+              m_axis->to_display<Aesthetic::y>(mix(y1[i], y0[i])) -
+              pixels.bmin[1];
+          if (!(px >= 0.0f && px < width && py >= 0.0f && py < height)) {
+            return;
+          }
+          const int cell =
+              static_cast<int>(py) * width + static_cast<int>(px);
+          ++counts[cell];
+          if (have_value) {
+            auto &value = thread_values[thread][cell];
+            const double c = mix(color1[i], color0[i]);
+            value = density == Density::max ? std::max(value, c) : value + c;
+          }
+        });
+      });
+
+  std::vector<int> counts(cells, 0);
+  std::vector<float> values(cells, 0.0f);
+  parallel_for_blocks(
+      cells, block_size,
+      [&](const int, const int, const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+          int count = 0;
+          double value = empty;
+          for (int t = 0; t < threads; ++t) {
+            count += thread_counts[t][i];
+            if (have_value) {
+              value = density == Density::max
+                          ? std::max(value, thread_values[t][i])
+                          : value + thread_values[t][i];
+            }
+          }
+          counts[i] = count;
+          if (density == Density::count) {
+            values[i] = static_cast<float>(count);
+          } else if (density == Density::mean) {
+            values[i] = count > 0 ? static_cast<float>(value / count) : 0.0f;
+          } else {
+            values[i] = static_cast<float>(value);
+          }
+        }
+      });
+
+  // scale the non-empty cells to [0, 1]
+  std::vector<float> sorted;
+  for (int i = 0; i < cells; ++i) {
+    if (counts[i] > 0) {
+      sorted.push_back(values[i]);
+    }
+  }
+  if (sorted.empty()) {
+    return;
+  }
+  std::sort(sorted.begin(), sorted.end());
+  const float lower = density == Density::count ? 0.0f : sorted.front();
+  const float range = sorted.back() - lower;
+  auto normalize = [&](const float v) {
+    switch (m_normalization) {
+    case Normalization::linear:
+      return range > 0.0f ? (v - lower) / range : 1.0f;
+    case Normalization::log:
+      return range > 0.0f ? std::log1p(v - lower) / std::log1p(range) : 1.0f;
+    case Normalization::equalize:
+    default:
+      return static_cast<float>(
+                 std::upper_bound(sorted.begin(), sorted.end(), v) -
+                 sorted.begin()) /
+             sorted.size();
+    }
+  };
+
+  // each run of equal cells along a row of pixels is a single rect, and the
+  // rects of the frame are submitted to the backend together
+  std::vector<float> xmins;
+  std::vector<float> ymins;
+  std::vector<float> xmaxs;
+  std::vector<float> ymaxs;
+  std::vector<RGBA> fills;
+  for (int j = 0; j < height; ++j) {
+    const int row = j * width;
+    int i = 0;
+    while (i < width) {
+      if (counts[row + i] == 0) {
+        ++i;
+        continue;
       }
-      backend.circle({p[0], p[1]}, p[2]);
+      const float value = values[row + i];
+      int end = i + 1;
+      while (end < width && counts[row + end] > 0 &&
+             values[row + end] == value) {
+        ++end;
+      }
+      xmins.push_back(pixels.bmin[0] + i);
+      ymins.push_back(pixels.bmin[1] + j);
+      xmaxs.push_back(pixels.bmin[0] + end);
+      ymaxs.push_back(pixels.bmin[1] + j + 1.0f);
+      fills.push_back(m_colormap->to_color(normalize(value)));
+      i = end;
     }
   }
+  backend.stroke_width(0);
+  backend.rects(static_cast<int>(xmins.size()), xmins.data(), ymins.data(),
+                xmaxs.data(), ymaxs.data(), nullptr, fills.data());
 }
 
 } // namespace trase
@@ -0,0 +1,327 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frontend/Quantile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "util/Parallel.hpp"
+
+namespace trase {
+
+namespace {
+
+/// number of rows processed together by the quantile kernels
+const int quantile_block_size = 1 << 16;
+
+/// returns the rows with valid y values, and x values if x is given
+ValidityBitmap valid_rows(const DataWithAesthetic &data) {
+  if (data.has<Aesthetic::x>()) {
+    return data.valid<Aesthetic::x>() & data.valid<Aesthetic::y>();
+  }
+  return data.valid<Aesthetic::y>();
+}
+
+/// groups rows by their x value, or puts every row in a single group if x
+/// is not given
+class Grouping {
+  bool m_have_x;
+  ColumnIterator m_x;
+  std::vector<float> m_keys;
+
+public:
+  Grouping(const DataWithAesthetic &data, const ValidityBitmap &valid)
+      : m_have_x(data.has<Aesthetic::x>()) {
+    if (!m_have_x) {
+      m_keys.push_back(0.f);
+      return;
+    }
+    m_x = data.begin<Aesthetic::x>();
+
+    // find the sorted set of keys seen in each block, then merge them. The
+    // number of groups is expected to be small, so each block keeps a sorted
+    // vector, with a fast path for runs of the same key
+    const int rows = valid.size();
+    std::vector<std::vector<float>> block_keys(
+        parallel_blocks(rows, quantile_block_size));
+    parallel_for_blocks(
+        rows, quantile_block_size,
+        [&](const int, const int block, const int begin, const int end) {
+          auto &keys = block_keys[block];
+          float last = std::numeric_limits<float>::quiet_NaN();
+          valid.for_each_valid(begin, end, [&](const int i) {
+            const float key = m_x[i];
+            if (key == last) {
+              return;
+            }
+            last = key;
+            auto it = std::lower_bound(keys.begin(), keys.end(), key);
+            if (it == keys.end() || *it != key) {
+              keys.insert(it, key);
+            }
+          });
+        });
+    for (const auto &keys : block_keys) {
+      std::vector<float> merged;
+      std::set_union(m_keys.begin(), m_keys.end(), keys.begin(), keys.end(),
+                     std::back_inserter(merged));
+      m_keys.swap(merged);
+    }
+  }
+
+  /// returns the sorted keys of all groups
+  const std::vector<float> &keys() const { return m_keys; }
+
+  /// returns the group index of row @p i
+  int operator()(const int i) const {
+    if (!m_have_x) {
+      return 0;
+    }
+    return static_cast<int>(
+        std::lower_bound(m_keys.begin(), m_keys.end(), m_x[i]) -
+        m_keys.begin());
+  }
+};
+
+/// returns the @p p quantile of the values in [@p begin, @p end), using
+/// linear interpolation between order statistics. The values are reordered
+float exact_quantile(float *begin, float *end, const float p) {
+  const auto n = static_cast<int>(end - begin);
+  const double h = static_cast<double>(n - 1) * p;
+  const auto lo = static_cast<int>(std::floor(h));
+  std::nth_element(begin, begin + lo, end);
+  const float v0 = begin[lo];
+  if (lo + 1 >= n) {
+    return v0;
+  }
+  const float v1 = *std::min_element(begin + lo + 1, end);
+  return static_cast<float>(v0 + (h - lo) * (v1 - v0));
+}
+
+} // namespace
+
+Quantiles::Quantiles(const Mode mode, const Output output, const float width,
+                     const int sketch_size)
+    : m_mode(mode), m_output(output), m_width(width),
+      m_sketch_size(sketch_size),
+      m_sketches(std::make_shared<std::map<float, QuantileSketch>>()) {}
+
+void Quantiles::clear() { m_sketches->clear(); }
+
+std::vector<Quantiles::Summary>
+Quantiles::summarise(const DataWithAesthetic &data) {
+  if (m_mode == Mode::exact) {
+    return summarise_exact(data);
+  }
+  return summarise_approximate(data);
+}
+
+std::vector<Quantiles::Summary>
+Quantiles::summarise_exact(const DataWithAesthetic &data) const {
+  if (data.rows() == 0) {
+    return {};
+  }
+  const auto valid = valid_rows(data);
+  if (valid.null_count() == valid.size()) {
+    return {};
+  }
+  const Grouping group(data, valid);
+  const int number_of_groups = static_cast<int>(group.keys().size());
+  auto y = data.begin<Aesthetic::y>();
+  const int rows = valid.size();
+  const int number_of_blocks = parallel_blocks(rows, quantile_block_size);
+
+  // count the rows of each group in each block
+  std::vector<std::vector<std::int64_t>> offsets(
+      number_of_blocks, std::vector<std::int64_t>(number_of_groups, 0));
+  parallel_for_blocks(
+      rows, quantile_block_size,
+      [&](const int, const int block, const int begin, const int end) {
+        auto &counts = offsets[block];
+        valid.for_each_valid(begin, end,
+                             [&](const int i) { ++counts[group(i)]; });
+      });
+
+  // turn the counts into offsets, so that the values of each group are
+  // contiguous and in row order
+  std::vector<std::int64_t> group_begin(number_of_groups + 1, 0);
+  for (int g = 0; g < number_of_groups; ++g) {
+    std::int64_t offset = group_begin[g];
+    for (auto &block : offsets) {
+      const std::int64_t count = block[g];
+      block[g] = offset;
+      offset += count;
+    }
+    group_begin[g + 1] = offset;
+  }
+
+  // gather the values of each group
+  std::vector<float> values(group_begin.back());
+  parallel_for_blocks(
+      rows, quantile_block_size,
+      [&](const int, const int block, const int begin, const int end) {
+        auto &offset = offsets[block];
+        valid.for_each_valid(begin, end, [&](const int i) {
+          values[offset[group(i)]++] = y[i];
+        });
+      });
+
+  // find the quantiles of each group, with one group per block
+  std::vector<Summary> summaries(number_of_groups);
+  parallel_for_blocks(number_of_groups, 1, [&](const int, const int g,
+                                               const int, const int) {
+    float *begin = values.data() + group_begin[g];
+    float *end = values.data() + group_begin[g + 1];
+    Summary &s = summaries[g];
+    s.group = group.keys()[g];
+    s.count = end - begin;
+    s.median = exact_quantile(begin, end, 0.5f);
+    s.lower_quartile = exact_quantile(begin, end, 0.25f);
+    s.upper_quartile = exact_quantile(begin, end, 0.75f);
+
+    // whiskers extend to the most extreme values within the fences
+    const float iqr = s.upper_quartile - s.lower_quartile;
+    const float lower_fence = s.lower_quartile - 1.5f * iqr;
+    const float upper_fence = s.upper_quartile + 1.5f * iqr;
+    s.lower_whisker = s.lower_quartile;
+    s.upper_whisker = s.upper_quartile;
+    for (const float *v = begin; v != end; ++v) {
+      if (*v >= lower_fence) {
+        s.lower_whisker = std::min(s.lower_whisker, *v);
+      }
+      if (*v <= upper_fence) {
+        s.upper_whisker = std::max(s.upper_whisker, *v);
+      }
+    }
+  });
+
+  return summaries;
+}
+
+std::vector<Quantiles::Summary>
+Quantiles::summarise_approximate(const DataWithAesthetic &data) {
+  if (data.rows() > 0) {
+    const auto valid = valid_rows(data);
+    const Grouping group(data, valid);
+    const int number_of_groups = static_cast<int>(group.keys().size());
+    auto y = data.begin<Aesthetic::y>();
+    const int rows = valid.size();
+
+    // sketch each group in per-thread sketches, then merge these in thread
+    // order into the persistent sketches
+    std::vector<std::vector<QuantileSketch>> thread_sketches(
+        parallel_threads(parallel_blocks(rows, quantile_block_size)),
+        std::vector<QuantileSketch>(number_of_groups,
+                                    QuantileSketch(m_sketch_size)));
+    parallel_for_blocks(
+        rows, quantile_block_size,
+        [&](const int thread, const int, const int begin, const int end) {
+          auto &sketches = thread_sketches[thread];
+          valid.for_each_valid(begin, end, [&](const int i) {
+            sketches[group(i)].add(y[i]);
+          });
+        });
+
+    for (int g = 0; g < number_of_groups; ++g) {
+      auto it = m_sketches
+                    ->emplace(group.keys()[g], QuantileSketch(m_sketch_size))
+                    .first;
+      for (const auto &sketches : thread_sketches) {
+        it->second.merge(sketches[g]);
+      }
+    }
+  }
+
+  std::vector<Summary> summaries;
+  for (const auto &i : *m_sketches) {
+    const QuantileSketch &sketch = i.second;
+    if (sketch.count() == 0) {
+      continue;
+    }
+    Summary s;
+    s.group = i.first;
+    s.count = sketch.count();
+    s.median = sketch.quantile(0.5f);
+    s.lower_quartile = sketch.quantile(0.25f);
+    s.upper_quartile = sketch.quantile(0.75f);
+    const float iqr = s.upper_quartile - s.lower_quartile;
+    s.lower_whisker = std::max(sketch.min(), s.lower_quartile - 1.5f * iqr);
+    s.upper_whisker = std::min(sketch.max(), s.upper_quartile + 1.5f * iqr);
+    summaries.push_back(s);
+  }
+  return summaries;
+}
+
+DataWithAesthetic Quantiles::operator()(const DataWithAesthetic &data) {
+  const auto summaries = summarise(data);
+  const float half_width = 0.5f * m_width;
+
+  if (m_output == Output::box) {
+    const auto n = summaries.size();
+    std::vector<float> x(n), y(n), xmin(n), xmax(n), ymin(n), ymax(n);
+    for (size_t i = 0; i < n; ++i) {
+      const Summary &s = summaries[i];
+      x[i] = s.group;
+      y[i] = s.median;
+      xmin[i] = s.group - half_width;
+      xmax[i] = s.group + half_width;
+      ymin[i] = s.lower_quartile;
+      ymax[i] = s.upper_quartile;
+    }
+    return create_data().x(x).y(y).xmin(xmin).xmax(xmax).ymin(ymin).ymax(
+        ymax);
+  }
+
+  // whiskers and median of each group as separate segments, split by missing
+  // values so that Line does not join them
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> x;
+  std::vector<float> y;
+  x.reserve(9 * summaries.size());
+  y.reserve(9 * summaries.size());
+  auto segment = [&](const float x0, const float y0, const float x1,
+                     const float y1) {
+    x.insert(x.end(), {x0, x1, nan});
+    y.insert(y.end(), {y0, y1, nan});
+  };
+  for (const Summary &s : summaries) {
+    segment(s.group, s.lower_whisker, s.group, s.lower_quartile);
+    segment(s.group, s.upper_quartile, s.group, s.upper_whisker);
+    segment(s.group - half_width, s.median, s.group + half_width, s.median);
+  }
+  return create_data().x(x).y(y);
+}
+
+} // namespace trase
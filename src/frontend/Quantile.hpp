@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Quantile.hpp
+
+#ifndef QUANTILE_H_
+#define QUANTILE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "frontend/Data.hpp"
+#include "util/QuantileSketch.hpp"
+
+namespace trase {
+
+/// per-group quantiles of y, for box and whisker plots
+///
+/// Rows are grouped by their x value (e.g. a dictionary encoded string
+/// column), or form a single group at x = 0 if x is not given. For each group
+/// the quartiles of y are found, along with the whisker bounds: the most
+/// extreme values within 1.5 times the interquartile range of the box.
+///
+/// In exact mode the values of each group are gathered and the quartiles
+/// found by partial sorting, with the groups processed in parallel. In
+/// approximate mode each group is summarised by a QuantileSketch in bounded
+/// memory. The sketches are kept between calls (and shared between copies of
+/// the transform), so that each frame adds a chunk of a stream; the whisker
+/// bounds are then the 1.5 IQR fences, clamped to the range of the data.
+///
+/// The output is either the boxes (x, y = median, xmin, xmax, ymin = lower
+/// quartile, ymax = upper quartile) for drawing with the Rectangle geometry,
+/// or the whiskers and medians as a set of segments separated by missing
+/// values, for drawing with the Line geometry.
+class Quantiles {
+public:
+  enum class Mode { exact, approximate };
+  enum class Output { box, whiskers };
+
+  /// summary of the y values in one group
+  struct Summary {
+    float group;
+    float lower_whisker;
+    float lower_quartile;
+    float median;
+    float upper_quartile;
+    float upper_whisker;
+    std::int64_t count;
+  };
+
+private:
+  Mode m_mode;
+  Output m_output;
+  float m_width;
+  int m_sketch_size;
+  std::shared_ptr<std::map<float, QuantileSketch>> m_sketches;
+
+public:
+  /// @param mode exact or approximate quantiles
+  /// @param output whether to output the boxes or the whiskers
+  /// @param width the width of each box in data coordinates
+  /// @param sketch_size accuracy of the sketches used in approximate mode
+  explicit Quantiles(Mode mode = Mode::exact, Output output = Output::box,
+                     float width = 0.8f, int sketch_size = 200);
+
+  /// returns the summary of each group in @p data, ordered by group. In
+  /// approximate mode @p data is first added to the sketches
+  std::vector<Summary> summarise(const DataWithAesthetic &data);
+
+  /// removes all data added to the sketches in approximate mode
+  void clear();
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+private:
+  std::vector<Summary> summarise_exact(const DataWithAesthetic &data) const;
+  std::vector<Summary> summarise_approximate(const DataWithAesthetic &data);
+};
+
+} // namespace trase
+
+#endif // QUANTILE_H_
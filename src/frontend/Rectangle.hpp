@@ -36,6 +36,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef RECTANGLE_H_
 #define RECTANGLE_H_
 
+#include <algorithm>
+
 #include "frontend/Geometry.hpp"
 
 namespace trase {
@@ -48,7 +50,8 @@ namespace trase {
 ///   - xmax (maximum x-coordinate of rectangles)
 ///   - ymax (maximum y-coordinate of rectangles)
 ///   - color (optional - stroke color of circles)
-///   - fill (optional - fill color of circles)
+///   - fill (optional - fill color of circles, rectangles with a missing fill
+///     are not drawn)
 ///
 /// Default Transform:
 ///   - Identity 
@@ -85,12 +88,27 @@ public:
   template <typename Backend>
   void draw_legend(Backend &backend, float time, const bfloat2_t &box);
 
+protected:
+  /// index the rectangles, so that a point inside a rectangle picks it
+  SpatialIndex
+  build_spatial_index(const DataWithAesthetic &data) const override;
+
 private:
   void validate_frames(const bool have_color, const bool have_fill,
                        const int n);
   template <typename AnimatedBackend>
   void draw_frames(AnimatedBackend &backend);
   template <typename Backend> void draw_plot(Backend &backend);
+
+  /// returns the bounding box of the rectangle @p p = (xmin, ymin, xmax,
+  /// ymax) in pixels, including its stroke
+  bfloat2_t rect_bounds(const Vector<float, 4> &p) const {
+    const float stroke = 0.5f * m_style.line_width();
+    return bfloat2_t(vfloat2_t(std::min(p[0], p[2]) - stroke,
+                               std::min(p[1], p[3]) - stroke),
+                     vfloat2_t(std::max(p[0], p[2]) + stroke,
+                               std::max(p[1], p[3]) + stroke));
+  }
 };
 
 } // namespace trase
@@ -31,6 +31,11 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
 #include "frontend/Rectangle.hpp"
 #include "util/Exception.hpp"
 
@@ -173,8 +178,39 @@ void Rectangle::draw_legend(Backend &backend, const float time,
   backend.rect(bfloat2_t(p1 - s, p1 + s));
 }
 
-void Rectangle::validate_frames(const bool have_color, const bool have_fill,
-                                const int n) {
+inline SpatialIndex
+Rectangle::build_spatial_index(const DataWithAesthetic &data) const {
+  std::vector<vfloat2_t> min;
+  std::vector<vfloat2_t> max;
+  std::vector<int> rows;
+  if (data.has<Aesthetic::xmin>() && data.has<Aesthetic::ymin>() &&
+      data.has<Aesthetic::xmax>() && data.has<Aesthetic::ymax>()) {
+    auto xmin = data.begin<Aesthetic::xmin>();
+    auto ymin = data.begin<Aesthetic::ymin>();
+    auto xmax = data.begin<Aesthetic::xmax>();
+    auto ymax = data.begin<Aesthetic::ymax>();
+    for (int i = 0; i < data.rows(); ++i) {
+      const vfloat2_t p0 = {std::min(xmin[i], xmax[i]),
+                            std::min(ymin[i], ymax[i])};
+      const vfloat2_t p1 = {std::max(xmin[i], xmax[i]),
+                            std::max(ymin[i], ymax[i])};
+      if (std::isfinite(p0[0]) && std::isfinite(p0[1]) &&
+          std::isfinite(p1[0]) && std::isfinite(p1[1])) {
+        min.push_back(p0);
+        max.push_back(p1);
+        rows.push_back(i);
+      }
+    }
+  }
+  return SpatialIndex(std::move(min), std::move(max), std::move(rows));
+}
+
+inline void Rectangle::validate_frames(const bool have_color,
+                                       const bool have_fill, const int n) {
+  // the frames have not changed since they were last validated
+  if (m_validated_version == m_version) {
+    return;
+  }
   for (size_t f = 0; f < m_times.size(); ++f) {
     const bool this_frame_have_color = m_data[f].has<Aesthetic::color>();
     const bool this_frame_have_fill = m_data[f].has<Aesthetic::fill>();
@@ -200,6 +236,7 @@ void Rectangle::validate_frames(const bool have_color, const bool have_fill,
           "frame are the same.");
     }
   }
+  m_validated_version = m_version;
 }
 
 template <typename AnimatedBackend>
@@ -222,13 +259,25 @@ void Rectangle::draw_frames(AnimatedBackend &backend) {
   backend.stroke_width(m_style.line_width());
   backend.fill_color(m_style.color());
   backend.stroke_color(m_style.color());
+  std::vector<Vector<float, 4>> frames(m_times.size());
   for (int i = 0; i < n; ++i) {
+    // skip rectangles that are outside the axis for the whole animation,
+    // which moves them between the frames
+    bool visible = false;
     for (size_t f = 0; f < m_times.size(); ++f) {
-      auto p = to_pixel(m_data[f].begin<Aesthetic::xmin>()[i],
-                        m_data[f].begin<Aesthetic::ymin>()[i],
-                        m_data[f].begin<Aesthetic::xmax>()[i],
-                        m_data[f].begin<Aesthetic::ymax>()[i]);
-
+      frames[f] = to_pixel(m_data[f].begin<Aesthetic::xmin>()[i],
+                           m_data[f].begin<Aesthetic::ymin>()[i],
+                           m_data[f].begin<Aesthetic::xmax>()[i],
+                           m_data[f].begin<Aesthetic::ymax>()[i]);
+      const auto bounds = rect_bounds(frames[f]);
+      visible = visible ||
+                in_view(bounds, f > 0 ? rect_bounds(frames[f - 1]) : bounds);
+    }
+    if (!visible) {
+      continue;
+    }
+    for (size_t f = 0; f < m_times.size(); ++f) {
+      const auto &p = frames[f];
       backend.add_animated_rect({{p[0], p[3]}, {p[2], p[1]}}, m_times[f]);
       if (have_color) {
         const auto color = m_axis->to_display<Aesthetic::color>(
@@ -236,9 +285,14 @@ void Rectangle::draw_frames(AnimatedBackend &backend) {
         backend.add_animated_stroke(m_colormap->to_color(color));
       }
       if (have_fill) {
-        const auto fill = m_axis->to_display<Aesthetic::fill>(
-            m_data[f].begin<Aesthetic::fill>()[i]);
-        backend.add_animated_fill(m_colormap->to_color(fill));
+        if (m_data[f].valid<Aesthetic::fill>().test(i)) {
+          const auto fill = m_axis->to_display<Aesthetic::fill>(
+              m_data[f].begin<Aesthetic::fill>()[i]);
+          backend.add_animated_fill(m_colormap->to_color(fill));
+        } else {
+          // missing fill values are transparent
+          backend.add_animated_fill(RGBA(0, 0, 0, 0));
+        }
       }
     }
     backend.end_animated_rect();
@@ -268,6 +322,32 @@ template <typename Backend> void Rectangle::draw_plot(Backend &backend) {
                             m_axis->to_display<Aesthetic::ymax>(ymax)};
   };
 
+  // the visible rectangles of the frame, submitted to the backend together
+  std::vector<float> xmins;
+  std::vector<float> ymins;
+  std::vector<float> xmaxs;
+  std::vector<float> ymaxs;
+  std::vector<RGBA> strokes;
+  std::vector<RGBA> fills;
+  auto add_rect = [&](const Vector<float, 4> &p, const float color,
+                      const float fill) {
+    if (!in_view(rect_bounds(p))) {
+      return;
+    }
+    xmins.push_back(p[0]);
+    ymins.push_back(p[3]);
+    xmaxs.push_back(p[2]);
+    ymaxs.push_back(p[1]);
+    if (have_color) {
+      const auto c = m_axis->to_display<Aesthetic::color>(color);
+      strokes.push_back(m_colormap->to_color(c));
+    }
+    if (have_fill) {
+      const auto c = m_axis->to_display<Aesthetic::fill>(fill);
+      fills.push_back(m_colormap->to_color(c));
+    }
+  };
+
   if (w2 == 0.0f) {
     // exactly on a single frame
     auto xmin = m_data[f].begin<Aesthetic::xmin>();
@@ -278,16 +358,12 @@ template <typename Backend> void Rectangle::draw_plot(Backend &backend) {
     auto color = have_color ? m_data[f].begin<Aesthetic::color>() : xmin;
     auto fill = have_fill ? m_data[f].begin<Aesthetic::fill>() : xmin;
     for (int i = 0; i < m_data[0].rows(); ++i) {
-      const auto p = to_pixel(xmin[i], ymin[i], xmax[i], ymax[i]);
-      if (have_color) {
-        const auto c = m_axis->to_display<Aesthetic::color>(color[i]);
-        backend.stroke_color(m_colormap->to_color(c));
-      }
-      if (have_fill) {
-        const auto f = m_axis->to_display<Aesthetic::fill>(fill[i]);
-        backend.fill_color(m_colormap->to_color(f));
+      // rectangles with missing fill values are not drawn
+      if (have_fill && !m_data[f].valid<Aesthetic::fill>().test(i)) {
+        continue;
       }
-      backend.rect({{p[0], p[3]}, {p[2], p[1]}});
+      add_rect(to_pixel(xmin[i], ymin[i], xmax[i], ymax[i]), color[i],
+               fill[i]);
     }
   } else {
     // between two frames
@@ -306,21 +382,19 @@ template <typename Backend> void Rectangle::draw_plot(Backend &backend) {
     auto color1 = have_color ? m_data[f].begin<Aesthetic::color>() : xmin0;
     auto fill1 = have_fill ? m_data[f].begin<Aesthetic::fill>() : xmin0;
     for (int i = 0; i < m_data[0].rows(); ++i) {
-      const auto p = w1 * to_pixel(xmin1[i], ymin1[i], xmax1[i], ymax1[i]) +
-                     w2 * to_pixel(xmin0[i], ymin0[i], xmax0[i], ymax0[i]);
-      if (have_color) {
-        const auto color = m_axis->to_display<Aesthetic::color>(w1 * color1[i] +
-                                                                w2 * color0[i]);
-        backend.stroke_color(m_colormap->to_color(color));
-      }
-      if (have_fill) {
-        const auto fill =
-            m_axis->to_display<Aesthetic::fill>(w1 * fill1[i] + w2 * fill0[i]);
-        backend.fill_color(m_colormap->to_color(fill));
+      if (have_fill && !(m_data[f - 1].valid<Aesthetic::fill>().test(i) &&
+                         m_data[f].valid<Aesthetic::fill>().test(i))) {
+        continue;
       }
-      backend.rect({{p[0], p[3]}, {p[2], p[1]}});
+      add_rect(w1 * to_pixel(xmin1[i], ymin1[i], xmax1[i], ymax1[i]) +
+                   w2 * to_pixel(xmin0[i], ymin0[i], xmax0[i], ymax0[i]),
+               w1 * color1[i] + w2 * color0[i], w1 * fill1[i] + w2 * fill0[i]);
     }
   }
+  backend.rects(static_cast<int>(xmins.size()), xmins.data(), ymins.data(),
+                xmaxs.data(), ymaxs.data(),
+                have_color ? strokes.data() : nullptr,
+                have_fill ? fills.data() : nullptr);
 }
 
 } // namespace trase
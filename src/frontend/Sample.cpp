@@ -0,0 +1,261 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frontend/Sample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+
+#include "frontend/Pipeline.hpp"
+#include "util/Parallel.hpp"
+
+namespace trase {
+
+Sample::Sample(const int size, const std::uint64_t seed)
+    : m_size(std::max(size, 0)), m_seed(seed) {}
+
+namespace {
+
+/// number of rows processed together by the sampling kernels
+const int sample_block_size = 1 << 16;
+
+/// number of strata merged together by the stratified sampling kernel
+const int stratum_block_size = 64;
+
+/// returns the pseudo-random key of row @p row, using the SplitMix64 mixing
+/// function
+///
+/// Steele, G. L., Lea, D. and Flood, C. H. 2014.
+/// Fast Splittable Pseudorandom Number Generators.
+/// Proceedings of OOPSLA 2014, 453-472.
+std::uint64_t row_key(const std::uint64_t seed, const int row) {
+  std::uint64_t z =
+      seed + 0x9e3779b97f4a7c15ull * (static_cast<std::uint64_t>(row) + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+/// the rows with the smallest keys added so far, kept in a max heap on the
+/// key so that most rows are rejected by a single comparison with the top
+class Reservoir {
+  std::vector<std::pair<std::uint64_t, int>> m_heap;
+  int m_capacity;
+
+public:
+  explicit Reservoir(const int capacity = 0) : m_capacity(capacity) {}
+
+  void add(const std::uint64_t key, const int row) {
+    if (static_cast<int>(m_heap.size()) < m_capacity) {
+      m_heap.emplace_back(key, row);
+      std::push_heap(m_heap.begin(), m_heap.end());
+    } else if (m_capacity > 0 && key < m_heap.front().first) {
+      std::pop_heap(m_heap.begin(), m_heap.end());
+      m_heap.back() = std::make_pair(key, row);
+      std::push_heap(m_heap.begin(), m_heap.end());
+    }
+  }
+
+  void merge(const Reservoir &other) {
+    for (const auto &entry : other.m_heap) {
+      add(entry.first, entry.second);
+    }
+  }
+
+  /// appends the rows in the reservoir to @p rows
+  void append_rows(std::vector<int> &rows) const {
+    for (const auto &entry : m_heap) {
+      rows.push_back(entry.second);
+    }
+  }
+};
+
+/// returns the bits of the stratum value @p value, with all missing values
+/// and both zeros given the same bits
+std::uint32_t stratum_bits(float value, const bool valid) {
+  if (!valid || std::isnan(value)) {
+    value = std::numeric_limits<float>::quiet_NaN();
+  } else if (value == 0.f) {
+    value = 0.f;
+  }
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+} // namespace
+
+std::vector<int> Sample::rows(const DataWithAesthetic &data) const {
+  const int n = data.rows();
+  std::vector<int> selected;
+  if (n <= m_size) {
+    selected.resize(n);
+    std::iota(selected.begin(), selected.end(), 0);
+    return selected;
+  }
+  const int threads = parallel_threads(parallel_blocks(n, sample_block_size));
+
+  if (!m_stratum_begin) {
+    std::vector<Reservoir> reservoirs(threads, Reservoir(m_size));
+    parallel_for_blocks(
+        n, sample_block_size,
+        [&](const int thread, const int, const int begin, const int end) {
+          auto &reservoir = reservoirs[thread];
+          for (int i = begin; i < end; ++i) {
+            reservoir.add(row_key(m_seed, i), i);
+          }
+        });
+    // merge pairs of reservoirs in rounds, the pairs of a round in parallel
+    for (int step = 1; step < threads; step *= 2) {
+      parallel_for_blocks(
+          parallel_blocks(threads, 2 * step), 1,
+          [&](const int, const int, const int begin, const int) {
+            const int t = 2 * step * begin;
+            if (t + step < threads) {
+              reservoirs[t].merge(reservoirs[t + step]);
+            }
+          });
+    }
+    reservoirs[0].append_rows(selected);
+    std::sort(selected.begin(), selected.end());
+    return selected;
+  }
+
+  auto stratum = m_stratum_begin(data);
+  const ValidityBitmap &valid = m_stratum_valid(data);
+  using Counts = std::unordered_map<std::uint32_t, std::int64_t>;
+  using Reservoirs = std::unordered_map<std::uint32_t, Reservoir>;
+
+  // size of each stratum
+  std::vector<Counts> thread_counts(threads);
+  parallel_for_blocks(
+      n, sample_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &counts = thread_counts[thread];
+        for (int i = begin; i < end; ++i) {
+          ++counts[stratum_bits(stratum[i], valid.test(i))];
+        }
+      });
+  Counts counts;
+  for (const auto &thread : thread_counts) {
+    for (const auto &entry : thread) {
+      counts[entry.first] += entry.second;
+    }
+  }
+
+  // give each stratum one row, smallest first, while the sample lasts, then
+  // share the rest equally, again starting from the smallest strata so that
+  // any share they cannot use goes to the larger ones
+  std::vector<std::pair<std::int64_t, std::uint32_t>> sizes;
+  for (const auto &entry : counts) {
+    sizes.emplace_back(entry.second, entry.first);
+  }
+  std::sort(sizes.begin(), sizes.end());
+  std::unordered_map<std::uint32_t, int> quotas;
+  std::int64_t remaining = m_size;
+  for (const auto &size : sizes) {
+    quotas[size.second] = remaining > 0 ? 1 : 0;
+    remaining -= quotas[size.second];
+  }
+  for (std::size_t s = 0; s < sizes.size(); ++s) {
+    const std::int64_t share =
+        remaining / static_cast<std::int64_t>(sizes.size() - s);
+    const std::int64_t extra =
+        std::min(sizes[s].first - quotas[sizes[s].second], share);
+    quotas[sizes[s].second] += static_cast<int>(extra);
+    remaining -= extra;
+  }
+
+  // sample each stratum
+  std::vector<Reservoirs> thread_reservoirs(threads);
+  parallel_for_blocks(
+      n, sample_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &reservoirs = thread_reservoirs[thread];
+        for (int i = begin; i < end; ++i) {
+          const std::uint32_t bits = stratum_bits(stratum[i], valid.test(i));
+          auto found = reservoirs.find(bits);
+          if (found == reservoirs.end()) {
+            found = reservoirs.emplace(bits, Reservoir(quotas.at(bits))).first;
+          }
+          found->second.add(row_key(m_seed, i), i);
+        }
+      });
+
+  // merge the reservoirs of each stratum, the strata in parallel
+  std::vector<Reservoir> reservoirs(sizes.size());
+  parallel_for_blocks(
+      static_cast<int>(sizes.size()), stratum_block_size,
+      [&](const int, const int, const int begin, const int end) {
+        for (int s = begin; s < end; ++s) {
+          const std::uint32_t bits = sizes[s].second;
+          reservoirs[s] = Reservoir(quotas.at(bits));
+          for (const auto &thread : thread_reservoirs) {
+            const auto found = thread.find(bits);
+            if (found != thread.end()) {
+              reservoirs[s].merge(found->second);
+            }
+          }
+        }
+      });
+  for (const auto &reservoir : reservoirs) {
+    reservoir.append_rows(selected);
+  }
+  std::sort(selected.begin(), selected.end());
+  return selected;
+}
+
+DataWithAesthetic Sample::operator()(const DataWithAesthetic &data) const {
+  if (data.rows() <= m_size) {
+    return data;
+  }
+  const std::vector<int> selected = rows(data);
+  DataWithAesthetic out;
+  pipeline::collect_column<Aesthetic::x>(data, selected, out);
+  pipeline::collect_column<Aesthetic::y>(data, selected, out);
+  pipeline::collect_column<Aesthetic::color>(data, selected, out);
+  pipeline::collect_column<Aesthetic::size>(data, selected, out);
+  pipeline::collect_column<Aesthetic::fill>(data, selected, out);
+  pipeline::collect_column<Aesthetic::xmin>(data, selected, out);
+  pipeline::collect_column<Aesthetic::ymin>(data, selected, out);
+  pipeline::collect_column<Aesthetic::xmax>(data, selected, out);
+  pipeline::collect_column<Aesthetic::ymax>(data, selected, out);
+  return out;
+}
+
+} // namespace trase
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Sample.hpp
+
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frontend/Data.hpp"
+#include "frontend/TransformCache.hpp"
+
+namespace trase {
+
+/// a reproducible random sample of the rows, for fast previews of large data
+///
+/// Each row is given a pseudo-random key computed from the seed and its row
+/// index, and the rows with the smallest keys are kept. This is a uniform
+/// sample without replacement, found in a single pass with each thread
+/// filling its own reservoir, and the reservoirs are then merged. As the
+/// keys depend only on the seed and the row, the sample is identical for any
+/// number of threads.
+///
+/// With stratified sampling the rows are split into strata by the value of a
+/// category aesthetic (e.g. a dictionary encoded string column), and the
+/// sample is shared equally between the strata, with strata smaller than
+/// their share kept whole and the remainder shared between the others. Rare
+/// strata therefore remain visible. Rows with a missing category form a
+/// stratum of their own.
+///
+/// The output holds the sampled rows of every aesthetic, in their original
+/// order, so it can be used with any geometry (e.g. Axis::points or
+/// Axis::line). Data with no more rows than the sample size is passed
+/// through unchanged.
+class Sample {
+  int m_size;
+  std::uint64_t m_seed;
+  ColumnIterator (*m_stratum_begin)(const DataWithAesthetic &){nullptr};
+  const ValidityBitmap &(*m_stratum_valid)(const DataWithAesthetic &){nullptr};
+
+public:
+  /// sample @p size rows, using the random @p seed
+  explicit Sample(int size = 100000, std::uint64_t seed = 0);
+
+  /// share the sample equally between the strata given by Aesthetic
+  template <typename Aesthetic> Sample &stratify() {
+    m_stratum_begin = [](const DataWithAesthetic &data) {
+      return data.begin<Aesthetic>();
+    };
+    m_stratum_valid =
+        [](const DataWithAesthetic &data) -> const ValidityBitmap & {
+      return data.valid<Aesthetic>();
+    };
+    return *this;
+  }
+
+  /// returns the sampled rows of @p data, in ascending order
+  std::vector<int> rows(const DataWithAesthetic &data) const;
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data) const;
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_size, m_seed, m_stratum_begin);
+  }
+};
+
+} // namespace trase
+
+#endif // SAMPLE_H_
@@ -33,11 +33,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
 #include <cmath>
+#include <complex>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <limits>
 #include <numeric>
+#include <utility>
 #include <vector>
 
+#include "frontend/Axis.hpp"
 #include "frontend/Transform.hpp"
+#include "util/Exception.hpp"
+#include "util/FFT.hpp"
+#include "util/HistogramIndex.hpp"
+#include "util/Parallel.hpp"
+#include "util/QuantileSketch.hpp"
 
 namespace trase {
 
@@ -46,68 +57,1163 @@ BinX::BinX(const int number_of_bins, const float min, const float max)
     : m_number_of_bins(number_of_bins),
       m_span(Vector<float, 1>(min), Vector<float, 1>({max})) {}
 
+namespace {
+
+/// number of rows processed together by the binning kernels. This is a
+/// multiple of the validity bitmap word size, and fixes the order in which
+/// partial results are combined so they do not depend on the number of
+/// threads
+const int bin_block_size = 1 << 16;
+
+/// number of bin indices computed at once, before the bins are incremented
+const int bin_chunk_size = 256;
+
+/// counts the values x[i] with @p valid entry i into @p number_of_bins
+/// regular bins of width @p dx starting at @p min, and returns the counts
+///
+/// Values are counted into per-thread integer histograms that are merged at
+/// the end, each with an extra bin that collects the values outside the span
+/// (including NaNs)
+template <typename Iterator>
+std::vector<std::int64_t> count_bins(Iterator x, const ValidityBitmap &valid,
+                                     const float min, const float dx,
+                                     const int number_of_bins) {
+  const auto bins_f = static_cast<float>(number_of_bins);
+
+  // returns the bin index of x, or number_of_bins if x falls outside the span
+  auto bin_index = [=](const float x) {
+    const float t = (x - min) / dx;
+    return (t >= 0.f && t < bins_f) ? static_cast<int>(t) : number_of_bins;
+  };
+
+  const int rows = valid.size();
+  std::vector<std::vector<int>> thread_bins(
+      parallel_threads(parallel_blocks(rows, bin_block_size)),
+      std::vector<int>(number_of_bins + 1));
+  parallel_for_blocks(
+      rows, bin_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &bins = thread_bins[thread];
+        if (valid.all_valid()) {
+          // compute indices a chunk at a time so that the index calculation
+          // is free of branches and can be vectorised
+          int index[bin_chunk_size];
+          for (int chunk = begin; chunk < end; chunk += bin_chunk_size) {
+            const int m = std::min(bin_chunk_size, end - chunk);
+            for (int k = 0; k < m; ++k) {
+              index[k] = bin_index(x[chunk + k]);
+            }
+            for (int k = 0; k < m; ++k) {
+              ++bins[index[k]];
+            }
+          }
+        } else {
+          // skip missing values
+          valid.for_each_valid(begin, end, [&](const int i) {
+            ++bins[bin_index(x[i])];
+          });
+        }
+      });
+
+  std::vector<std::int64_t> counts(number_of_bins, 0);
+  for (const auto &bins : thread_bins) {
+    for (int i = 0; i < number_of_bins; ++i) {
+      counts[i] += bins[i];
+    }
+  }
+  return counts;
+}
+
+} // namespace
+
 DataWithAesthetic BinX::operator()(const DataWithAesthetic &data) {
   auto x_begin = data.begin<Aesthetic::x>();
   auto x_end = data.end<Aesthetic::x>();
+  const ValidityBitmap &valid = data.valid<Aesthetic::x>();
 
-  // if input data is empty then create an empty y aesthetic
-  if (std::distance(x_begin, x_end) == 0) {
+  // if input data is empty (or entirely missing) then create an empty y
+  // aesthetic
+  const int n = valid.size() - valid.null_count();
+  if (std::distance(x_begin, x_end) == 0 || n == 0) {
     std::vector<float> y;
     return create_data().y(y);
   }
 
-  auto minmax = std::minmax_element(x_begin, x_end);
+  if (m_span.is_empty() || m_number_of_bins == -1) {
+    // the span and the mean/variance come from the cached column statistics
+    const ColumnStatistics stats = data.statistics<Aesthetic::x>();
+
+    if (m_span.is_empty()) {
+      // increase the span slightly so round-off doesn't cause points to fall
+      // outside the domain
+      m_span.bmin[0] = stats.min - 1e4f * std::numeric_limits<float>::epsilon();
+      m_span.bmax[0] = stats.max + 1e4f * std::numeric_limits<float>::epsilon();
+    }
+
+    if (m_number_of_bins == -1) {
+      const auto stdev = static_cast<float>(std::sqrt(stats.variance));
+
+      // Scott, D. 1979.
+      // On optimal and data-based histograms.
+      // Biometrika, 66:605-610.
+      const float dx = 3.49f * stdev * std::pow(static_cast<float>(n), -0.33f);
+
+      // if calculated dx is too small then set number of bins to
+      // pre-determined number
+      if (dx > m_span.delta()[0] / 200.f) {
+        m_number_of_bins = static_cast<int>(std::round(m_span.delta()[0] / dx));
+      } else {
+        m_number_of_bins = 200;
+      }
+    }
+  }
+
+  // if the samples have already been indexed (e.g. by an interactive
+  // histogram) then count from the index rather than scanning the samples
+  const float dx = m_span.delta()[0] / m_number_of_bins;
+  const auto counts =
+      data.has_histogram_index<Aesthetic::x>()
+          ? data.histogram_index<Aesthetic::x>()->counts(
+                m_number_of_bins, m_span.bmin[0], m_span.bmax[0])
+          : count_bins(x_begin, valid, m_span.bmin[0], dx, m_number_of_bins);
+  std::vector<float> bin_y(counts.begin(), counts.end());
+
+  // return new data set, making sure to set ymin to zero
+  DataWithAesthetic ret;
+  ret.x(m_span.bmin[0], m_span.bmax[0]).y(bin_y);
+  ret.y(0.f, ret.limits().bmax[Aesthetic::y::index]);
+  return ret;
+}
+
+KDE::KDE(const int grid_size) : m_grid_size(grid_size) {}
+KDE::KDE(const int grid_size, const float bandwidth)
+    : m_grid_size(grid_size), m_bandwidth(bandwidth) {}
+
+DataWithAesthetic KDE::operator()(const DataWithAesthetic &data) {
+  auto x = data.begin<Aesthetic::x>();
+  const ValidityBitmap &valid = data.valid<Aesthetic::x>();
+  const ColumnStatistics stats = data.statistics<Aesthetic::x>();
+  const int n = stats.count;
+  if (n == 0) {
+    std::vector<float> empty;
+    return create_data().x(empty).y(empty);
+  }
+
+  const int rows = valid.size();
+  double h = m_bandwidth;
+  if (h <= 0) {
+    // the interquartile range is estimated with a quantile sketch of each
+    // block, merged in block order so that the bandwidth does not depend on
+    // the number of threads
+    std::vector<QuantileSketch> sketches(parallel_blocks(rows, bin_block_size));
+    parallel_for_blocks(
+        rows, bin_block_size,
+        [&](const int, const int block, const int begin, const int end) {
+          auto &sketch = sketches[block];
+          valid.for_each_valid(begin, end,
+                               [&](const int i) { sketch.add(x[i]); });
+        });
+    QuantileSketch all;
+    for (const auto &sketch : sketches) {
+      all.merge(sketch);
+    }
+    const double iqr = all.quantile(0.75f) - all.quantile(0.25f);
+    double spread = std::sqrt(stats.variance);
+    if (iqr > 0) {
+      spread = std::min(spread, iqr / 1.34);
+    }
+
+    // Silverman's rule of thumb
+    //
+    // Silverman, B. W. 1986.
+    // Density Estimation for Statistics and Data Analysis.
+    // Chapman and Hall, London. Equation 3.31.
+    h = 0.9 * spread * std::pow(n, -0.2);
+    if (h <= 0) {
+      // all samples are equal, so use a bandwidth relative to their value
+      h = std::max(1.0, std::abs(stats.mean)) * 1e-3;
+    }
+  }
+
+  // the grid extends 3 bandwidths beyond the samples on either side
+  const int g = next_power_of_two(std::max(m_grid_size, 2));
+  const double lo = stats.min - 3 * h;
+  const double hi = stats.max + 3 * h;
+  const double dx = (hi - lo) / (g - 1);
+
+  // linear binning, sharing each sample between its two nearest grid points
+  auto add = [&](std::vector<double> &grid, const float xi) {
+    const double t = (xi - lo) / dx;
+    const int j = std::min(std::max(static_cast<int>(t), 0), g - 2);
+    const double w = t - j;
+    grid[j] += 1 - w;
+    grid[j + 1] += w;
+  };
+  std::vector<std::vector<double>> thread_grids(
+      parallel_threads(parallel_blocks(rows, bin_block_size)),
+      std::vector<double>(g, 0.0));
+  parallel_for_blocks(
+      rows, bin_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &grid = thread_grids[thread];
+        valid.for_each_valid(begin, end, [&](const int i) { add(grid, x[i]); });
+      });
+
+  // zero pad to twice the grid size so that the circular convolution of the
+  // FFT does not wrap around
+  const int m = 2 * g;
+  std::vector<std::complex<double>> counts(m);
+  for (const auto &grid : thread_grids) {
+    for (int j = 0; j < g; ++j) {
+      counts[j] += grid[j];
+    }
+  }
+
+  // kernel evaluated at each grid offset, with negative offsets wrapped to
+  // the end
+  const double pi = 3.14159265358979323846;
+  const double norm = 1.0 / (n * h * std::sqrt(2 * pi));
+  std::vector<std::complex<double>> kernel(m);
+  for (int k = 0; k < g; ++k) {
+    const double u = k * dx / h;
+    kernel[k] = norm * std::exp(-0.5 * u * u);
+    if (k > 0) {
+      kernel[m - k] = kernel[k];
+    }
+  }
+
+  fft(counts);
+  fft(kernel);
+  for (int k = 0; k < m; ++k) {
+    counts[k] *= kernel[k];
+  }
+  fft(counts, true);
+
+  std::vector<float> grid_x(g);
+  std::vector<float> density(g);
+  for (int j = 0; j < g; ++j) {
+    grid_x[j] = static_cast<float>(lo + j * dx);
+    density[j] = static_cast<float>(std::max(0.0, counts[j].real()));
+  }
+
+  // return new data set, making sure to set ymin to zero
+  DataWithAesthetic ret;
+  ret.x(grid_x).y(density);
+  ret.y(0.f, ret.limits().bmax[Aesthetic::y::index]);
+  return ret;
+}
+
+Loess::Loess(const int grid_size) : m_grid_size(grid_size) {}
+Loess::Loess(const int grid_size, const float span)
+    : m_grid_size(grid_size), m_span(span) {
+  if (!(span > 0 && span <= 1)) {
+    throw Exception("Loess span must be in (0, 1]");
+  }
+}
+
+namespace {
+
+/// sufficient statistics of a linear fit to the points in a bin, with x
+/// measured from the bin centre to avoid cancellation
+struct LoessBin {
+  double n{0};
+  double sum_d{0};
+  double sum_dd{0};
+  double sum_y{0};
+  double sum_dy{0};
+
+  LoessBin &operator+=(const LoessBin &other) {
+    n += other.n;
+    sum_d += other.sum_d;
+    sum_dd += other.sum_dd;
+    sum_y += other.sum_y;
+    sum_dy += other.sum_dy;
+    return *this;
+  }
+};
+
+} // namespace
+
+DataWithAesthetic Loess::operator()(const DataWithAesthetic &data) {
+  auto x = data.begin<Aesthetic::x>();
+  auto y = data.begin<Aesthetic::y>();
+  const ValidityBitmap valid =
+      data.valid<Aesthetic::x>() & data.valid<Aesthetic::y>();
+  const int rows = valid.size();
+
+  // span of the points valid in both x and y
+  std::vector<bbox<float, 1>> block_span(parallel_blocks(rows, bin_block_size));
+  parallel_for_blocks(
+      rows, bin_block_size,
+      [&](const int, const int block, const int begin, const int end) {
+        bbox<float, 1> span;
+        valid.for_each_valid(begin, end, [&](const int i) {
+          span.bmin[0] = std::min(span.bmin[0], x[i]);
+          span.bmax[0] = std::max(span.bmax[0], x[i]);
+        });
+        block_span[block] = span;
+      });
+  bbox<float, 1> span;
+  for (const auto &s : block_span) {
+    span.bmin[0] = std::min(span.bmin[0], s.bmin[0]);
+    span.bmax[0] = std::max(span.bmax[0], s.bmax[0]);
+  }
+  if (span.is_empty()) {
+    std::vector<float> empty;
+    return create_data().x(empty).y(empty);
+  }
+
+  // bin the points into a grid four times finer than the output
+  const int g = std::max(m_grid_size, 2);
+  const int nbins = 4 * g;
+  const double lo = span.bmin[0];
+  const double width = std::max(double(span.bmax[0]) - lo,
+                                std::max(1.0, std::abs(lo)) * 1e-6);
+  const double dx = width / nbins;
+  const int threads = parallel_threads(parallel_blocks(rows, bin_block_size));
+  std::vector<std::vector<LoessBin>> thread_bins(
+      threads, std::vector<LoessBin>(nbins));
+  parallel_for_blocks(
+      rows, bin_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &bins = thread_bins[thread];
+        valid.for_each_valid(begin, end, [&](const int i) {
+          const int b = std::min(static_cast<int>((x[i] - lo) / dx), nbins - 1);
+          const double d = x[i] - (lo + (b + 0.5) * dx);
+          auto &bin = bins[b];
+          bin.n += 1;
+          bin.sum_d += d;
+          bin.sum_dd += d * d;
+          bin.sum_y += y[i];
+          bin.sum_dy += d * y[i];
+        });
+      });
+  std::vector<LoessBin> bins(nbins);
+  std::vector<double> cumulative(nbins + 1, 0.0);
+  for (int b = 0; b < nbins; ++b) {
+    for (const auto &thread : thread_bins) {
+      bins[b] += thread[b];
+    }
+    cumulative[b + 1] = cumulative[b] + bins[b].n;
+  }
+  const double n = cumulative[nbins];
+  const double q = std::max(1.0, std::ceil(m_span * n));
+
+  // local linear fit at each grid position
+  std::vector<float> grid_x(g);
+  std::vector<float> fit(g);
+  parallel_for_blocks(
+      g, 16, [&](const int, const int, const int begin, const int end) {
+        for (int j = begin; j < end; ++j) {
+          const double x0 = lo + j * width / (g - 1);
+          const int centre =
+              std::min(static_cast<int>((x0 - lo) / dx), nbins - 1);
+
+          // smallest radius (in bins) of a window holding q points
+          auto count = [&](const int r) {
+            return cumulative[std::min(centre + r + 1, nbins)] -
+                   cumulative[std::max(centre - r, 0)];
+          };
+          int r_lo = 0;
+          int r_hi = nbins;
+          while (r_lo < r_hi) {
+            const int r = (r_lo + r_hi) / 2;
+            if (count(r) >= q) {
+              r_hi = r;
+            } else {
+              r_lo = r + 1;
+            }
+          }
+
+          // tricube weights, with the bandwidth reaching just past the furthest
+          // bin in the window
+          const double h = (r_lo + 1) * dx;
+          double s0 = 0, s1 = 0, s2 = 0, t0 = 0, t1 = 0;
+          const int first = std::max(centre - r_lo, 0);
+          const int last = std::min(centre + r_lo, nbins - 1);
+          for (int b = first; b <= last; ++b) {
+            const LoessBin &bin = bins[b];
+            if (bin.n == 0) {
+              continue;
+            }
+            const double e = lo + (b + 0.5) * dx - x0;
+            const double u = std::min(std::abs(e) / h, 1.0);
+            const double v = 1 - u * u * u;
+            const double w = v * v * v;
+            s0 += w * bin.n;
+            s1 += w * (bin.sum_d + bin.n * e);
+            s2 += w * (bin.sum_dd + 2 * e * bin.sum_d + bin.n * e * e);
+            t0 += w * bin.sum_y;
+            t1 += w * (bin.sum_dy + e * bin.sum_y);
+          }
+
+          // weighted least squares in (x - x0), evaluated at x0. Falls back to
+          // the weighted mean if the window has no spread in x
+          const double det = s0 * s2 - s1 * s1;
+          double value = t0 / s0;
+          if (det > 1e-12 * s0 * s2) {
+            const double slope = (s0 * t1 - s1 * t0) / det;
+            value = (t0 - slope * s1) / s0;
+          }
+          grid_x[j] = static_cast<float>(x0);
+          fit[j] = static_cast<float>(value);
+        }
+      });
+
+  return create_data().x(grid_x).y(fit);
+}
+
+ECDF::ECDF(const int points) : m_points(points) {}
+
+DataWithAesthetic ECDF::operator()(const DataWithAesthetic &data) {
+  // sorted samples, along with the cumulative weight of each sample and all
+  // those before it if weighted
+  std::shared_ptr<const HistogramIndex> index;
+  std::vector<std::pair<float, float>> weighted;
+  std::vector<double> cumulative;
+  if (m_weight_begin) {
+    auto x = data.begin<Aesthetic::x>();
+    auto w = m_weight_begin(data);
+    const ValidityBitmap valid =
+        data.valid<Aesthetic::x>() & m_weight_valid(data);
+    weighted.reserve(valid.size() - valid.null_count());
+    valid.for_each_valid([&](const int i) {
+      if (w[i] < 0) {
+        throw Exception("ECDF weights must be non-negative");
+      }
+      weighted.emplace_back(x[i], w[i]);
+    });
+    parallel_sort(weighted.begin(), weighted.end(),
+                  [](const std::pair<float, float> &a,
+                     const std::pair<float, float> &b) {
+                    return a.first < b.first;
+                  });
+    cumulative.resize(weighted.size());
+    double sum = 0;
+    for (std::size_t i = 0; i < weighted.size(); ++i) {
+      sum += weighted[i].second;
+      cumulative[i] = sum;
+    }
+  } else {
+    index = data.histogram_index<Aesthetic::x>();
+  }
+  const int n = m_weight_begin ? static_cast<int>(weighted.size())
+                               : index->size();
+  auto value = [&](const int i) {
+    return m_weight_begin ? weighted[i].first : index->sorted()[i];
+  };
+  auto cumulative_at = [&](const int i) {
+    return m_weight_begin ? cumulative[i] : i + 1.0;
+  };
+  const double total = n > 0 ? cumulative_at(n - 1) : 0.0;
+
+  std::vector<float> step_x;
+  std::vector<float> step_y;
+  if (n == 0 || !(total > 0)) {
+    return create_data().x(step_x).y(step_y);
+  }
+
+  // each step goes to the end of the run of samples equal to the first
+  // sample reaching the next quantile, or to the next distinct sample if
+  // there are few enough
+  const int steps = std::max(1, m_points / 2);
+  const bool exact = n <= steps;
+  step_x.reserve(2 * std::min(n, steps));
+  step_y.reserve(2 * std::min(n, steps));
+  double previous = 0;
+  int i = 0;
+  for (int k = 1; i < n; ++k) {
+    int j = i;
+    if (!exact) {
+      // first sample with cumulative weight reaching the quantile
+      const double target = total * std::min(k, steps) / steps;
+      int lo = i;
+      int hi = n - 1;
+      while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (cumulative_at(mid) >= target) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      j = lo;
+    }
+    const float x = value(j);
+    while (j + 1 < n && !(x < value(j + 1))) {
+      ++j;
+    }
+    step_x.push_back(x);
+    step_y.push_back(static_cast<float>(previous / total));
+    previous = cumulative_at(j);
+    step_x.push_back(x);
+    step_y.push_back(static_cast<float>(previous / total));
+    i = j + 1;
+  }
+
+  DataWithAesthetic ret;
+  ret.x(step_x).y(step_y);
+  ret.y(0.f, 1.f);
+  return ret;
+}
+
+std::vector<DataWithAesthetic>
+ECDF::operator()(const std::vector<DataWithAesthetic> &data) {
+  const int n = static_cast<int>(data.size());
+  std::vector<DataWithAesthetic> result(n);
+  if (n < get_num_threads()) {
+    for (int i = 0; i < n; ++i) {
+      result[i] = (*this)(data[i]);
+    }
+    return result;
+  }
+  parallel_for_blocks(
+      n, 1, [&](const int, const int, const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+          result[i] = (*this)(data[i]);
+        }
+      });
+  return result;
+}
+
+BinXY::BinXY(const int nx, const int ny) : m_nx(nx), m_ny(ny) {}
+BinXY::BinXY(const int nx, const int ny, const bfloat2_t &span)
+    : m_nx(nx), m_ny(ny), m_span(span) {}
+
+DataWithAesthetic BinXY::operator()(const DataWithAesthetic &data) {
+  auto x = data.begin<Aesthetic::x>();
+  auto y = data.begin<Aesthetic::y>();
+  const bool have_value = m_statistic != Statistic::count;
+  auto value = have_value ? m_value_begin(data) : x;
+  auto valid = data.valid<Aesthetic::x>() & data.valid<Aesthetic::y>();
+  if (have_value) {
+    valid = valid & m_value_valid(data);
+  }
+  const int rows = valid.size();
 
   if (m_span.is_empty()) {
+    // span of the valid points, combined in block order
+    std::vector<bfloat2_t> block_span(parallel_blocks(rows, bin_block_size));
+    parallel_for_blocks(
+        rows, bin_block_size,
+        [&](const int, const int block, const int begin, const int end) {
+          bfloat2_t span;
+          valid.for_each_valid(begin, end, [&](const int i) {
+            span.bmin[0] = std::min(span.bmin[0], x[i]);
+            span.bmin[1] = std::min(span.bmin[1], y[i]);
+            span.bmax[0] = std::max(span.bmax[0], x[i]);
+            span.bmax[1] = std::max(span.bmax[1], y[i]);
+          });
+          block_span[block] = span;
+        });
+    for (const auto &span : block_span) {
+      m_span += span;
+    }
+    if (m_span.bmax[0] < m_span.bmin[0]) {
+      // no valid points, use a unit span
+      m_span = bfloat2_t(vfloat2_t(0.f, 0.f), vfloat2_t(1.f, 1.f));
+    }
+
     // increase the span slightly so round-off doesn't cause points to fall
     // outside the domain
-    m_span.bmin[0] =
-        *minmax.first - 1e4f * std::numeric_limits<float>::epsilon();
-    m_span.bmin[1] =
-        *minmax.second + 1e4f * std::numeric_limits<float>::epsilon();
-  }
-
-  if (m_number_of_bins == -1) {
-    auto sum = std::accumulate(x_begin, x_end, 0.f);
-    auto mean = sum / data.rows();
-
-    // note: use std::transform_reduce after c++17
-    std::vector<float> diff(data.rows());
-    std::transform(x_begin, x_end, diff.begin(),
-                   [mean](float x) { return x - mean; });
-    auto sq_sum =
-        std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.f);
-    auto stdev = std::sqrt(sq_sum / data.rows());
-
-    // Scott, D. 1979.
-    // On optimal and data-based histograms.
-    // Biometrika, 66:605-610.
-    const float dx =
-        3.49f * stdev * std::pow(static_cast<float>(data.rows()), -0.33f);
-
-    // if calculated dx is too small then set number of bins to pre-determined
-    // number
-    if (dx > m_span.delta()[0] / 200.f) {
-      m_number_of_bins = static_cast<int>(std::round(m_span.delta()[0] / dx));
+    m_span.bmin -= 1e4f * std::numeric_limits<float>::epsilon();
+    m_span.bmax += 1e4f * std::numeric_limits<float>::epsilon();
+  }
+
+  const int nx = m_nx;
+  const int ny = m_ny;
+  const int cells = nx * ny;
+  const vfloat2_t min = m_span.bmin;
+  const vfloat2_t dx = m_span.delta() / vfloat2_t(static_cast<float>(nx),
+                                                  static_cast<float>(ny));
+  const auto nx_f = static_cast<float>(nx);
+  const auto ny_f = static_cast<float>(ny);
+
+  // returns the cell index of (x, y), or cells if it falls outside the span
+  auto cell_index = [=](const float x, const float y) {
+    const float tx = (x - min[0]) / dx[0];
+    const float ty = (y - min[1]) / dx[1];
+    const bool inside = tx >= 0.f && tx < nx_f && ty >= 0.f && ty < ny_f;
+    return inside ? static_cast<int>(ty) * nx + static_cast<int>(tx) : cells;
+  };
+
+  // accumulate into per-thread grids, each with an extra cell that collects
+  // the points outside the span. Cell indices are computed a chunk at a
+  // time, so that the index calculation can be vectorised and the scattered
+  // increments of a chunk hit a small working set of the grid
+  const int threads = parallel_threads(parallel_blocks(rows, bin_block_size));
+  std::vector<std::vector<int>> thread_counts(threads,
+                                              std::vector<int>(cells + 1));
+  std::vector<std::vector<double>> thread_sums(
+      have_value ? threads : 0, std::vector<double>(cells + 1));
+  parallel_for_blocks(
+      rows, bin_block_size,
+      [&](const int thread, const int, const int begin, const int end) {
+        auto &counts = thread_counts[thread];
+        int index[bin_chunk_size];
+        int row[bin_chunk_size];
+        for (int chunk = begin; chunk < end; chunk += bin_chunk_size) {
+          int m = 0;
+          if (valid.all_valid()) {
+            m = std::min(bin_chunk_size, end - chunk);
+            for (int k = 0; k < m; ++k) {
+              row[k] = chunk + k;
+              index[k] = cell_index(x[chunk + k], y[chunk + k]);
+            }
+          } else {
+            valid.for_each_valid(
+                chunk, std::min(chunk + bin_chunk_size, end), [&](const int i) {
+                  row[m] = i;
+                  index[m++] = cell_index(x[i], y[i]);
+                });
+          }
+          for (int k = 0; k < m; ++k) {
+            ++counts[index[k]];
+          }
+          if (have_value) {
+            auto &sums = thread_sums[thread];
+            for (int k = 0; k < m; ++k) {
+              sums[index[k]] += value[row[k]];
+            }
+          }
+        }
+      });
+
+  // merge the per-thread grids, in parallel over the cells
+  std::vector<float> fill(cells);
+  parallel_for_blocks(
+      cells, bin_block_size,
+      [&](const int, const int, const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+          std::int64_t count = 0;
+          double sum = 0;
+          for (int t = 0; t < threads; ++t) {
+            count += thread_counts[t][i];
+            if (have_value) {
+              sum += thread_sums[t][i];
+            }
+          }
+          switch (m_statistic) {
+          case Statistic::count:
+            fill[i] = static_cast<float>(count);
+            break;
+          case Statistic::sum:
+            fill[i] = static_cast<float>(sum);
+            break;
+          case Statistic::mean:
+            fill[i] = count > 0 ? static_cast<float>(sum / count)
+                                : std::numeric_limits<float>::quiet_NaN();
+            break;
+          }
+        }
+      });
+
+  std::vector<float> xmin(cells);
+  std::vector<float> xmax(cells);
+  std::vector<float> ymin(cells);
+  std::vector<float> ymax(cells);
+  for (int j = 0; j < ny; ++j) {
+    for (int i = 0; i < nx; ++i) {
+      const int cell = j * nx + i;
+      xmin[cell] = min[0] + i * dx[0];
+      xmax[cell] = min[0] + (i + 1) * dx[0];
+      ymin[cell] = min[1] + j * dx[1];
+      ymax[cell] = min[1] + (j + 1) * dx[1];
+    }
+  }
+
+  return create_data().xmin(xmin).xmax(xmax).ymin(ymin).ymax(ymax).fill(fill);
+}
+
+namespace {
+
+/// compensated (Neumaier) running sum of the y values in a window
+struct RollingSum {
+  const std::vector<float> &y;
+  double sum{0};
+  double compensation{0};
+
+  explicit RollingSum(const std::vector<float> &y) : y(y) {}
+
+  void accumulate(const double v) {
+    const double t = sum + v;
+    if (std::abs(sum) >= std::abs(v)) {
+      compensation += (sum - t) + v;
     } else {
-      m_number_of_bins = 200;
+      compensation += (v - t) + sum;
     }
+    sum = t;
   }
+  void add(const int i) { accumulate(y[i]); }
+  void remove(const int i) { accumulate(-static_cast<double>(y[i])); }
+  double value(const int) const { return sum + compensation; }
+};
 
-  const float dx = m_span.delta()[0] / m_number_of_bins;
+struct RollingMean : RollingSum {
+  using RollingSum::RollingSum;
+  double value(const int count) const {
+    return RollingSum::value(count) / count;
+  }
+};
+
+/// Welford's algorithm, extended to remove values from the window
+struct RollingStdev {
+  const std::vector<float> &y;
+  int n{0};
+  double mean{0};
+  double m2{0};
+
+  explicit RollingStdev(const std::vector<float> &y) : y(y) {}
+
+  void add(const int i) {
+    ++n;
+    const double delta = y[i] - mean;
+    mean += delta / n;
+    m2 += delta * (y[i] - mean);
+  }
+  void remove(const int i) {
+    if (--n == 0) {
+      mean = 0;
+      m2 = 0;
+      return;
+    }
+    const double delta = y[i] - mean;
+    mean -= delta / n;
+    m2 -= delta * (y[i] - mean);
+  }
+  double value(const int) const {
+    return n > 1 ? std::sqrt(std::max(0.0, m2) / (n - 1)) : 0.0;
+  }
+};
 
-  std::vector<float> bin_y(m_number_of_bins);
+/// monotonic deque of indices, whose front is the extreme value in the
+/// window according to Compare
+template <typename Compare> struct RollingExtreme {
+  const std::vector<float> &y;
+  std::deque<int> indices;
 
-  // zero y bin values
-  std::fill(bin_y.begin(), bin_y.end(), 0.f);
+  explicit RollingExtreme(const std::vector<float> &y) : y(y) {}
+
+  void add(const int i) {
+    // values that can never be the extreme again are discarded
+    while (!indices.empty() && !Compare()(y[indices.back()], y[i])) {
+      indices.pop_back();
+    }
+    indices.push_back(i);
+  }
+  void remove(const int i) {
+    if (indices.front() == i) {
+      indices.pop_front();
+    }
+  }
+  double value(const int) const { return y[indices.front()]; }
+};
 
-  //  accumulate data into histogram
-  std::for_each(x_begin, x_end, [&](const float x) {
-    const auto i = static_cast<int>(std::floor((x - m_span.bmin[0]) / dx));
-    if (i >= 0 && i < m_number_of_bins) {
-      ++(bin_y[i]);
+/// slides a window over points [start, end), writing the statistic of the
+/// window ending at each point in [begin, end) to @p out
+template <typename Kernel, typename Outside>
+void rolling_block(Kernel kernel, const Outside &outside, const int start,
+                   const int begin, const int end, std::vector<float> &out) {
+  int lo = start;
+  for (int i = start; i < end; ++i) {
+    kernel.add(i);
+    while (outside(lo, i)) {
+      kernel.remove(lo++);
     }
+    if (i >= begin) {
+      out[i] = static_cast<float>(kernel.value(i - lo + 1));
+    }
+  }
+}
+
+} // namespace
+
+Rolling::Rolling(const Statistic statistic, const Window window,
+                 const float size)
+    : m_statistic(statistic), m_window(window), m_size(size) {
+  if (!(size > 0) || (window == Window::rows && size < 1)) {
+    throw Exception("rolling window must hold at least one point");
+  }
+}
+
+DataWithAesthetic Rolling::operator()(const DataWithAesthetic &data) {
+  auto x_begin = data.begin<Aesthetic::x>();
+  auto y_begin = data.begin<Aesthetic::y>();
+  const auto valid = data.valid<Aesthetic::x>() & data.valid<Aesthetic::y>();
+
+  // gather the valid points, so that windows are contiguous
+  std::vector<float> x;
+  std::vector<float> y;
+  x.reserve(valid.size() - valid.null_count());
+  y.reserve(valid.size() - valid.null_count());
+  valid.for_each_valid([&](const int i) {
+    x.push_back(x_begin[i]);
+    y.push_back(y_begin[i]);
   });
+  const int n = static_cast<int>(x.size());
+
+  const bool by_rows = m_window == Window::rows;
+  const int rows = static_cast<int>(std::round(m_size));
+  const float span = m_size;
+  if (!by_rows && !std::is_sorted(x.begin(), x.end())) {
+    throw Exception("rolling window over a span of x requires sorted x");
+  }
+  auto outside = [&](const int lo, const int i) {
+    return by_rows ? i - lo >= rows : x[lo] <= x[i] - span;
+  };
+
+  // each block starts its window early (the halo), so that the first window
+  // of the block is complete
+  std::vector<float> out(n);
+  parallel_for_blocks(
+      n, bin_block_size,
+      [&](const int, const int, const int begin, const int end) {
+        const int start =
+            by_rows ? std::max(0, begin - rows + 1)
+                    : static_cast<int>(
+                          std::upper_bound(x.begin(), x.begin() + begin,
+                                           x[begin] - span) -
+                          x.begin());
+        switch (m_statistic) {
+        case Statistic::mean:
+          rolling_block(RollingMean(y), outside, start, begin, end, out);
+          break;
+        case Statistic::sum:
+          rolling_block(RollingSum(y), outside, start, begin, end, out);
+          break;
+        case Statistic::min:
+          rolling_block(RollingExtreme<std::less<float>>(y), outside, start,
+                        begin, end, out);
+          break;
+        case Statistic::max:
+          rolling_block(RollingExtreme<std::greater<float>>(y), outside,
+                        start, begin, end, out);
+          break;
+        case Statistic::stdev:
+          rolling_block(RollingStdev(y), outside, start, begin, end, out);
+          break;
+        }
+      });
+
+  return create_data().x(x).y(out);
+}
+
+namespace {
+
+/// number of buckets processed together when downsampling
+const int lttb_block_size = 64;
+
+/// returns the indices of the vertices of the convex hull of the points
+/// [@p begin, @p end), using Andrew's monotone chain algorithm
+std::vector<int> convex_hull(const ColumnIterator &x, const ColumnIterator &y,
+                             const int begin, const int end) {
+  std::vector<int> points(end - begin);
+  std::iota(points.begin(), points.end(), begin);
+  if (points.size() <= 2) {
+    return points;
+  }
+  auto less = [&](const int a, const int b) {
+    return x[a] < x[b] || (x[a] == x[b] && y[a] < y[b]);
+  };
+  // line data is usually already sorted by x
+  if (!std::is_sorted(points.begin(), points.end(), less)) {
+    std::sort(points.begin(), points.end(), less);
+  }
+  auto cross = [&](const int o, const int a, const int b) {
+    return (static_cast<double>(x[a]) - x[o]) * (y[b] - y[o]) -
+           (static_cast<double>(y[a]) - y[o]) * (x[b] - x[o]);
+  };
+
+  std::vector<int> hull(2 * points.size());
+  int k = 0;
+  // lower hull
+  for (const int p : points) {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], p) <= 0) {
+      --k;
+    }
+    hull[k++] = p;
+  }
+  // upper hull
+  const int lower = k + 1;
+  for (auto p = points.rbegin() + 1; p != points.rend(); ++p) {
+    while (k >= lower && cross(hull[k - 2], hull[k - 1], *p) <= 0) {
+      --k;
+    }
+    hull[k++] = *p;
+  }
+  hull.resize(k - 1);
+  return hull;
+}
+
+/// downsamples the @p length points starting at @p begin to @p target
+/// points, appending them to @p out_x and @p out_y
+void lttb_run(const ColumnIterator &x, const ColumnIterator &y,
+              const int begin, const int length, const int target,
+              std::vector<float> &out_x, std::vector<float> &out_y) {
+  const int last = begin + length - 1;
+  const int buckets = target - 2;
+  const double every = static_cast<double>(length - 2) / buckets;
+  auto bucket_begin = [&](const int b) {
+    return begin + 1 + static_cast<int>(b * every);
+  };
+  auto bucket_end = [&](const int b) {
+    return b == buckets - 1 ? last : bucket_begin(b + 1);
+  };
+
+  // the mean and convex hull of each bucket are independent
+  std::vector<double> mean_x(buckets);
+  std::vector<double> mean_y(buckets);
+  std::vector<std::vector<int>> hulls(buckets);
+  parallel_for_blocks(
+      buckets, lttb_block_size,
+      [&](const int, const int, const int block_begin, const int block_end) {
+        for (int b = block_begin; b < block_end; ++b) {
+          double sum_x = 0;
+          double sum_y = 0;
+          for (int i = bucket_begin(b); i < bucket_end(b); ++i) {
+            sum_x += x[i];
+            sum_y += y[i];
+          }
+          const int count = bucket_end(b) - bucket_begin(b);
+          mean_x[b] = sum_x / count;
+          mean_y[b] = sum_y / count;
+          hulls[b] = convex_hull(x, y, bucket_begin(b), bucket_end(b));
+        }
+      });
+
+  // choose the point of each bucket in turn. The area of the triangle is
+  // linear in the chosen point, so its maximum is at a hull vertex
+  out_x.push_back(x[begin]);
+  out_y.push_back(y[begin]);
+  int a = begin;
+  for (int b = 0; b < buckets; ++b) {
+    const double cx = b + 1 < buckets ? mean_x[b + 1] : x[last];
+    const double cy = b + 1 < buckets ? mean_y[b + 1] : y[last];
+    const double ax = x[a];
+    const double ay = y[a];
+    int best = -1;
+    double best_area = -1;
+    for (const int i : hulls[b]) {
+      const double area =
+          std::abs((ax - cx) * (y[i] - ay) - (ax - x[i]) * (cy - ay));
+      if (area > best_area || (area == best_area && i < best)) {
+        best_area = area;
+        best = i;
+      }
+    }
+    out_x.push_back(x[best]);
+    out_y.push_back(y[best]);
+    a = best;
+  }
+  out_x.push_back(x[last]);
+  out_y.push_back(y[last]);
+}
+
+} // namespace
+
+LTTB::LTTB(const int points) : m_points(points) {
+  if (points < 3) {
+    throw Exception("LTTB requires a target of at least 3 points");
+  }
+}
+
+LTTB::LTTB(const Axis &axis, const int points_per_pixel)
+    : LTTB(std::max(3, static_cast<int>(points_per_pixel *
+                                        axis.pixels().delta()[0]))) {}
+
+DataWithAesthetic LTTB::operator()(const DataWithAesthetic &data) {
+  auto x = data.begin<Aesthetic::x>();
+  auto y = data.begin<Aesthetic::y>();
+  if (data.rows() <= m_points) {
+    return data;
+  }
+  const auto valid = data.valid<Aesthetic::x>() & data.valid<Aesthetic::y>();
+  const int n = valid.size() - valid.null_count();
+
+  // runs of consecutive valid points
+  std::vector<std::pair<int, int>> runs;
+  valid.for_each_valid([&](const int i) {
+    if (!runs.empty() && runs.back().first + runs.back().second == i) {
+      ++runs.back().second;
+    } else {
+      runs.emplace_back(i, 1);
+    }
+  });
+
+  // each group of runs costs at least one point, plus a missing point to
+  // separate it from the previous group. If there are too many runs for the
+  // target, neighbouring runs are merged into groups of similar numbers of
+  // points (dropping the gaps between them)
+  const int max_groups = (m_points + 1) / 2;
+  const int number_of_runs = static_cast<int>(runs.size());
+  std::vector<std::pair<int, int>> groups; // [first run, last run)
+  for (int r = 0, count = 0; r < number_of_runs; ++r) {
+    const bool split =
+        number_of_runs <= max_groups ||
+        static_cast<std::int64_t>(count) * max_groups >=
+            static_cast<std::int64_t>(groups.size()) * n;
+    if (groups.empty() || split) {
+      groups.emplace_back(r, r + 1);
+    } else {
+      groups.back().second = r + 1;
+    }
+    count += runs[r].second;
+  }
+
+  // every group is given one point, and the rest of the target (after the
+  // separating missing points) is shared in proportion to the length of
+  // each group, so that the output never has more than m_points rows
+  const int number_of_groups = static_cast<int>(groups.size());
+  const std::int64_t spare = m_points - 2 * number_of_groups + 1;
+  const std::int64_t spare_points = n - number_of_groups;
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> out_x;
+  std::vector<float> out_y;
+  out_x.reserve(m_points);
+  out_y.reserve(m_points);
+  std::vector<float> group_x;
+  std::vector<float> group_y;
+  for (const auto &group : groups) {
+    if (!out_x.empty()) {
+      out_x.push_back(nan);
+      out_y.push_back(nan);
+    }
+
+    // the valid points of a merged group are gathered so that they can be
+    // downsampled as a single run
+    ColumnIterator gx = x;
+    ColumnIterator gy = y;
+    int begin = runs[group.first].first;
+    int length = runs[group.first].second;
+    if (group.second - group.first > 1) {
+      group_x.clear();
+      group_y.clear();
+      for (int r = group.first; r < group.second; ++r) {
+        for (int i = runs[r].first; i < runs[r].first + runs[r].second; ++i) {
+          group_x.push_back(x[i]);
+          group_y.push_back(y[i]);
+        }
+      }
+      gx = ColumnIterator(group_x.cbegin(), 1);
+      gy = ColumnIterator(group_y.cbegin(), 1);
+      begin = 0;
+      length = static_cast<int>(group_x.size());
+    }
+
+    const int target =
+        1 + static_cast<int>(spare_points > 0
+                                 ? spare * (length - 1) / spare_points
+                                 : 0);
+    if (length <= target) {
+      for (int i = begin; i < begin + length; ++i) {
+        out_x.push_back(gx[i]);
+        out_y.push_back(gy[i]);
+      }
+    } else if (target < 3) {
+      // too few points for a bucket, keep the ends of the run
+      out_x.push_back(gx[begin]);
+      out_y.push_back(gy[begin]);
+      if (target == 2) {
+        out_x.push_back(gx[begin + length - 1]);
+        out_y.push_back(gy[begin + length - 1]);
+      }
+    } else {
+      lttb_run(gx, gy, begin, length, target, out_x, out_y);
+    }
+  }
+
+  return create_data().x(out_x).y(out_y);
+}
+
+HistogramAccumulator::HistogramAccumulator(const int number_of_bins,
+                                           const float min, const float max)
+    : m_number_of_bins(number_of_bins),
+      m_span(Vector<float, 1>(min), Vector<float, 1>(max)),
+      m_counts(number_of_bins, 0.0) {
+  if (number_of_bins <= 0 || !(min < max)) {
+    throw Exception("histogram accumulator requires at least one bin and min "
+                    "< max");
+  }
+}
+
+void HistogramAccumulator::set_window(const int number_of_chunks) {
+  m_window = std::max(0, number_of_chunks);
+  if (m_window == 0) {
+    m_chunks.clear();
+  }
+}
+
+void HistogramAccumulator::set_decay(const float factor) { m_decay = factor; }
+
+void HistogramAccumulator::add(const DataWithAesthetic &data) {
+  const float dx = m_span.delta()[0] / m_number_of_bins;
+  const auto counts = count_bins(data.begin<Aesthetic::x>(),
+                                 data.valid<Aesthetic::x>(), m_span.bmin[0],
+                                 dx, m_number_of_bins);
+  add_chunk(std::vector<double>(counts.begin(), counts.end()));
+}
+
+void HistogramAccumulator::add(const std::vector<float> &x) {
+  // NaNs always fall outside the bins, so need no validity bitmap
+  const float dx = m_span.delta()[0] / m_number_of_bins;
+  const auto counts =
+      count_bins(x.data(), ValidityBitmap(static_cast<int>(x.size())),
+                 m_span.bmin[0], dx, m_number_of_bins);
+  add_chunk(std::vector<double>(counts.begin(), counts.end()));
+}
+
+void HistogramAccumulator::add_chunk(std::vector<double> chunk) {
+  if (m_window == 0) {
+    for (int i = 0; i < m_number_of_bins; ++i) {
+      m_counts[i] = m_decay * m_counts[i] + chunk[i];
+    }
+    return;
+  }
+
+  m_chunks.push_back(std::move(chunk));
+  if (static_cast<int>(m_chunks.size()) > m_window) {
+    m_chunks.pop_front();
+  }
+
+  // recompute the windowed counts, rather than subtracting the oldest chunk,
+  // so that round-off does not accumulate over an unbounded stream
+  std::fill(m_counts.begin(), m_counts.end(), 0.0);
+  for (const auto &c : m_chunks) {
+    for (int i = 0; i < m_number_of_bins; ++i) {
+      m_counts[i] = m_decay * m_counts[i] + c[i];
+    }
+  }
+}
+
+void HistogramAccumulator::merge(const HistogramAccumulator &other) {
+  if (other.m_number_of_bins != m_number_of_bins ||
+      other.m_span.bmin[0] != m_span.bmin[0] ||
+      other.m_span.bmax[0] != m_span.bmax[0]) {
+    throw Exception("can only merge histogram accumulators with identical "
+                    "bin edges");
+  }
+  for (int i = 0; i < m_number_of_bins; ++i) {
+    m_counts[i] += other.m_counts[i];
+  }
+  if (m_window > 0) {
+    if (m_chunks.empty()) {
+      m_chunks.emplace_back(m_number_of_bins, 0.0);
+    }
+    auto &chunk = m_chunks.back();
+    for (int i = 0; i < m_number_of_bins; ++i) {
+      chunk[i] += other.m_counts[i];
+    }
+  }
+}
+
+void HistogramAccumulator::clear() {
+  std::fill(m_counts.begin(), m_counts.end(), 0.0);
+  m_chunks.clear();
+}
+
+DataWithAesthetic HistogramAccumulator::snapshot() const {
+  std::vector<float> bin_y(m_counts.begin(), m_counts.end());
 
   // return new data set, making sure to set ymin to zero
   DataWithAesthetic ret;
@@ -116,4 +1222,15 @@ DataWithAesthetic BinX::operator()(const DataWithAesthetic &data) {
   return ret;
 }
 
+AccumulateBinX::AccumulateBinX(
+    std::shared_ptr<HistogramAccumulator> accumulator)
+    : m_accumulator(std::move(accumulator)) {}
+
+DataWithAesthetic AccumulateBinX::operator()(const DataWithAesthetic &data) {
+  if (data.rows() > 0) {
+    m_accumulator->add(data);
+  }
+  return m_accumulator->snapshot();
+}
+
 } // namespace trase
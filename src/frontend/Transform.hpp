@@ -36,13 +36,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TRANSFORM_H_
 #define TRANSFORM_H_
 
+#include <deque>
 #include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include "frontend/Contour.hpp"
 #include "frontend/Data.hpp"
+#include "frontend/GroupBy.hpp"
+#include "frontend/Pipeline.hpp"
+#include "frontend/Quantile.hpp"
+#include "frontend/Sample.hpp"
+#include "frontend/TransformCache.hpp"
 #include "util/BBox.hpp"
 
 namespace trase {
 
+// forward declare to be able to size transforms to an axis
+class Axis;
+
 /// Identity transform, just pass through...
 struct Identity {
   DataWithAesthetic operator()(const DataWithAesthetic &data) const {
@@ -62,26 +76,402 @@ public:
   explicit BinX(int number_of_bins);
   explicit BinX(int number_of_bins, float min, float max);
   DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters and state of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_number_of_bins, m_span.bmin[0], m_span.bmax[0]);
+  }
+};
+
+/// kernel density estimate of the x coordinates, using a Gaussian kernel
+///
+/// The samples are linearly binned onto a regular grid, which is convolved
+/// with the kernel using an FFT, so the cost is O(n + g log g) for n samples
+/// and a grid of g points. The output gives the grid in the x aesthetic and
+/// the density in the y aesthetic, ready for drawing with Axis::line. By
+/// default the bandwidth is chosen using Silverman's rule of thumb,
+/// 0.9 min(stdev, IQR / 1.34) n^-1/5. Requires x aesthetic.
+class KDE {
+  int m_grid_size{512};
+  float m_bandwidth{0};
+
+public:
+  KDE() = default;
+
+  /// evaluate the density at @p grid_size points (rounded up to a power of
+  /// two)
+  explicit KDE(int grid_size);
+
+  /// evaluate the density at @p grid_size points (rounded up to a power of
+  /// two), using a kernel with standard deviation @p bandwidth
+  explicit KDE(int grid_size, float bandwidth);
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_grid_size, m_bandwidth);
+  }
+};
+
+/// smooths y as a function of x by local linear regression (LOESS)
+///
+/// Cleveland, W. S. 1979.
+/// Robust Locally Weighted Regression and Smoothing Scatterplots.
+/// Journal of the American Statistical Association, 74(368):829-836.
+///
+/// The fit is evaluated on a regular grid of x positions spanning the data.
+/// Rather than weighting every point for every grid position (which costs
+/// O(n^2) for an exact LOESS), the points are first binned into a finer
+/// regular grid of bins holding the sufficient statistics of a linear fit.
+/// Each grid position then combines the nearest bins holding at least the
+/// given fraction of the points, weighted by the tricube kernel at the bin
+/// centres, so the cost is O(n + g w) for a grid of g points and windows of
+/// w bins. The output gives the grid in the x aesthetic and the fit in the y
+/// aesthetic, ready for drawing with Axis::line. Requires x and y
+/// aesthetics.
+class Loess {
+  int m_grid_size{256};
+  float m_span{0.3f};
+
+public:
+  Loess() = default;
+
+  /// evaluate the fit at @p grid_size points
+  explicit Loess(int grid_size);
+
+  /// evaluate the fit at @p grid_size points, each using the nearest
+  /// fraction @p span (in (0, 1]) of the points
+  Loess(int grid_size, float span);
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const { return make_cache_key(m_grid_size, m_span); }
+};
+
+/// empirical cumulative distribution function of the x coordinates
+///
+/// The valid samples are sorted in parallel (reusing the sorted copy of the
+/// column kept for histograms, see RawData::histogram_index, if unweighted).
+/// Rather than a step for every sample, the output has at most the given
+/// number of points, forming steps at evenly spaced quantiles, with each step
+/// at a sample value and rising to the exact cumulative fraction at that
+/// value. Samples with no more distinct values than steps give the exact
+/// function. The output gives the step vertices in the x and y aesthetics,
+/// ready for drawing with Axis::line. Requires x aesthetic.
+class ECDF {
+  int m_points;
+  ColumnIterator (*m_weight_begin)(const DataWithAesthetic &){nullptr};
+  const ValidityBitmap &(*m_weight_valid)(const DataWithAesthetic &){nullptr};
+
+public:
+  /// output at most @p points points (i.e. half as many steps)
+  explicit ECDF(int points = 4096);
+
+  /// weight each sample by (non-negative) Aesthetic, rather than equally
+  template <typename Aesthetic> ECDF &weight() {
+    m_weight_begin = [](const DataWithAesthetic &data) {
+      return data.begin<Aesthetic>();
+    };
+    m_weight_valid =
+        [](const DataWithAesthetic &data) -> const ValidityBitmap & {
+      return data.valid<Aesthetic>();
+    };
+    return *this;
+  }
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// apply the transform to each of @p data (e.g. the facets of a figure).
+  /// Given at least as many data sets as threads, they are transformed
+  /// concurrently, otherwise one after the other with each sort in parallel
+  std::vector<DataWithAesthetic>
+  operator()(const std::vector<DataWithAesthetic> &data);
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_points, m_weight_begin);
+  }
+};
+
+/// bin x and y coordinates into a regular grid of cells
+///
+/// The output has one row per cell (with the x index varying fastest),
+/// giving the cell bounds in the xmin, xmax, ymin and ymax aesthetics and the
+/// statistic of each cell in the fill aesthetic, so that it can be drawn as a
+/// heatmap using the Rectangle geometry. The size of the output depends only
+/// on the number of cells. Requires x and y aesthetics.
+class BinXY {
+public:
+  /// the statistic of each cell
+  enum class Statistic {
+    count, ///< number of points in the cell
+    sum,   ///< sum of the value aesthetic over the points in the cell
+    mean   ///< mean of the value aesthetic, missing for empty cells
+  };
+
+private:
+  int m_nx;
+  int m_ny;
+  bbox<float, 2> m_span;
+  Statistic m_statistic{Statistic::count};
+  ColumnIterator (*m_value_begin)(const DataWithAesthetic &){nullptr};
+  const ValidityBitmap &(*m_value_valid)(const DataWithAesthetic &){nullptr};
+
+public:
+  /// bin into @p nx by @p ny cells covering the span of the first frame
+  BinXY(int nx, int ny);
+
+  /// bin into @p nx by @p ny cells covering @p span
+  BinXY(int nx, int ny, const bfloat2_t &span);
+
+  /// each cell holds the sum of Aesthetic over the points in the cell
+  template <typename Aesthetic> BinXY &sum() {
+    return value<Aesthetic>(Statistic::sum);
+  }
+
+  /// each cell holds the mean of Aesthetic over the points in the cell
+  template <typename Aesthetic> BinXY &mean() {
+    return value<Aesthetic>(Statistic::mean);
+  }
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters and state of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_nx, m_ny, m_span.bmin[0], m_span.bmin[1],
+                          m_span.bmax[0], m_span.bmax[1], m_statistic,
+                          m_value_begin);
+  }
+
+private:
+  template <typename Aesthetic> BinXY &value(const Statistic statistic) {
+    m_statistic = statistic;
+    m_value_begin = [](const DataWithAesthetic &data) {
+      return data.begin<Aesthetic>();
+    };
+    m_value_valid =
+        [](const DataWithAesthetic &data) -> const ValidityBitmap & {
+      return data.valid<Aesthetic>();
+    };
+    return *this;
+  }
+};
+
+/// rolling-window statistics of the y coordinates of a series sorted by x
+///
+/// The window ending at each point either holds the last few points, or the
+/// points with x within a given distance. Each statistic is updated in O(1)
+/// per point as the window slides (a compensated running sum, monotonic
+/// deques for the min and max and Welford's algorithm for the standard
+/// deviation), and long series are split into blocks processed in parallel.
+/// Points with missing x or y are skipped, and windows at the start of the
+/// series are allowed to be incomplete. The output gives the x coordinate of
+/// each point and the statistic of its window in the y aesthetic, ready for
+/// drawing with Axis::line. Requires x and y aesthetics.
+class Rolling {
+public:
+  /// the statistic of each window
+  enum class Statistic {
+    mean, ///< mean of y
+    sum,  ///< sum of y
+    min,  ///< minimum of y
+    max,  ///< maximum of y
+    stdev ///< sample standard deviation of y, zero for a single point
+  };
+
+  /// how the size of the window is given
+  enum class Window {
+    rows, ///< the window holds (at most) the given number of points
+    span  ///< the window holds the points with x less than the given
+          ///< distance from the last point
+  };
+
+private:
+  Statistic m_statistic;
+  Window m_window;
+  float m_size;
+
+public:
+  /// apply @p statistic to windows of @p size points, or x distance @p size
+  /// if @p window is Window::span
+  Rolling(Statistic statistic, Window window, float size);
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const {
+    return make_cache_key(m_statistic, m_window, m_size);
+  }
+};
+
+/// downsamples a line using the Largest-Triangle-Three-Buckets algorithm
+///
+/// Steinarsson, S. 2013.
+/// Downsampling Time Series for Visual Representation.
+/// MSc thesis, University of Iceland.
+///
+/// The points are split into buckets, and from each bucket the point forming
+/// the largest triangle with the point chosen from the previous bucket and
+/// the mean of the next bucket is kept, preserving the visual shape of the
+/// line with far fewer points. The first and last points are always kept.
+/// The convex hull of each bucket (which contains the point of largest
+/// triangle) is found in parallel, so that the sequential choice of points
+/// only visits the few hull vertices of each bucket. Separate runs of points
+/// between missing values are downsampled separately, with a missing point
+/// between them so that the gaps are kept. The target is a bound on the rows
+/// of the result, including these missing points: each run is given a share
+/// of the target in proportion to its length, and if there are more runs
+/// than half the target, neighbouring runs are merged (dropping the gaps
+/// between them). Data with no more rows than the target is passed through
+/// unchanged. Requires x and y aesthetics.
+class LTTB {
+  int m_points;
+
+public:
+  /// downsample to @p points points, by default twice the width in pixels of
+  /// a default figure
+  explicit LTTB(int points = 1600);
+
+  /// downsample to @p points_per_pixel points for each pixel of the width of
+  /// @p axis
+  explicit LTTB(const Axis &axis, int points_per_pixel = 2);
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
+
+  /// returns the parameters of the transform, see TransformCache
+  std::string cache_key() const { return make_cache_key(m_points); }
+};
+
+/// accumulates a histogram with fixed bin edges from chunks of data
+///
+/// Only the bin counts are stored, never the samples, so an unbounded stream
+/// can be histogrammed by adding each chunk of samples as it arrives.
+/// Accumulators with the same edges (e.g. filled by different threads) can be
+/// merged. Optionally, only the last few chunks are counted (a sliding
+/// window), and/or older chunks are weighted down by an exponential decay.
+class HistogramAccumulator {
+  int m_number_of_bins;
+  bbox<float, 1> m_span;
+
+  /// current (windowed and decayed) counts
+  std::vector<double> m_counts;
+
+  /// number of chunks in the sliding window, zero if unbounded
+  int m_window{0};
+
+  /// counts of each chunk in the window, oldest first
+  std::deque<std::vector<double>> m_chunks;
+
+  /// factor applied to existing counts when a new chunk is added
+  float m_decay{1.f};
+
+public:
+  /// create an accumulator with @p number_of_bins regular bins between @p min
+  /// and @p max
+  HistogramAccumulator(int number_of_bins, float min, float max);
+
+  /// only count the last @p number_of_chunks chunks added, or every chunk if
+  /// @p number_of_chunks is zero
+  void set_window(int number_of_chunks);
+
+  /// multiply the existing counts by @p factor each time a new chunk is added
+  void set_decay(float factor);
+
+  /// add a chunk of samples given by the x aesthetic of @p data. Missing
+  /// values and values outside the bin edges are not counted
+  void add(const DataWithAesthetic &data);
+
+  /// add a chunk of samples
+  void add(const std::vector<float> &x);
+
+  /// add the counts of @p other to the most recent chunk of this accumulator
+  ///
+  /// @p other must have identical bin edges. This does not start a new chunk,
+  /// so it is suitable for combining accumulators that each processed part of
+  /// the same chunk
+  void merge(const HistogramAccumulator &other);
+
+  /// remove all counts
+  void clear();
+
+  int number_of_bins() const { return m_number_of_bins; }
+  const bbox<float, 1> &span() const { return m_span; }
+  const std::vector<double> &counts() const { return m_counts; }
+
+  /// returns the current histogram in the same form as BinX
+  DataWithAesthetic snapshot() const;
+
+private:
+  void add_chunk(std::vector<double> chunk);
+};
+
+/// bin x coordinates into a shared HistogramAccumulator
+///
+/// Each call adds the data to the accumulator and returns a snapshot of the
+/// counts, so that each frame of an animated histogram only costs binning the
+/// new data. Requires x aesthetic.
+class AccumulateBinX {
+  std::shared_ptr<HistogramAccumulator> m_accumulator;
+
+public:
+  explicit AccumulateBinX(std::shared_ptr<HistogramAccumulator> accumulator);
+  DataWithAesthetic operator()(const DataWithAesthetic &data);
 };
 
 /// holds a `std::function` that maps between two DataWithAesthetic classes
 class Transform {
   std::function<DataWithAesthetic(const DataWithAesthetic &)> m_transform;
+  bool m_concurrent;
 
 public:
   /// construct an identity transform
-  Transform() : m_transform(Identity()) {}
+  Transform() : m_transform(Identity()), m_concurrent(true) {}
 
   /// construct a Transform wrapping the given transform function T. The
   /// function T can be any function or function object that is compatible with
-  /// `std::function`
+  /// `std::function`. If T provides a `cache_key()` member function then its
+  /// results are cached in TransformCache::global()
   template <typename T>
-  explicit Transform(const T &transform) : m_transform(transform) {}
+  explicit Transform(const T &transform)
+      : m_transform(wrap(transform, has_cache_key<T>())),
+        m_concurrent(has_cache_key<T>::value ||
+                     std::is_same<T, Identity>::value) {}
+
+  /// construct a Transform wrapping the given Pipeline. This is implicit so
+  /// that a pipeline can be passed anywhere a Transform is expected
+  template <typename Filter, typename Sink, typename Output>
+  Transform(const Pipeline<Filter, Sink, Output> &pipeline)
+      : m_transform(pipeline), m_concurrent(true) {}
 
   /// perform mapping on `data`, return result
   DataWithAesthetic operator()(const DataWithAesthetic &data) {
     return m_transform(data);
   }
+
+  /// returns true if, once it has been applied to a first frame, copies of
+  /// this transform can be applied to further frames concurrently. This holds
+  /// for the identity, pipelines, and transforms providing `cache_key()`
+  /// (whose results depend only on their parameters and the data). Other
+  /// transforms, such as AccumulateBinX, depend on the order of the frames
+  bool is_concurrent() const { return m_concurrent; }
+
+  /// returns true if this wraps a transform of type T
+  template <typename T> bool is() const {
+    return m_transform.target<T>() != nullptr ||
+           m_transform.target<CachedTransform<T>>() != nullptr;
+  }
+
+private:
+  template <typename T>
+  static CachedTransform<T> wrap(const T &transform, std::true_type) {
+    return CachedTransform<T>(transform);
+  }
+
+  template <typename T> static T wrap(const T &transform, std::false_type) {
+    return transform;
+  }
 };
 
 } // namespace trase
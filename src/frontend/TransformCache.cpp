@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frontend/TransformCache.hpp"
+
+namespace trase {
+
+#ifdef TRASE_HAVE_THREADS
+#define TRASE_CACHE_LOCK std::lock_guard<std::mutex> lock(m_mutex)
+#else
+#define TRASE_CACHE_LOCK
+#endif
+
+namespace {
+
+/// estimate of the memory used by an entry, its result (including the
+/// validity bitmaps, string sets and cached statistics of the result) and the
+/// state of its transform
+std::size_t entry_size(const std::string &key,
+                       const TransformCache::Entry &entry) {
+  return key.size() + entry.result.memory_usage() + entry.state_size;
+}
+
+} // namespace
+
+const std::size_t TransformCache::default_capacity;
+
+TransformCache::TransformCache(const std::size_t capacity)
+    : m_capacity(capacity) {}
+
+TransformCache &TransformCache::global() {
+  static TransformCache cache;
+  return cache;
+}
+
+bool TransformCache::find(const std::string &key, Entry &entry) {
+  TRASE_CACHE_LOCK;
+  auto search = m_index.find(key);
+  if (search == m_index.end()) {
+    ++m_misses;
+    return false;
+  }
+  ++m_hits;
+
+  // move to the front of the list as the most recently used
+  m_entries.splice(m_entries.begin(), m_entries, search->second);
+  entry = search->second->entry;
+  return true;
+}
+
+void TransformCache::insert(const std::string &key, const Entry &entry) {
+  TRASE_CACHE_LOCK;
+  const std::size_t size = entry_size(key, entry);
+  if (size > m_capacity || m_index.count(key) > 0) {
+    return;
+  }
+  evict(m_capacity - size);
+  m_entries.push_front({key, entry, size});
+  m_index[key] = m_entries.begin();
+  m_size += size;
+}
+
+void TransformCache::clear() {
+  TRASE_CACHE_LOCK;
+  m_entries.clear();
+  m_index.clear();
+  m_size = 0;
+  m_hits = 0;
+  m_misses = 0;
+}
+
+void TransformCache::set_capacity(const std::size_t capacity) {
+  TRASE_CACHE_LOCK;
+  m_capacity = capacity;
+  evict(m_capacity);
+}
+
+std::size_t TransformCache::capacity() const {
+  TRASE_CACHE_LOCK;
+  return m_capacity;
+}
+
+std::size_t TransformCache::size() const {
+  TRASE_CACHE_LOCK;
+  return m_size;
+}
+
+std::size_t TransformCache::entries() const {
+  TRASE_CACHE_LOCK;
+  return m_entries.size();
+}
+
+std::size_t TransformCache::hits() const {
+  TRASE_CACHE_LOCK;
+  return m_hits;
+}
+
+std::size_t TransformCache::misses() const {
+  TRASE_CACHE_LOCK;
+  return m_misses;
+}
+
+void TransformCache::evict(const std::size_t capacity) {
+  // discard the least recently used entries until the cache fits
+  while (m_size > capacity) {
+    const auto &last = m_entries.back();
+    m_size -= last.size;
+    m_index.erase(last.key);
+    m_entries.pop_back();
+  }
+}
+
+#undef TRASE_CACHE_LOCK
+
+} // namespace trase
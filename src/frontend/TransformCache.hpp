@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file TransformCache.hpp
+
+#ifndef TRANSFORMCACHE_H_
+#define TRANSFORMCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#ifdef TRASE_HAVE_THREADS
+#include <mutex>
+#endif
+
+#include "frontend/Data.hpp"
+
+namespace trase {
+
+/// appends the bytes of each of @p values to @p key
+inline void append_cache_key(std::string &) {}
+
+template <typename T, typename... Rest>
+void append_cache_key(std::string &key, const T &value,
+                      const Rest &... rest) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "cache key values must be trivially copyable");
+  key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  append_cache_key(key, rest...);
+}
+
+/// returns a cache key holding the bytes of each of @p values, for use by
+/// the `cache_key()` member of a transform
+template <typename... T> std::string make_cache_key(const T &... values) {
+  std::string key;
+  append_cache_key(key, values...);
+  return key;
+}
+
+/// a least recently used cache of the results of transforms, bounded by the
+/// memory used by the results
+///
+/// Results are keyed by the type and parameters of the transform together
+/// with the content hash of the input data, so that identical (data,
+/// transform) pairs are only calculated once, whichever geometry or figure
+/// they belong to. The state of the transform after the calculation is also
+/// stored, so that stateful transforms like BinX (which fixes its span on
+/// the first frame) behave as if the calculation had been done. Transforms
+/// are cached if they provide a `std::string cache_key() const` member
+/// function, see Transform.
+class TransformCache {
+public:
+  /// a cached result, and the state of the transform that produced it
+  struct Entry {
+    DataWithAesthetic result;
+    std::shared_ptr<const void> state;
+
+    /// the memory used by the state in bytes
+    std::size_t state_size{0};
+  };
+
+private:
+  /// an entry with its key and the memory it used when it was inserted
+  struct Node {
+    std::string key;
+    Entry entry;
+    std::size_t size;
+  };
+
+  /// entries, with the most recently used first
+  std::list<Node> m_entries;
+
+  std::unordered_map<std::string, std::list<Node>::iterator> m_index;
+
+  /// maximum memory used by the cached results in bytes
+  std::size_t m_capacity;
+
+  /// memory used by the cached results in bytes
+  std::size_t m_size{0};
+
+  std::size_t m_hits{0};
+  std::size_t m_misses{0};
+
+#ifdef TRASE_HAVE_THREADS
+  mutable std::mutex m_mutex;
+#endif
+
+public:
+  /// the default capacity of the global cache, 64 MiB
+  static const std::size_t default_capacity = std::size_t(64) << 20;
+
+  /// create a cache holding at most @p capacity bytes of results
+  explicit TransformCache(std::size_t capacity = default_capacity);
+
+  /// the cache shared by all transforms
+  static TransformCache &global();
+
+  /// look up @p key, returns true and sets @p entry if it is found
+  bool find(const std::string &key, Entry &entry);
+
+  /// add @p entry with @p key, discarding the least recently used entries to
+  /// keep within the capacity. Entries larger than the capacity are not added
+  void insert(const std::string &key, const Entry &entry);
+
+  /// removes all entries and resets the hit and miss counters
+  void clear();
+
+  /// sets the maximum memory used by the cached results in bytes. A capacity
+  /// of zero disables the cache
+  void set_capacity(std::size_t capacity);
+
+  /// returns the maximum memory used by the cached results in bytes
+  std::size_t capacity() const;
+
+  /// returns the memory used by the cached results in bytes
+  std::size_t size() const;
+
+  /// returns the number of cached results
+  std::size_t entries() const;
+
+  /// returns the number of lookups that found a cached result
+  std::size_t hits() const;
+
+  /// returns the number of lookups that did not find a cached result
+  std::size_t misses() const;
+
+private:
+  void evict(std::size_t capacity);
+};
+
+/// wraps a transform T that provides a `cache_key()`, so that its results
+/// are served from TransformCache::global() where possible
+template <typename T> class CachedTransform {
+  T m_transform;
+
+public:
+  explicit CachedTransform(const T &transform) : m_transform(transform) {}
+
+  DataWithAesthetic operator()(const DataWithAesthetic &data) {
+    auto &cache = TransformCache::global();
+    if (cache.capacity() == 0) {
+      return m_transform(data);
+    }
+
+    const std::uint64_t hash = data.content_hash();
+    const std::string key = std::string(typeid(T).name()) + '\0' +
+                            m_transform.cache_key() + make_cache_key(hash);
+    // the cached result is never handed out, only copies of it, so that
+    // modifying one result does not change the others
+    TransformCache::Entry entry;
+    if (cache.find(key, entry)) {
+      m_transform = *std::static_pointer_cast<const T>(entry.state);
+      return entry.result.copy();
+    }
+
+    DataWithAesthetic result = m_transform(data);
+    entry.result = result.copy();
+    entry.state = std::make_shared<const T>(m_transform);
+    entry.state_size = sizeof(T) + m_transform.cache_key().size();
+    cache.insert(key, entry);
+    return result;
+  }
+};
+
+/// true if T provides a `std::string cache_key() const` member function
+template <typename T, typename = void>
+struct has_cache_key : std::false_type {};
+
+template <typename T>
+struct has_cache_key<T, decltype(void(std::declval<const T &>().cache_key()))>
+    : std::true_type {};
+
+} // namespace trase
+
+#endif // TRANSFORMCACHE_H_
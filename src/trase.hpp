@@ -36,12 +36,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TRASE_H_
 #define TRASE_H_
 
+#include "backend/BackendRecorder.hpp"
 #include "backend/BackendSVG.hpp"
 #ifdef TRASE_BACKEND_GL
 #include "backend/BackendGL.hpp"
 #endif
 
 #include "frontend/Figure.hpp"
+#include "util/Parallel.hpp"
 #ifdef TRASE_HAVE_CURL
 #include "util/CSVDownloader.hpp"
 #endif
@@ -164,10 +164,22 @@ template <typename T, int N> struct bbox {
     return within;
   }
 
+  ///
+  /// @return true if lhs box and rhs box overlap (including touching)
+  ///
+  inline bool intersects(const bbox &arg) const {
+    for (int i = 0; i < N; ++i) {
+      if (bmax[i] < arg.bmin[i] || bmin[i] > arg.bmax[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   ///
   /// @return true if box has no volume
   ///
-  inline bool is_empty() {
+  inline bool is_empty() const {
     for (int i = 0; i < N; ++i) {
       if (bmax[i] < bmin[i] + 3 * std::numeric_limits<double>::epsilon()) {
         return true;
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file FFT.hpp
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+#include "util/Exception.hpp"
+
+namespace trase {
+
+/// returns the smallest power of two that is greater than or equal to @p n
+inline int next_power_of_two(const int n) {
+  int p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+/// in-place discrete Fourier transform of @p a, using the iterative radix-2
+/// Cooley-Tukey algorithm in O(n log n) operations
+///
+/// The size of @p a must be a power of two. The inverse transform (@p inverse
+/// true) is scaled by 1/n, so that it exactly undoes the forward transform
+inline void fft(std::vector<std::complex<double>> &a,
+                const bool inverse = false) {
+  const int n = static_cast<int>(a.size());
+  if (n == 0 || (n & (n - 1)) != 0) {
+    throw Exception("fft size must be a power of two");
+  }
+
+  // bit reversal permutation
+  for (int i = 1, j = 0; i < n; ++i) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(a[i], a[j]);
+    }
+  }
+
+  // the twiddle factors are computed directly rather than by repeated
+  // multiplication, to avoid accumulating round-off error
+  const double pi = 3.14159265358979323846;
+  const double sign = inverse ? 1.0 : -1.0;
+  std::vector<std::complex<double>> roots(n / 2);
+  for (int k = 0; k < n / 2; ++k) {
+    roots[k] = std::polar(1.0, sign * 2 * pi * k / n);
+  }
+
+  for (int len = 2; len <= n; len <<= 1) {
+    const int half = len / 2;
+    const int stride = n / len;
+    for (int i = 0; i < n; i += len) {
+      for (int k = 0; k < half; ++k) {
+        const std::complex<double> u = a[i + k];
+        const std::complex<double> v = a[i + k + half] * roots[k * stride];
+        a[i + k] = u + v;
+        a[i + k + half] = u - v;
+      }
+    }
+  }
+
+  if (inverse) {
+    for (auto &x : a) {
+      x /= n;
+    }
+  }
+}
+
+} // namespace trase
+
+#endif // FFT_H_
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file HistogramIndex.hpp
+
+#ifndef HISTOGRAMINDEX_H_
+#define HISTOGRAMINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "util/Parallel.hpp"
+#include "util/ValidityBitmap.hpp"
+
+namespace trase {
+
+/// A sorted copy of the valid values of a data column, so that histograms
+/// with any number of bins over any range can be counted without scanning
+/// the values
+///
+/// Building the index costs O(n log n) (sorting in parallel), after which
+/// counting a histogram of b bins costs O(b log n).
+class HistogramIndex {
+  std::vector<float> m_sorted;
+
+public:
+  /// create an index of the values in [@p begin, @p end) that are valid
+  /// according to @p valid
+  template <typename T>
+  HistogramIndex(T begin, T end, const ValidityBitmap &valid) {
+    m_sorted.reserve(valid.size() - valid.null_count());
+    valid.for_each_valid([&](const int i) { m_sorted.push_back(begin[i]); });
+    parallel_sort(m_sorted.begin(), m_sorted.end());
+  }
+
+  /// returns the number of values in the index
+  int size() const { return static_cast<int>(m_sorted.size()); }
+
+  /// returns the valid values in ascending order
+  const std::vector<float> &sorted() const { return m_sorted; }
+
+  /// returns the number of values in each of @p number_of_bins regular bins
+  /// spanning [@p min, @p max)
+  ///
+  /// Values are assigned to bins using the same arithmetic as BinX, so the
+  /// counts are identical to those from binning the values directly
+  std::vector<std::int64_t> counts(const int number_of_bins, const float min,
+                                   const float max) const {
+    std::vector<std::int64_t> result(number_of_bins, 0);
+    if (number_of_bins <= 0 || !(max > min)) {
+      return result;
+    }
+    const float dx = (max - min) / number_of_bins;
+    const auto bins_f = static_cast<float>(number_of_bins);
+
+    // bin index of x, monotonic in x, with -1 below the span and
+    // number_of_bins above
+    auto bin_index = [=](const float x) {
+      const float t = (x - min) / dx;
+      return t < 0.f ? -1 : (t < bins_f ? static_cast<int>(t) : number_of_bins);
+    };
+
+    // first[k] is the first value with a bin index of at least k, each found
+    // by a binary search starting from the previous one
+    auto first = std::partition_point(
+        m_sorted.begin(), m_sorted.end(),
+        [&](const float x) { return bin_index(x) < 0; });
+    for (int k = 0; k < number_of_bins; ++k) {
+      auto next = std::partition_point(
+          first, m_sorted.end(),
+          [&](const float x) { return bin_index(x) < k + 1; });
+      result[k] = next - first;
+      first = next;
+    }
+    return result;
+  }
+};
+
+} // namespace trase
+
+#endif // HISTOGRAMINDEX_H_
@@ -0,0 +1,195 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Parallel.hpp
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#ifdef TRASE_HAVE_THREADS
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace trase {
+
+/// returns the number of threads used by the parallel data kernels
+int get_num_threads();
+
+/// sets the number of threads used by the parallel data kernels. A value of
+/// zero (the default) uses the number of hardware threads
+void set_num_threads(int n);
+
+/// returns true on the threads running a parallel_for_blocks() loop, where
+/// nested loops run serially so that kernels called from within a parallel
+/// loop do not oversubscribe the hardware threads
+inline bool &in_parallel_region() {
+#ifdef TRASE_HAVE_THREADS
+  static thread_local bool in_region = false;
+#else
+  static bool in_region = false;
+#endif
+  return in_region;
+}
+
+/// returns the number of threads that parallel_for_blocks() will use to
+/// process @p number_of_blocks blocks
+inline int parallel_threads(const int number_of_blocks) {
+  if (in_parallel_region()) {
+    return 1;
+  }
+  return std::max(1, std::min(get_num_threads(), number_of_blocks));
+}
+
+/// returns the number of blocks of size @p block_size covering @p n items
+inline int parallel_blocks(const int n, const int block_size) {
+  return (n + block_size - 1) / block_size;
+}
+
+/// splits the range [0, @p n) into contiguous blocks of @p block_size items
+/// and calls @p f(thread, block, begin, end) once for each block
+///
+/// The decomposition into blocks depends only on @p n and @p block_size, so
+/// kernels that store a partial result per block and combine them in block
+/// order give identical results for any number of threads. Each thread
+/// processes a contiguous range of blocks in order, so kernels that instead
+/// accumulate into per-thread scratch space (indexed by the thread index,
+/// which lies in [0, parallel_threads(number of blocks))) give identical
+/// results for a given number of threads. Any exception thrown by @p f is
+/// rethrown on the calling thread once all threads have finished
+template <typename F>
+void parallel_for_blocks(const int n, const int block_size, F f) {
+  const int number_of_blocks = parallel_blocks(n, block_size);
+  const int number_of_threads = parallel_threads(number_of_blocks);
+
+  auto run_block = [&](const int thread, const int block) {
+    const int begin = block * block_size;
+    const int end = std::min(n, begin + block_size);
+    f(thread, block, begin, end);
+  };
+
+#ifdef TRASE_HAVE_THREADS
+  if (number_of_threads > 1) {
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    // first block processed by each thread
+    auto first_block = [&](const int thread) {
+      return static_cast<int>(static_cast<long long>(number_of_blocks) *
+                              thread / number_of_threads);
+    };
+    auto worker = [&](const int thread) {
+      const int first = first_block(thread);
+      const int last = first_block(thread + 1);
+      in_parallel_region() = true;
+      try {
+        for (int block = first; block < last && !failed; ++block) {
+          run_block(thread, block);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed = true;
+      }
+      in_parallel_region() = false;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(number_of_threads - 1);
+    for (int thread = 1; thread < number_of_threads; ++thread) {
+      threads.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return;
+  }
+#endif
+
+  for (int block = 0; block < number_of_blocks; ++block) {
+    run_block(0, block);
+  }
+}
+
+/// sorts [@p first, @p last) into the order given by @p comp
+///
+/// The range is split into one run per thread, the runs are sorted in
+/// parallel, and then adjacent runs are merged pairwise in rounds, with the
+/// merges of each round done in parallel. The sort is not stable
+template <typename RandomIt, typename Compare>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp) {
+  const int min_run_size = 1 << 16;
+  const int n = static_cast<int>(last - first);
+  const int number_of_threads =
+      parallel_threads(parallel_blocks(n, min_run_size));
+  if (number_of_threads <= 1) {
+    std::sort(first, last, comp);
+    return;
+  }
+  const int run_size = (n + number_of_threads - 1) / number_of_threads;
+  parallel_for_blocks(
+      n, run_size, [&](const int, const int, const int begin, const int end) {
+        std::sort(first + begin, first + end, comp);
+      });
+  for (int width = run_size; width < n; width *= 2) {
+    parallel_for_blocks(
+        n, 2 * width,
+        [&](const int, const int, const int begin, const int end) {
+          const int middle = std::min(begin + width, end);
+          std::inplace_merge(first + begin, first + middle, first + end, comp);
+        });
+  }
+}
+
+/// sorts [@p first, @p last) into ascending order, see parallel_sort()
+template <typename RandomIt> void parallel_sort(RandomIt first, RandomIt last) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  parallel_sort(first, last, std::less<value_type>());
+}
+
+} // namespace trase
+
+#endif // PARALLEL_H_
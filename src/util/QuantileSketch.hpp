@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file QuantileSketch.hpp
+
+#ifndef QUANTILESKETCH_H_
+#define QUANTILESKETCH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace trase {
+
+/// A mergeable sketch of a stream of values, used to estimate quantiles in
+/// bounded memory
+///
+/// This is a KLL sketch (Karnin, Lang & Liberty, 2016. Optimal quantile
+/// approximation in streams). Values are stored in a hierarchy of compactors,
+/// where a value at level h stands for 2^h of the original values. When a
+/// level fills up it is sorted and every other value is promoted to the level
+/// above. The number of stored values is O(k), and the rank error of a
+/// quantile is roughly 1.7/k. Compaction uses a fixed-seed random generator,
+/// so a given sequence of additions and merges always gives the same result.
+class QuantileSketch {
+  /// capacity of the top level
+  int m_k;
+
+  /// compactors, lowest level first
+  std::vector<std::vector<float>> m_levels;
+
+  /// number of values added
+  std::int64_t m_count{0};
+
+  float m_min{std::numeric_limits<float>::max()};
+  float m_max{-std::numeric_limits<float>::max()};
+
+  /// state of the generator used to pick which half of a level is promoted
+  std::uint32_t m_random{2463534242u};
+
+public:
+  /// create an empty sketch, where @p k controls the accuracy (and size)
+  explicit QuantileSketch(const int k = 200)
+      : m_k(std::max(8, k)), m_levels(1) {}
+
+  /// returns the number of values added to the sketch
+  std::int64_t count() const { return m_count; }
+
+  /// returns the smallest value added to the sketch
+  float min() const { return m_min; }
+
+  /// returns the largest value added to the sketch
+  float max() const { return m_max; }
+
+  /// returns the number of values stored by the sketch
+  int size() const {
+    int n = 0;
+    for (const auto &level : m_levels) {
+      n += static_cast<int>(level.size());
+    }
+    return n;
+  }
+
+  /// adds the value @p x to the sketch
+  void add(const float x) {
+    m_levels[0].push_back(x);
+    ++m_count;
+    m_min = std::min(m_min, x);
+    m_max = std::max(m_max, x);
+    if (static_cast<int>(m_levels[0].size()) >= capacity(0)) {
+      compress();
+    }
+  }
+
+  /// adds all the values summarised by @p other to this sketch
+  void merge(const QuantileSketch &other) {
+    if (other.m_count == 0) {
+      return;
+    }
+    while (m_levels.size() < other.m_levels.size()) {
+      m_levels.emplace_back();
+    }
+    for (size_t h = 0; h < other.m_levels.size(); ++h) {
+      m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(),
+                         other.m_levels[h].end());
+    }
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    compress();
+  }
+
+  /// returns an estimate of the @p p quantile, for @p p in [0, 1]. Returns
+  /// NaN if the sketch is empty
+  float quantile(const float p) const {
+    if (m_count == 0) {
+      return std::numeric_limits<float>::quiet_NaN();
+    }
+    if (p <= 0.f) {
+      return m_min;
+    }
+    if (p >= 1.f) {
+      return m_max;
+    }
+
+    // sort the stored values, each weighted by the number of values it
+    // stands for
+    std::vector<std::pair<float, std::int64_t>> weighted;
+    weighted.reserve(size());
+    for (size_t h = 0; h < m_levels.size(); ++h) {
+      for (const float x : m_levels[h]) {
+        weighted.emplace_back(x, std::int64_t(1) << h);
+      }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    const double rank = static_cast<double>(p) * m_count;
+    std::int64_t cumulative = 0;
+    for (const auto &i : weighted) {
+      cumulative += i.second;
+      if (cumulative > rank) {
+        return i.first;
+      }
+    }
+    return m_max;
+  }
+
+private:
+  /// capacity of level @p h, which decreases geometrically below the top
+  int capacity(const int h) const {
+    const int depth = static_cast<int>(m_levels.size()) - h - 1;
+    return std::max(
+        2, static_cast<int>(std::ceil(m_k * std::pow(2.0 / 3.0, depth))));
+  }
+
+  bool random_bit() {
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random & 1u;
+  }
+
+  /// compacts every level that is over capacity, lowest level first
+  void compress() {
+    for (size_t h = 0; h < m_levels.size(); ++h) {
+      const int h_capacity = capacity(static_cast<int>(h));
+      if (static_cast<int>(m_levels[h].size()) < h_capacity) {
+        continue;
+      }
+      if (h + 1 == m_levels.size()) {
+        m_levels.emplace_back();
+      }
+      auto &level = m_levels[h];
+      std::sort(level.begin(), level.end());
+
+      // an odd value out stays at this level
+      float leftover = 0.f;
+      const bool odd = level.size() % 2 == 1;
+      if (odd) {
+        leftover = level.back();
+        level.pop_back();
+      }
+
+      // promote every other value, starting at a random offset
+      auto &above = m_levels[h + 1];
+      for (size_t i = random_bit() ? 1 : 0; i < level.size(); i += 2) {
+        above.push_back(level[i]);
+      }
+      level.clear();
+      if (odd) {
+        level.push_back(leftover);
+      }
+    }
+  }
+};
+
+} // namespace trase
+
+#endif // QUANTILESKETCH_H_
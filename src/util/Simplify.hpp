@@ -0,0 +1,174 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file Simplify.hpp
+
+#ifndef SIMPLIFY_H_
+#define SIMPLIFY_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "util/Vector.hpp"
+
+namespace trase {
+
+/// returns the squared distance from @p p to the segment from @p a to @p b
+inline float squared_segment_distance(const vfloat2_t &p, const vfloat2_t &a,
+                                      const vfloat2_t &b) {
+  const vfloat2_t ab = b - a;
+  const vfloat2_t ap = p - a;
+  const float length = ab.squaredNorm();
+  if (length == 0.f) {
+    return ap.squaredNorm();
+  }
+  const float t = std::min(std::max(ap.dot(ab) / length, 0.f), 1.f);
+  return (ap - t * ab).squaredNorm();
+}
+
+/// simplifies the polyline @p points using the Douglas-Peucker algorithm
+///
+/// Douglas, D. and Peucker, T. 1973.
+/// Algorithms for the reduction of the number of points required to represent
+/// a digitized line or its caricature.
+/// The Canadian Cartographer, 10(2):112-122.
+///
+/// Returns the (ascending) indices of the points kept, always including the
+/// first and last, so that no removed point is further than @p tolerance
+/// from the simplified polyline. Closed polylines (with the first point
+/// repeated at the end) are handled. The recursion is replaced by an
+/// explicit stack, so long polylines cannot overflow the call stack
+inline std::vector<int> douglas_peucker(const std::vector<vfloat2_t> &points,
+                                        const float tolerance) {
+  const int n = static_cast<int>(points.size());
+  std::vector<int> kept;
+  if (n <= 2) {
+    for (int i = 0; i < n; ++i) {
+      kept.push_back(i);
+    }
+    return kept;
+  }
+
+  const float tolerance2 = tolerance * tolerance;
+  std::vector<char> keep(n, 0);
+  keep[0] = keep[n - 1] = 1;
+  std::vector<std::pair<int, int>> stack = {{0, n - 1}};
+  while (!stack.empty()) {
+    const auto range = stack.back();
+    stack.pop_back();
+    float furthest = -1.f;
+    int index = -1;
+    for (int i = range.first + 1; i < range.second; ++i) {
+      const float d = squared_segment_distance(
+          points[i], points[range.first], points[range.second]);
+      if (d > furthest) {
+        furthest = d;
+        index = i;
+      }
+    }
+    if (index >= 0 && furthest > tolerance2) {
+      keep[index] = 1;
+      stack.emplace_back(range.first, index);
+      stack.emplace_back(index, range.second);
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (keep[i]) {
+      kept.push_back(i);
+    }
+  }
+  return kept;
+}
+
+/// Streaming Douglas-Peucker simplification of a path made of one or more
+/// polylines
+///
+/// Points are given in order to `add(point, connected)`, where connected is
+/// false if the point starts a new polyline. Each polyline is buffered until
+/// it ends, then simplified with douglas_peucker(), and the kept points are
+/// passed on in order to `sink(point, connected)`. This lets any geometry
+/// drawing paths simplify them in display coordinates (e.g. to half a pixel)
+/// just before they reach the backend. A tolerance of zero passes every point
+/// straight through.
+template <typename Sink> class PolylineSimplifier {
+  Sink m_sink;
+  float m_tolerance;
+  std::vector<vfloat2_t> m_polyline;
+  bool m_connected{false};
+
+public:
+  /// simplify to within @p tolerance, passing the kept points to @p sink
+  PolylineSimplifier(Sink sink, const float tolerance)
+      : m_sink(sink), m_tolerance(tolerance) {}
+
+  /// add the next @p point of the path
+  void add(const vfloat2_t &point, const bool connected) {
+    if (m_tolerance <= 0.f) {
+      m_sink(point, connected);
+      return;
+    }
+    if (!connected) {
+      flush();
+    }
+    if (m_polyline.empty()) {
+      m_connected = connected;
+    }
+    m_polyline.push_back(point);
+  }
+
+  /// pass on the points of the current polyline, call after the last point
+  void flush() {
+    if (m_polyline.empty()) {
+      return;
+    }
+    const auto kept = douglas_peucker(m_polyline, m_tolerance);
+    m_sink(m_polyline[kept[0]], m_connected);
+    for (std::size_t k = 1; k < kept.size(); ++k) {
+      m_sink(m_polyline[kept[k]], true);
+    }
+    m_polyline.clear();
+  }
+};
+
+/// returns a PolylineSimplifier passing points to @p sink
+template <typename Sink>
+PolylineSimplifier<Sink> make_polyline_simplifier(Sink sink,
+                                                  const float tolerance) {
+  return PolylineSimplifier<Sink>(sink, tolerance);
+}
+
+} // namespace trase
+
+#endif // SIMPLIFY_H_
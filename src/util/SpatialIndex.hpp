@@ -0,0 +1,322 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file SpatialIndex.hpp
+
+#ifndef SPATIALINDEX_H_
+#define SPATIALINDEX_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "util/Parallel.hpp"
+#include "util/Vector.hpp"
+
+namespace trase {
+
+/// A static tree over 2D points or boxes, answering nearest item queries
+///
+/// The items are sorted into a balanced binary tree by recursive median
+/// splits of their centres along the wider axis, with every leaf at the same
+/// depth so that the nodes are stored implicitly (node k has children 2k + 1
+/// and 2k + 2) along with the bounding box of their items. Building costs
+/// O(n log n), with the subtrees below the first few levels built in
+/// parallel. A nearest item query visits O(log n) nodes for well spread
+/// items, so that hover and pick queries are fast even for millions of rows.
+///
+/// Distances are measured after scaling each axis (e.g. by the number of
+/// pixels per data unit), so that the index can be built in data coordinates
+/// and queried in display coordinates. The distance to a box is zero inside
+/// it
+class SpatialIndex {
+public:
+  /// the maximum number of items in a leaf of the tree
+  static const int leaf_size = 16;
+
+  /// the result of a nearest() query
+  struct Nearest {
+    /// the id of the item found, or -1 if there is none in range
+    int id{-1};
+
+    /// the squared (scaled) distance to the item found
+    float distance2{std::numeric_limits<float>::max()};
+  };
+
+private:
+  /// the lower corner of each item box, in tree order
+  std::vector<vfloat2_t> m_min;
+
+  /// the upper corner of each item box, in tree order, empty for points
+  std::vector<vfloat2_t> m_max;
+
+  /// the id (e.g. row) of each item, in tree order
+  std::vector<int> m_ids;
+
+  /// the bounding box of each node of the tree
+  std::vector<vfloat2_t> m_node_min;
+  std::vector<vfloat2_t> m_node_max;
+
+  /// the depth of the leaves of the tree
+  int m_depth{0};
+
+public:
+  SpatialIndex() = default;
+
+  /// create an index of @p points, where @p ids[i] is returned for points[i]
+  SpatialIndex(std::vector<vfloat2_t> points, std::vector<int> ids)
+      : m_min(std::move(points)), m_ids(std::move(ids)) {
+    build();
+  }
+
+  /// create an index of the boxes with lower corners @p min and upper
+  /// corners @p max, where @p ids[i] is returned for box i
+  SpatialIndex(std::vector<vfloat2_t> min, std::vector<vfloat2_t> max,
+               std::vector<int> ids)
+      : m_min(std::move(min)), m_max(std::move(max)), m_ids(std::move(ids)) {
+    build();
+  }
+
+  /// returns the number of items in the index
+  int size() const { return static_cast<int>(m_ids.size()); }
+
+  /// returns true if the index has no items
+  bool empty() const { return m_ids.empty(); }
+
+  /// returns the item nearest to @p point, with each axis of the distance
+  /// multiplied by @p scale. Only items within @p max_distance are found,
+  /// otherwise the id of the result is -1
+  Nearest nearest(const vfloat2_t &point, const vfloat2_t &scale,
+                  const float max_distance) const {
+    Nearest best;
+    best.distance2 = max_distance * max_distance;
+    if (empty()) {
+      return best;
+    }
+
+    // depth first search, visiting the nearer child first
+    struct Entry {
+      int node;
+      int level;
+      int begin;
+      int end;
+      float distance2;
+    };
+    std::array<Entry, 2 * 32> stack;
+    int top = 0;
+    stack[top++] = {0, 0, 0, size(), 0.f};
+    while (top > 0) {
+      const Entry entry = stack[--top];
+      if (entry.distance2 > best.distance2) {
+        continue;
+      }
+      if (entry.level == m_depth) {
+        for (int i = entry.begin; i < entry.end; ++i) {
+          const float d2 = distance2(point, scale, m_min[i],
+                                     m_max.empty() ? m_min[i] : m_max[i]);
+          if (d2 < best.distance2 || (best.id < 0 && d2 <= best.distance2)) {
+            best.id = m_ids[i];
+            best.distance2 = d2;
+          }
+        }
+        continue;
+      }
+      const int middle = (entry.begin + entry.end) / 2;
+      Entry left = {2 * entry.node + 1, entry.level + 1, entry.begin, middle,
+                    0.f};
+      Entry right = {2 * entry.node + 2, entry.level + 1, middle, entry.end,
+                     0.f};
+      left.distance2 = distance2(point, scale, m_node_min[left.node],
+                                 m_node_max[left.node]);
+      right.distance2 = distance2(point, scale, m_node_min[right.node],
+                                  m_node_max[right.node]);
+      if (left.distance2 < right.distance2) {
+        std::swap(left, right);
+      }
+      stack[top++] = left;
+      stack[top++] = right;
+    }
+    return best;
+  }
+
+private:
+  /// returns the squared scaled distance from @p point to the box
+  /// [@p min, @p max]
+  static float distance2(const vfloat2_t &point, const vfloat2_t &scale,
+                         const vfloat2_t &min, const vfloat2_t &max) {
+    const float dx =
+        std::max(std::max(min[0] - point[0], point[0] - max[0]), 0.f) *
+        scale[0];
+    const float dy =
+        std::max(std::max(min[1] - point[1], point[1] - max[1]), 0.f) *
+        scale[1];
+    return dx * dx + dy * dy;
+  }
+
+  /// grows the box [@p min, @p max] to contain the box [@p lo, @p hi]
+  static void extend(vfloat2_t &min, vfloat2_t &max, const vfloat2_t &lo,
+                     const vfloat2_t &hi) {
+    for (int i = 0; i < 2; ++i) {
+      min[i] = std::min(min[i], lo[i]);
+      max[i] = std::max(max[i], hi[i]);
+    }
+  }
+
+  /// returns the range of items [@p begin, @p end) of the @p i-th node at
+  /// @p level of the tree
+  void node_range(const int level, const int i, int &begin, int &end) const {
+    begin = 0;
+    end = size();
+    for (int l = level - 1; l >= 0; --l) {
+      const int middle = (begin + end) / 2;
+      if ((i >> l) & 1) {
+        begin = middle;
+      } else {
+        end = middle;
+      }
+    }
+  }
+
+  /// the centre of an item and its position in the input, sorted together
+  /// while building so that the comparisons do not chase indices
+  struct Centre {
+    vfloat2_t point;
+    int index;
+  };
+
+  /// sorts the items [@p begin, @p end) of @p centres into the subtree rooted
+  /// at @p level, down to level @p stop
+  static void split(const int level, const int stop, const int begin,
+                    const int end, std::vector<Centre> &centres) {
+    if (level == stop) {
+      return;
+    }
+    vfloat2_t min = centres[begin].point;
+    vfloat2_t max = min;
+    for (int i = begin + 1; i < end; ++i) {
+      extend(min, max, centres[i].point, centres[i].point);
+    }
+    const int axis = max[0] - min[0] >= max[1] - min[1] ? 0 : 1;
+    const int middle = (begin + end) / 2;
+    std::nth_element(centres.begin() + begin, centres.begin() + middle,
+                     centres.begin() + end,
+                     [axis](const Centre &a, const Centre &b) {
+                       return a.point[axis] < b.point[axis];
+                     });
+    split(level + 1, stop, begin, middle, centres);
+    split(level + 1, stop, middle, end, centres);
+  }
+
+  void build() {
+    const int n = size();
+    if (n == 0) {
+      return;
+    }
+    m_depth = 0;
+    while ((n + (1 << m_depth) - 1) >> m_depth > leaf_size) {
+      ++m_depth;
+    }
+
+    std::vector<Centre> centres(n);
+    for (int i = 0; i < n; ++i) {
+      centres[i].point =
+          m_max.empty() ? m_min[i] : 0.5f * (m_min[i] + m_max[i]);
+      centres[i].index = i;
+    }
+
+    // split the first few levels serially, then build the subtrees below
+    // them in parallel
+    int top = 0;
+    while (top < m_depth && (1 << top) < 4 * get_num_threads()) {
+      ++top;
+    }
+    split(0, top, 0, n, centres);
+    parallel_for_blocks(
+        1 << top, 1, [&](const int, const int, const int first, const int) {
+          int begin, end;
+          node_range(top, first, begin, end);
+          split(top, m_depth, begin, end, centres);
+        });
+
+    // put the items into tree order
+    std::vector<vfloat2_t> min(n);
+    std::vector<int> ids(n);
+    for (int i = 0; i < n; ++i) {
+      min[i] = m_min[centres[i].index];
+      ids[i] = m_ids[centres[i].index];
+    }
+    m_min.swap(min);
+    m_ids.swap(ids);
+    if (!m_max.empty()) {
+      std::vector<vfloat2_t> max(n);
+      for (int i = 0; i < n; ++i) {
+        max[i] = m_max[centres[i].index];
+      }
+      m_max.swap(max);
+    }
+
+    // bounding boxes of the leaves, then of each level above them
+    const int first_leaf = (1 << m_depth) - 1;
+    m_node_min.resize(first_leaf + (1 << m_depth));
+    m_node_max.resize(m_node_min.size());
+    parallel_for_blocks(
+        1 << m_depth, 1024,
+        [&](const int, const int, const int first, const int last) {
+          for (int leaf = first; leaf < last; ++leaf) {
+            int begin, end;
+            node_range(m_depth, leaf, begin, end);
+            vfloat2_t min = vfloat2_t::Constant(
+                std::numeric_limits<float>::max());
+            vfloat2_t max = -min;
+            for (int i = begin; i < end; ++i) {
+              extend(min, max, m_min[i], m_max.empty() ? m_min[i] : m_max[i]);
+            }
+            m_node_min[first_leaf + leaf] = min;
+            m_node_max[first_leaf + leaf] = max;
+          }
+        });
+    for (int node = first_leaf - 1; node >= 0; --node) {
+      m_node_min[node] = m_node_min[2 * node + 1];
+      m_node_max[node] = m_node_max[2 * node + 1];
+      extend(m_node_min[node], m_node_max[node], m_node_min[2 * node + 2],
+             m_node_max[2 * node + 2]);
+    }
+  }
+};
+
+} // namespace trase
+
+#endif // SPATIALINDEX_H_
@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/// \file ValidityBitmap.hpp
+
+#ifndef VALIDITYBITMAP_H_
+#define VALIDITYBITMAP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace trase {
+
+/// A bitmap recording which entries of a data column hold valid values
+///
+/// Bit i is set if entry i is valid. Columns without any missing values (the
+/// common case) store no words at all, so that checking validity costs
+/// nothing. Once an entry is marked invalid the full bitmap is allocated.
+class ValidityBitmap {
+public:
+  using word_t = std::uint64_t;
+  static const int word_bits = 64;
+
+private:
+  /// one bit per entry, empty if all entries are valid
+  std::vector<word_t> m_words;
+
+  /// number of entries covered by the bitmap
+  int m_size{0};
+
+  /// number of invalid entries
+  int m_null_count{0};
+
+public:
+  ValidityBitmap() = default;
+
+  /// create a bitmap of @p size entries, all of them valid
+  explicit ValidityBitmap(int size) : m_size(size) {}
+
+  /// create a bitmap from the column given by the iterators @p begin and
+  /// @p end, where any NaN entries are marked invalid
+  template <typename T> static ValidityBitmap from_nan(T begin, T end) {
+    ValidityBitmap bitmap;
+    for (; begin != end; ++begin) {
+      bitmap.push_back(!std::isnan(*begin));
+    }
+    return bitmap;
+  }
+
+  /// returns the number of entries covered by the bitmap
+  int size() const { return m_size; }
+
+  /// returns the number of invalid entries
+  int null_count() const { return m_null_count; }
+
+  /// returns true if every entry is valid
+  bool all_valid() const { return m_null_count == 0; }
+
+  /// returns true if entry @p i is valid
+  bool test(const int i) const {
+    return m_words.empty() || (m_words[i / word_bits] >> (i % word_bits)) & 1u;
+  }
+
+  /// returns word @p i of the bitmap
+  word_t word(const int i) const {
+    return m_words.empty() ? ~word_t(0) : m_words[i];
+  }
+
+  /// marks entry @p i as valid or invalid
+  void set(const int i, const bool valid) {
+    if (test(i) == valid) {
+      return;
+    }
+    if (m_words.empty()) {
+      allocate();
+    }
+    const word_t mask = word_t(1) << (i % word_bits);
+    if (valid) {
+      m_words[i / word_bits] |= mask;
+      --m_null_count;
+    } else {
+      m_words[i / word_bits] &= ~mask;
+      ++m_null_count;
+    }
+  }
+
+  /// appends a new entry to the end of the bitmap
+  void push_back(const bool valid) {
+    const int i = m_size++;
+    if (m_words.empty()) {
+      if (!valid) {
+        allocate();
+        m_words.back() &= ~(word_t(1) << (i % word_bits));
+        ++m_null_count;
+      }
+      return;
+    }
+    if (i % word_bits == 0) {
+      m_words.push_back(0);
+    }
+    if (valid) {
+      m_words.back() |= word_t(1) << (i % word_bits);
+    } else {
+      ++m_null_count;
+    }
+  }
+
+  /// returns a bitmap where an entry is valid only if it is valid in both
+  /// this bitmap and @p other. If the sizes differ, the result covers the
+  /// shorter of the two
+  ValidityBitmap operator&(const ValidityBitmap &other) const {
+    ValidityBitmap result;
+    result.m_size = std::min(m_size, other.m_size);
+    if (all_valid() && other.all_valid()) {
+      return result;
+    }
+    result.allocate();
+    for (std::size_t i = 0; i < result.m_words.size(); ++i) {
+      result.m_words[i] &= word(static_cast<int>(i)) &
+                           other.word(static_cast<int>(i));
+    }
+    result.count_nulls();
+    return result;
+  }
+
+  /// calls @p f(i) for each valid entry i in [@p begin, @p end), in order
+  ///
+  /// The bitmap is scanned a word at a time so that runs of invalid entries
+  /// are skipped 64 at a time, and only valid entries cost a call to @p f
+  template <typename F> void for_each_valid(int begin, int end, F f) const {
+    if (m_words.empty()) {
+      for (int i = begin; i < end; ++i) {
+        f(i);
+      }
+      return;
+    }
+    if (begin >= end) {
+      return;
+    }
+    const int first_word = begin / word_bits;
+    const int last_word = (end - 1) / word_bits;
+    for (int w = first_word; w <= last_word; ++w) {
+      word_t bits = m_words[w];
+      if (w == first_word) {
+        bits &= ~word_t(0) << (begin % word_bits);
+      }
+      if (w == last_word && end % word_bits != 0) {
+        bits &= ~(~word_t(0) << (end % word_bits));
+      }
+      while (bits) {
+        f(w * word_bits + count_trailing_zeros(bits));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  /// calls @p f(i) for each valid entry i, in order
+  template <typename F> void for_each_valid(F f) const {
+    for_each_valid(0, m_size, f);
+  }
+
+private:
+  void allocate() {
+    m_words.assign((m_size + word_bits - 1) / word_bits, ~word_t(0));
+    if (m_size % word_bits != 0) {
+      m_words.back() &= ~(~word_t(0) << (m_size % word_bits));
+    }
+  }
+
+  void count_nulls() {
+    int valid = 0;
+    for (word_t w : m_words) {
+      for (; w; w &= w - 1) {
+        ++valid;
+      }
+    }
+    m_null_count = m_size - valid;
+  }
+
+  static int count_trailing_zeros(const word_t w) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, w);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(w);
+#endif
+  }
+};
+
+} // namespace trase
+
+#endif // VALIDITYBITMAP_H_
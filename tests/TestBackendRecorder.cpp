@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of trase.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include "backend/BackendRecorder.hpp"
+#include "trase.hpp"
+
+using namespace trase;
+
+namespace {
+
+std::shared_ptr<Figure> recorder_figure() {
+  auto fig = figure();
+  const std::vector<float> x = {1.f, 2.f, 3.f};
+  const std::vector<float> y = {1.f, 2.f, 3.f};
+  const std::vector<float> y2 = {3.f, 2.f, 1.f};
+  auto ax = fig->axis();
+  auto line = ax->line(create_data().x(x).y(y));
+  line->add_frame(create_data().x(x).y(y2), 1.f);
+  line->set_label("line");
+  ax->points(create_data().x(x).y(y2));
+  ax->title("recorded");
+  ax->legend();
+  return fig;
+}
+
+} // namespace
+
+TEST_CASE("recorder replays into svg as if drawn directly", "[recorder]") {
+  auto fig = recorder_figure();
+
+  std::stringstream direct;
+  BackendSVG direct_backend(direct);
+  fig->draw(direct_backend);
+
+  BackendRecorder recorder;
+  fig->draw(recorder);
+  CHECK(recorder.size() > 0);
+
+  std::stringstream replayed;
+  BackendSVG replayed_backend(replayed);
+  recorder.replay(replayed_backend);
+  CHECK(replayed.str() == direct.str());
+
+  SECTION("at a single time") {
+    std::stringstream direct_at;
+    BackendSVG direct_at_backend(direct_at);
+    fig->draw(direct_at_backend, 0.5f);
+
+    BackendRecorder recorder_at;
+    fig->draw(recorder_at, 0.5f);
+    std::stringstream replayed_at;
+    BackendSVG replayed_at_backend(replayed_at);
+    recorder_at.replay(replayed_at_backend);
+    CHECK(replayed_at.str() == direct_at.str());
+  }
+}
+
+TEST_CASE("recorder can be inspected", "[recorder]") {
+  auto fig = recorder_figure();
+  BackendRecorder recorder;
+  fig->draw(recorder, 0.f);
+
+  const auto commands = recorder.commands();
+  CHECK(commands.size() == recorder.size());
+  CHECK(commands.front() == BackendRecorder::Command::init);
+  CHECK(commands.back() == BackendRecorder::Command::finalise);
+  CHECK(std::count(commands.begin(), commands.end(),
+                   BackendRecorder::Command::circles) == 1);
+
+  // strings and colors are only stored once
+  const auto &strings = recorder.strings();
+  CHECK(std::count(strings.begin(), strings.end(), "recorded") == 1);
+  CHECK(std::count(strings.begin(), strings.end(), "line") == 1);
+  const auto &colors = recorder.colors();
+  for (const auto &color : colors) {
+    CHECK(std::count(colors.begin(), colors.end(), color) == 1);
+  }
+}
+
+TEST_CASE("recorder can be saved and loaded", "[recorder]") {
+  auto fig = recorder_figure();
+  BackendRecorder recorder;
+  fig->draw(recorder);
+
+  std::stringstream file;
+  recorder.save(file);
+
+  BackendRecorder loaded;
+  loaded.load(file);
+  CHECK(loaded.size() == recorder.size());
+  CHECK(loaded.bytes() == recorder.bytes());
+  CHECK(loaded.commands() == recorder.commands());
+
+  std::stringstream original_svg;
+  BackendSVG original_backend(original_svg);
+  recorder.replay(original_backend);
+  std::stringstream loaded_svg;
+  BackendSVG loaded_backend(loaded_svg);
+  loaded.replay(loaded_backend);
+  CHECK(loaded_svg.str() == original_svg.str());
+
+  SECTION("replaying into a recorder gives the same recording") {
+    BackendRecorder copy;
+    recorder.replay(copy);
+    CHECK(copy.commands() == recorder.commands());
+    CHECK(copy.bytes() == recorder.bytes());
+  }
+
+  SECTION("invalid recordings are not loaded") {
+    std::string truncated = file.str();
+    truncated.resize(truncated.size() - 5);
+    std::stringstream truncated_file(truncated);
+    CHECK_THROWS_AS(loaded.load(truncated_file), Exception);
+
+    std::stringstream not_a_recording("not a recording");
+    CHECK_THROWS_AS(loaded.load(not_a_recording), Exception);
+
+    // a huge buffer size is not trusted
+    std::string oversized = file.str();
+    const std::uint64_t huge = std::uint64_t(1) << 60;
+    std::memcpy(&oversized[oversized.size() - recorder.bytes() - sizeof(huge)],
+                &huge, sizeof(huge));
+    std::stringstream oversized_file(oversized);
+    CHECK_THROWS_AS(loaded.load(oversized_file), Exception);
+
+    // nor is a huge array length in a command
+    std::string huge_array = file.str().substr(0, 12);
+    const std::uint32_t none = 0;
+    const std::uint64_t commands = 1;
+    const std::uint64_t bytes = 8;
+    const auto circles =
+        static_cast<std::uint8_t>(BackendRecorder::Command::circles);
+    const std::int32_t n = std::numeric_limits<std::int32_t>::max();
+    huge_array.append(reinterpret_cast<const char *>(&none), sizeof(none));
+    huge_array.append(reinterpret_cast<const char *>(&none), sizeof(none));
+    huge_array.append(reinterpret_cast<const char *>(&commands),
+                      sizeof(commands));
+    huge_array.append(reinterpret_cast<const char *>(&bytes), sizeof(bytes));
+    huge_array.append(reinterpret_cast<const char *>(&circles),
+                      sizeof(circles));
+    huge_array.append(reinterpret_cast<const char *>(&n), sizeof(n));
+    huge_array.append(3, '\0');
+    std::stringstream huge_array_file(huge_array);
+    CHECK_THROWS_AS(loaded.load(huge_array_file), Exception);
+
+    // the previous recording is kept
+    CHECK(loaded.commands() == recorder.commands());
+  }
+}
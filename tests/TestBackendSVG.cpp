@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cctype>
 #include <fstream>
+#include <limits>
 #include <random>
 
 #include "backend/BackendSVG.hpp"
@@ -306,3 +307,132 @@ TEST_CASE("svg backend circle works as expected", "[svg_backend]") {
     out_f.close();
   }
 }
+
+TEST_CASE("line is broken at missing values", "[svg_backend]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  auto fig = figure();
+  auto ax = fig->axis();
+  std::vector<float> x = {0.f, 1.f, 2.f, 3.f, 4.f};
+  std::vector<float> y = {0.f, 1.f, nan, 3.f, 4.f};
+  ax->line(create_data().x(x).y(y));
+
+  std::stringstream out_ss;
+  BackendSVG backend(out_ss);
+  fig->draw(backend);
+
+  // the line path is the only one drawn with two move commands
+  const std::string svg = out_ss.str();
+  bool found = false;
+  for (auto pos = svg.find("d=\""); pos != std::string::npos;
+       pos = svg.find("d=\"", pos + 1)) {
+    const auto path = svg.substr(pos, svg.find('"', pos + 3) - pos);
+    if (std::count(path.begin(), path.end(), 'M') == 2 &&
+        std::count(path.begin(), path.end(), 'L') == 2) {
+      found = true;
+    }
+  }
+  CHECK(found);
+}
+
+TEST_CASE("svg backend bulk primitives work as expected", "[svg_backend]") {
+
+  std::stringstream out_ss;
+  BackendSVG backend(out_ss);
+
+  SECTION("circles are written in one styled group") {
+    const std::vector<float> x = {1.5f, 2.f, 3.25f};
+    const std::vector<float> y = {4.f, 5.f, 6.f};
+    const std::vector<float> r = {1.f, 2.f, 3.f};
+    const std::vector<RGBA> fill = {
+        {255, 0, 0, 255}, {0, 255, 0, 255}, {0, 0, 255, 255}};
+    backend.circles(3, x.data(), y.data(), r.data(), fill.data());
+
+    const std::string svg = out_ss.str();
+    CHECK(starts_with_ignoring_ws(svg, "<g"));
+    CHECK(ends_with_ignoring_ws(svg, "</g>"));
+    int count = 0;
+    for (auto pos = svg.find("<circle"); pos != std::string::npos;
+         pos = svg.find("<circle", pos + 1)) {
+      ++count;
+    }
+    CHECK(count == 3);
+    CHECK(is_substr_ignoring_ws(svg, R"(cx="1.5" cy="4" r="1")"));
+    CHECK(is_substr_ignoring_ws(svg, R"(cx="3.25")"));
+    CHECK(is_substr_ignoring_ws(svg, R"(fill="#0000ff")"));
+  }
+
+  SECTION("rects are normalised to positive width and height") {
+    const float xmin = 3.f;
+    const float ymin = 1.f;
+    const float xmax = 1.f;
+    const float ymax = 4.5f;
+    backend.rects(1, &xmin, &ymin, &xmax, &ymax);
+
+    CHECK(is_substr_ignoring_ws(out_ss.str(),
+                                R"(x="1" y="1" width="2" height="3.5")"));
+  }
+
+  SECTION("polyline is appended to the current path") {
+    const std::vector<float> xy = {0.f, 1.f, 2.f, 3.f, 4.f, 5.f};
+    backend.begin_path();
+    backend.polyline(3, &xy[0], &xy[1], 2);
+    backend.stroke();
+
+    CHECK(is_substr_ignoring_ws(
+        out_ss.str(),
+        R"(d="M 0.000000 1.000000 L 2.000000 3.000000 L 4.000000 5.000000")"));
+  }
+
+  SECTION("numbers are written as by the single drawing calls") {
+    const std::vector<float> values = {0.f,       -0.f,   0.0078125f,
+                                       -0.0004f,  1.5f,   123.456f,
+                                       -98765.4f, 1e10f, 3e38f};
+    auto attributes = [](const std::string &svg, const std::string &name) {
+      std::vector<std::string> result;
+      const std::string tag = ' ' + name + "=\"";
+      for (auto pos = svg.find(tag); pos != std::string::npos;
+           pos = svg.find(tag, pos + 1)) {
+        const auto begin = pos + tag.size();
+        result.push_back(svg.substr(begin, svg.find('"', begin) - begin));
+      }
+      return result;
+    };
+
+    std::stringstream single_ss;
+    BackendSVG single(single_ss);
+    single.begin_path();
+    for (size_t i = 0; i < values.size(); ++i) {
+      const float v = values[i];
+      single.circle({v, v}, v);
+      single.rect(bfloat2_t({v, v}, {v + 1.f, v + 2.f}));
+      if (i == 0) {
+        single.move_to({v, -v});
+      } else {
+        single.line_to({v, -v});
+      }
+    }
+    single.stroke();
+
+    std::vector<float> xmax(values);
+    std::vector<float> ymax(values);
+    std::vector<float> y(values);
+    for (size_t i = 0; i < values.size(); ++i) {
+      xmax[i] += 1.f;
+      ymax[i] += 2.f;
+      y[i] = -values[i];
+    }
+    const int n = static_cast<int>(values.size());
+    backend.circles(n, values.data(), values.data(), values.data());
+    backend.rects(n, values.data(), values.data(), xmax.data(), ymax.data());
+    backend.begin_path();
+    backend.polyline(n, values.data(), y.data());
+    backend.stroke();
+
+    const std::string svg = out_ss.str();
+    const std::string single_svg = single_ss.str();
+    for (const auto name : {"cx", "r", "x", "width", "height"}) {
+      CHECK(attributes(svg, name) == attributes(single_svg, name));
+    }
+    CHECK(attributes(svg, "d") == attributes(single_svg, "d"));
+  }
+}
@@ -33,6 +33,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "catch.hpp"
 
+#include <algorithm>
 #include <limits>
 #include <type_traits>
 
@@ -523,3 +524,95 @@ TEST_CASE("test set limits", "[data]") {
   data.ymax(10.f, 11.f);
   CHECK(data.limits().bmax[Aesthetic::y::index] == 11.f);
 }
+
+TEST_CASE("validity bitmap", "[data]") {
+  ValidityBitmap bitmap(130);
+  CHECK(bitmap.size() == 130);
+  CHECK(bitmap.all_valid());
+
+  bitmap.set(3, false);
+  bitmap.set(64, false);
+  bitmap.set(129, false);
+  CHECK(bitmap.null_count() == 3);
+  CHECK_FALSE(bitmap.test(3));
+  CHECK(bitmap.test(4));
+
+  std::vector<int> visited;
+  bitmap.for_each_valid(60, 130, [&](int i) { visited.push_back(i); });
+  CHECK(visited.size() == 68);
+  CHECK(visited.front() == 60);
+  CHECK(visited.back() == 128);
+  CHECK(std::find(visited.begin(), visited.end(), 64) == visited.end());
+
+  ValidityBitmap other(130);
+  other.set(4, false);
+  auto both = bitmap & other;
+  CHECK(both.null_count() == 4);
+  CHECK_FALSE(both.test(4));
+  CHECK_FALSE(both.test(3));
+
+  bitmap.set(3, true);
+  CHECK(bitmap.null_count() == 2);
+  CHECK(bitmap.test(3));
+}
+
+TEST_CASE("missing values in raw data", "[data]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  RawData data;
+  std::vector<float> col = {1.f, nan, 3.f, nan};
+  data.add_column(col);
+  CHECK(data.valid(0).null_count() == 2);
+  CHECK_FALSE(data.valid(0).test(1));
+  CHECK(data.valid(0).test(2));
+  CHECK_THROWS_AS(data.valid(1), std::out_of_range);
+
+  std::vector<float> row = {nan};
+  data.add_row(row);
+  CHECK(data.valid(0).size() == 5);
+  CHECK(data.valid(0).null_count() == 3);
+
+  std::vector<float> full_col = {1.f, 2.f, 3.f, 4.f, 5.f};
+  data.set_column(0, full_col);
+  CHECK(data.valid(0).all_valid());
+}
+
+TEST_CASE("limits ignore missing values", "[data]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> x = {nan, 2.f, -1.f, nan, 5.f};
+  std::vector<float> y = {1.f, 2.f, 3.f, 4.f, nan};
+  auto data = create_data().x(x).y(y);
+  CHECK(data.valid<Aesthetic::x>().null_count() == 2);
+  CHECK(data.limits().bmin[Aesthetic::x::index] == -1.f);
+  CHECK(data.limits().bmax[Aesthetic::x::index] == 5.f);
+  CHECK(data.limits().bmin[Aesthetic::y::index] == 1.f);
+  CHECK(data.limits().bmax[Aesthetic::y::index] == 4.f);
+}
+
+TEST_CASE("column statistics", "[data]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  RawData data;
+  std::vector<float> col = {1.f, nan, 3.f, 5.f};
+  data.add_column(col);
+  auto stats = data.statistics(0);
+  CHECK(stats.count == 3);
+  CHECK(stats.min == 1.f);
+  CHECK(stats.max == 5.f);
+  CHECK(stats.mean == Approx(3.0));
+  CHECK(stats.variance == Approx(8.0 / 3.0));
+  CHECK_THROWS_AS(data.statistics(1), std::out_of_range);
+
+  // the cached statistics are updated when the data changes
+  std::vector<float> row = {9.f};
+  data.add_row(row);
+  CHECK(data.statistics(0).count == 4);
+  CHECK(data.statistics(0).max == 9.f);
+
+  std::vector<float> full_col = {1.f, 2.f, 3.f, 4.f, 5.f};
+  data.set_column(0, full_col);
+  CHECK(data.statistics(0).count == 5);
+  CHECK(data.statistics(0).mean == Approx(3.0));
+
+  auto with_aesthetic = create_data().x(col);
+  CHECK(with_aesthetic.statistics<Aesthetic::x>().count == 3);
+  CHECK_THROWS_AS(with_aesthetic.statistics<Aesthetic::y>(), Exception);
+}
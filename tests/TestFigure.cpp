@@ -156,3 +156,74 @@ TEST_CASE("readme", "[figure]") {
   fig->draw(backend);
   out.close();
 }
+
+TEST_CASE("redrawing replays drawables that have not changed", "[figure]") {
+  auto fig = figure();
+  const std::vector<float> x = {1.f, 2.f, 3.f};
+  const std::vector<float> y = {1.f, 2.f, 3.f};
+  const std::vector<float> y2 = {3.f, 2.f, 1.f};
+
+  auto ax = fig->axis();
+  auto line = ax->line(create_data().x(x).y(y));
+  line->add_frame(create_data().x(x).y(y2), 1.f);
+  line->set_label("line");
+  ax->legend();
+  auto ax2 = fig->axis(1, 0);
+  auto points = ax2->points(create_data().x(x).y(y));
+
+  auto draw = [&]() {
+    std::stringstream out;
+    BackendSVG backend(out);
+    fig->draw(backend);
+    return out.str();
+  };
+  auto draw_at = [&](const float time) {
+    std::stringstream out;
+    BackendSVG backend(out);
+    fig->draw(backend, time);
+    return out.str();
+  };
+
+  const std::string first_at = draw_at(0.5f);
+  CHECK(draw_at(0.5f) == first_at);
+  CHECK(draw_at(0.f) != first_at);
+  const std::string first = draw();
+  CHECK(draw() == first);
+
+  // a change that is not marked is not drawn, as the points are replayed
+  const auto &data = points->get_data(0);
+  const_cast<DataWithAesthetic &>(data).y(y2);
+  CHECK(draw() == first);
+
+  // once marked, the points are drawn again and the output is the same as
+  // drawing everything again
+  points->mark_dirty();
+  const std::string second = draw();
+  CHECK(second != first);
+  fig->mark_subtree_dirty();
+  CHECK(draw() == second);
+
+  // changes to a legend entry are drawn in the legend
+  line->set_label("renamed");
+  CHECK(draw().find("renamed") != std::string::npos);
+
+  // picking and reading the limits do not mark anything as changed, but
+  // setting the limits does
+  const auto version = ax->version();
+  const auto points_version = points->version();
+  points->pick(ax2->pixels().bmin + 0.5f * ax2->pixels().delta(), 5.f);
+  line->pick(ax->pixels().bmin + 0.5f * ax->pixels().delta(), 5.f);
+  ax->limits();
+  CHECK(ax->version() == version);
+  CHECK(points->version() == points_version);
+  ax2->set_limits(ax2->limits());
+  CHECK(points->version() != points_version);
+
+  // as do replacing a data frame and setting the transform
+  auto version_before = points->version();
+  points->set_data(0, points->get_data(0));
+  CHECK(points->version() != version_before);
+  version_before = points->version();
+  points->set_transform(Transform(Identity()));
+  CHECK(points->version() != version_before);
+}
@@ -34,10 +34,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // This tells Catch to provide a main() - only do this in one cpp file
 #include "catch.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <random>
+#include <sstream>
 #include <type_traits>
+#include <vector>
 
 #include "trase.hpp"
+#include "frontend/Points.hpp"
 
 using namespace trase;
 
@@ -67,3 +75,497 @@ TEST_CASE("line geometry can be created", "[geometry]") {
   auto data = create_data().x(x).y(y);
   auto pl5 = ax->line(data);
 }
+
+TEST_CASE("m4 decimation keeps the extremes of each pixel column",
+          "[geometry]") {
+  const bfloat2_t pixels({10.f, 0.f}, {110.f, 100.f});
+  std::default_random_engine gen;
+  std::uniform_real_distribution<float> uniform(0.f, 100.f);
+  const int n = 100000;
+  std::vector<vfloat2_t> points(n);
+  for (int i = 0; i < n; ++i) {
+    // includes points either side of the visible range
+    points[i] = {-20.f + 150.f * i / n, uniform(gen)};
+  }
+
+  std::vector<vfloat2_t> kept;
+  std::vector<bool> connected;
+  auto decimator = make_m4_decimator(
+      [&](const vfloat2_t &point, const bool c) {
+        kept.push_back(point);
+        connected.push_back(c);
+      },
+      pixels, true);
+  for (int i = 0; i < n; ++i) {
+    // a gap after the first 1000 points
+    if (i != 1000) {
+      decimator.add(i, points[i]);
+    }
+  }
+  decimator.flush();
+
+  CHECK(kept.size() <= 4 * (100 + 2) + 4);
+  CHECK(kept.front()[0] == points.front()[0]);
+  CHECK(kept.back()[0] == points.back()[0]);
+  CHECK(std::count(connected.begin(), connected.end(), false) == 2);
+
+  // the vertical extent of each column is unchanged
+  auto column = [](const float x) { return std::floor(x - 10.f); };
+  std::map<float, std::pair<float, float>> all;
+  std::map<float, std::pair<float, float>> decimated;
+  auto extend = [&](std::map<float, std::pair<float, float>> &extents,
+                    const vfloat2_t &p) {
+    auto result = extents.emplace(column(p[0]), std::make_pair(p[1], p[1]));
+    result.first->second.first = std::min(result.first->second.first, p[1]);
+    result.first->second.second = std::max(result.first->second.second, p[1]);
+  };
+  for (int i = 0; i < n; ++i) {
+    if (i != 1000 && points[i][0] >= 10.f && points[i][0] < 110.f) {
+      extend(all, points[i]);
+    }
+  }
+  for (const auto &p : kept) {
+    if (p[0] >= 10.f && p[0] < 110.f) {
+      extend(decimated, p);
+    }
+  }
+  CHECK(all == decimated);
+}
+
+TEST_CASE("m4 decimated line has at most four points per pixel",
+          "[geometry]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+  const int n = 200000;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = static_cast<float>(i);
+    y[i] = std::sin(0.01f * i) + 0.1f * std::sin(1.3f * i);
+  }
+  auto line = std::dynamic_pointer_cast<Line>(
+      ax->line(create_data().x(x).y(y)));
+  line->set_decimation(Line::Decimation::m4);
+
+  std::stringstream out;
+  BackendSVG backend(out);
+  fig->draw(backend);
+  const std::string svg = out.str();
+  std::size_t longest = 0;
+  for (auto pos = svg.find("d=\""); pos != std::string::npos;
+       pos = svg.find("d=\"", pos + 1)) {
+    const auto path = svg.substr(pos, svg.find('"', pos + 3) - pos);
+    longest = std::max<std::size_t>(
+        longest, std::count(path.begin(), path.end(), 'L') +
+                     std::count(path.begin(), path.end(), 'M'));
+  }
+  const float width = ax->pixels().delta()[0];
+  CHECK(longest > 0);
+  CHECK(longest <= 4 * (width + 3));
+}
+
+TEST_CASE("animated lines have the same path commands in every frame",
+          "[geometry]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+
+  // frames of different lengths, with gaps in different places and points
+  // outside the axis
+  auto frame = [](const int n, const float phase, const int gap) {
+    std::vector<float> x(n);
+    std::vector<float> y(n);
+    for (int i = 0; i < n; ++i) {
+      x[i] = static_cast<float>(i);
+      y[i] = std::sin(0.01f * i + phase) + 0.1f * std::sin(1.3f * i);
+    }
+    y[gap] = std::numeric_limits<float>::quiet_NaN();
+    return create_data().x(x).y(y);
+  };
+  auto line = std::dynamic_pointer_cast<Line>(ax->line(frame(2000, 0.f, 100)));
+  line->add_frame(frame(2500, 1.f, 300), 1.f);
+  line->add_frame(frame(1500, 2.f, 301), 2.f);
+  line->set_decimation(Line::Decimation::m4);
+  line->set_simplification(0.5f);
+  ax->xlim({200.f, 1200.f});
+
+  std::stringstream out;
+  BackendSVG backend(out);
+  fig->draw(backend);
+  const std::string svg = out.str();
+  const auto animate = svg.find("attributeName=\"d\"");
+  REQUIRE(animate != std::string::npos);
+  const auto begin = svg.find("values=\"", animate) + 8;
+  const std::string values = svg.substr(begin, svg.find('"', begin) - begin);
+
+  std::vector<std::string> commands;
+  std::stringstream frames(values);
+  for (std::string path; std::getline(frames, path, ';');) {
+    commands.emplace_back();
+    std::copy_if(path.begin(), path.end(), std::back_inserter(commands.back()),
+                 [](const char c) { return c == 'M' || c == 'L'; });
+  }
+  REQUIRE(commands.size() == 3);
+  CHECK(commands[0].size() > 0);
+  CHECK(commands[1] == commands[0]);
+  CHECK(commands[2] == commands[0]);
+}
+
+TEST_CASE("points density draws at most one rect per pixel", "[geometry]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+  const int n = 200000;
+  std::default_random_engine gen(42);
+  std::normal_distribution<float> normal;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  std::vector<float> c(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = normal(gen);
+    y[i] = normal(gen);
+    c[i] = x[i] * y[i];
+  }
+  auto points = std::dynamic_pointer_cast<Points>(
+      ax->points(create_data().x(x).y(y).color(c)));
+
+  auto count = [&](const std::string &svg, const std::string &tag) {
+    std::size_t count = 0;
+    for (auto pos = svg.find(tag); pos != std::string::npos;
+         pos = svg.find(tag, pos + 1)) {
+      ++count;
+    }
+    return count;
+  };
+
+  const auto pixels = ax->pixels().delta();
+  const std::size_t cells = static_cast<std::size_t>(
+      std::ceil(pixels[0]) * std::ceil(pixels[1]));
+  for (auto density : {Points::Density::count, Points::Density::mean,
+                       Points::Density::max}) {
+    for (auto normalization :
+         {Points::Normalization::linear, Points::Normalization::log,
+          Points::Normalization::equalize}) {
+      points->set_density(density, normalization);
+      std::stringstream out;
+      BackendSVG backend(out);
+      fig->draw(backend);
+      const std::string svg = out.str();
+      CHECK(count(svg, "<circle") == 0);
+      CHECK(count(svg, "<rect") > 0);
+      CHECK(count(svg, "<rect") <= cells + 10);
+    }
+  }
+
+  points->set_density(Points::Density::none);
+  std::stringstream out;
+  BackendSVG backend(out);
+  fig->draw(backend);
+  CHECK(count(out.str(), "<circle") >= static_cast<std::size_t>(n));
+}
+
+TEST_CASE("douglas peucker keeps points within tolerance", "[geometry]") {
+  std::default_random_engine gen(1);
+  std::normal_distribution<float> normal;
+  std::vector<vfloat2_t> points(5000);
+  vfloat2_t p{0.f, 0.f};
+  for (auto &point : points) {
+    p += vfloat2_t{0.1f + std::abs(normal(gen)), normal(gen)};
+    point = p;
+  }
+
+  // every removed point is within the tolerance of the segment replacing it
+  std::vector<vfloat2_t> kept;
+  bool first = true;
+  auto simplifier = make_polyline_simplifier(
+      [&](const vfloat2_t &point, const bool connected) {
+        CHECK(connected != first);
+        first = false;
+        kept.push_back(point);
+      },
+      0.5f);
+  for (const auto &point : points) {
+    simplifier.add(point, &point != &points[0]);
+  }
+  simplifier.flush();
+  CHECK(kept.size() < points.size());
+  REQUIRE((kept.front() == points.front()).all());
+  REQUIRE((kept.back() == points.back()).all());
+  std::size_t k = 0;
+  for (const auto &point : points) {
+    if (k + 1 < kept.size() && (point == kept[k + 1]).all()) {
+      ++k;
+    }
+    if (k + 1 < kept.size()) {
+      CHECK(squared_segment_distance(point, kept[k], kept[k + 1]) <=
+            0.25f + 1e-4f);
+    }
+  }
+}
+
+TEST_CASE("simplified line has far fewer points", "[geometry]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+  const int n = 20000;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = static_cast<float>(i);
+    y[i] = i == n / 2 ? std::numeric_limits<float>::quiet_NaN()
+                      : std::sin(0.001f * i);
+  }
+  auto line = std::dynamic_pointer_cast<Line>(
+      ax->line(create_data().x(x).y(y)));
+
+  auto path_points = [&]() {
+    std::stringstream out;
+    BackendSVG backend(out);
+    fig->draw(backend);
+    const std::string svg = out.str();
+    return std::count(svg.begin(), svg.end(), 'L') +
+           std::count(svg.begin(), svg.end(), 'M');
+  };
+  const auto full = path_points();
+  line->set_simplification(0.5f);
+  const auto simplified = path_points();
+  CHECK(simplified < full / 20);
+  CHECK(simplified > 10);
+
+  // combined with decimation
+  line->set_decimation(Line::Decimation::m4);
+  CHECK(path_points() <= simplified + 10);
+}
+
+TEST_CASE("spatial index finds the nearest item in range", "[geometry]") {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> uniform(0.f, 10.f);
+  const int n = 5000;
+  std::vector<vfloat2_t> points(n);
+  std::vector<vfloat2_t> corners(n);
+  std::vector<int> ids(n);
+  for (int i = 0; i < n; ++i) {
+    points[i] = {uniform(gen), uniform(gen)};
+    corners[i] = points[i] + vfloat2_t(0.05f * uniform(gen), 0.01f);
+    ids[i] = 2 * i;
+  }
+  const SpatialIndex point_index(points, ids);
+  const SpatialIndex box_index(points, corners, ids);
+  CHECK(point_index.size() == n);
+
+  // distances are scaled differently along each axis
+  const vfloat2_t scale(8.f, 2.f);
+  auto box_distance2 = [&](const vfloat2_t &p, const vfloat2_t &min,
+                           const vfloat2_t &max) {
+    const float dx = std::max(std::max(min[0] - p[0], p[0] - max[0]), 0.f);
+    const float dy = std::max(std::max(min[1] - p[1], p[1] - max[1]), 0.f);
+    return std::pow(dx * scale[0], 2.f) + std::pow(dy * scale[1], 2.f);
+  };
+  for (int q = 0; q < 200; ++q) {
+    const vfloat2_t p = {uniform(gen), uniform(gen)};
+    const float max_distance = q % 2 ? 0.5f : 100.f;
+    float point_best = max_distance * max_distance;
+    float box_best = point_best;
+    for (int i = 0; i < n; ++i) {
+      point_best =
+          std::min(point_best, box_distance2(p, points[i], points[i]));
+      box_best = std::min(box_best, box_distance2(p, points[i], corners[i]));
+    }
+    const auto point_nearest = point_index.nearest(p, scale, max_distance);
+    const auto box_nearest = box_index.nearest(p, scale, max_distance);
+    if (point_nearest.id >= 0) {
+      CHECK(point_nearest.distance2 == Approx(point_best));
+      CHECK(box_distance2(p, points[point_nearest.id / 2],
+                          points[point_nearest.id / 2]) ==
+            Approx(point_best));
+    } else {
+      CHECK(point_best == max_distance * max_distance);
+    }
+    if (box_nearest.id >= 0) {
+      CHECK(box_nearest.distance2 == Approx(box_best));
+    }
+  }
+  CHECK(SpatialIndex().nearest({0.f, 0.f}, scale, 100.f).id == -1);
+}
+
+TEST_CASE("axis picks the nearest row of any geometry", "[geometry]") {
+  auto fig = figure({100, 100});
+  auto ax = fig->axis();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  auto points = ax->points(
+      create_data().x(std::vector<float>{1.f, 2.f, nan, 8.f})
+          .y(std::vector<float>{1.f, 8.f, 5.f, 2.f}));
+  auto rects =
+      ax->rectangle(create_data()
+                        .xmin(std::vector<float>{4.f})
+                        .ymin(std::vector<float>{4.f})
+                        .xmax(std::vector<float>{6.f})
+                        .ymax(std::vector<float>{6.f}));
+  ax->xlim({0.f, 10.f});
+  ax->ylim({0.f, 10.f});
+  auto pixel = [&](const float x, const float y) {
+    return vfloat2_t(ax->to_display<Aesthetic::x>(x),
+                     ax->to_display<Aesthetic::y>(y));
+  };
+
+  // next to a point
+  auto picked = ax->pick(pixel(2.f, 8.f) + vfloat2_t(1.f, 1.f));
+  REQUIRE(picked);
+  CHECK(picked.geometry == points.get());
+  CHECK(picked.row == 1);
+  CHECK(picked.distance == Approx(std::sqrt(2.f)));
+
+  // inside the rectangle
+  picked = ax->pick(pixel(5.5f, 4.5f));
+  REQUIRE(picked);
+  CHECK(picked.geometry == rects.get());
+  CHECK(picked.row == 0);
+  CHECK(picked.distance == 0.f);
+
+  // the missing point is not picked, and nothing is in range
+  CHECK_FALSE(ax->pick(pixel(0.f, 5.f)));
+  CHECK_FALSE(ax->pick(pixel(2.f, 5.f), 1.f));
+  CHECK(ax->pick(pixel(2.f, 5.f), 100.f).geometry == rects.get());
+
+  // the index is rebuilt when the data changes
+  auto moved = points->get_data(0);
+  moved.y(std::vector<float>{1.f, 8.f, 5.f, 3.f});
+  points->set_data(0, moved);
+  picked = ax->pick(pixel(8.f, 3.f));
+  REQUIRE(picked);
+  CHECK(picked.row == 3);
+  CHECK(picked.distance == Approx(0.f).margin(1e-3));
+
+  // histogram bars
+  auto fig2 = figure({100, 100});
+  auto ax2 = fig2->axis();
+  auto hist = ax2->histogram(
+      create_data().x(std::vector<float>{0.f, 1.f, 1.5f, 3.f, 3.5f, 3.9f}),
+      Transform(BinX(4)));
+  ax2->xlim({0.f, 4.f});
+  ax2->ylim({0.f, 4.f});
+  picked = ax2->pick(vfloat2_t(ax2->to_display<Aesthetic::x>(3.5f),
+                               ax2->to_display<Aesthetic::y>(1.f)));
+  REQUIRE(picked);
+  CHECK(picked.geometry == hist.get());
+  CHECK(picked.distance == 0.f);
+  CHECK_FALSE(ax2->pick(vfloat2_t(ax2->to_display<Aesthetic::x>(2.5f),
+                                  ax2->to_display<Aesthetic::y>(3.5f))));
+}
+
+TEST_CASE("viewport culler keeps segments crossing the view", "[geometry]") {
+  const bfloat2_t view({0.f, 0.f}, {10.f, 10.f});
+  std::vector<int> rows;
+  auto culler = make_viewport_culler(
+      [&](const int row, const vfloat2_t &) { rows.push_back(row); }, view,
+      0.f);
+  culler.add(0, {-30.f, 5.f});  // outside
+  culler.add(1, {-20.f, 5.f});  // outside, segment 1-2 crosses the view
+  culler.add(2, {20.f, 5.f});   // outside
+  culler.add(3, {30.f, -20.f}); // outside, segment 2-3 misses the view
+  culler.add(5, {40.f, -20.f}); // outside, not joined to row 3
+  culler.add(6, {5.f, 5.f});    // inside, segment 5-6 crosses the view
+  culler.add(8, {20.f, 30.f});  // outside, not joined to row 6
+  culler.add(9, {-5.f, 20.f});  // segment 8-9 misses the corner
+  CHECK(rows == std::vector<int>({1, 2, 5, 6}));
+}
+
+TEST_CASE("zoomed drawing culls primitives outside the axis", "[geometry]") {
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> uniform(0.f, 100.f);
+  const int n = 4000;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  std::vector<float> x2(n);
+  std::vector<float> y2(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = uniform(gen);
+    y[i] = uniform(gen);
+    x2[i] = x[i] + 0.5f;
+    y2[i] = y[i] + 0.5f;
+  }
+  std::vector<float> line_x(n);
+  std::vector<float> line_y(n);
+  for (int i = 0; i < n; ++i) {
+    line_x[i] = 100.f * i / n;
+    line_y[i] = 50.f + 40.f * std::sin(0.1f * i);
+  }
+
+  auto fig = figure();
+  auto ax = fig->axis();
+  ax->points(create_data().x(x).y(y));
+  ax->rectangle(create_data().xmin(x).ymin(y).xmax(x2).ymax(y2));
+  ax->histogram(create_data().x(x), Transform(BinX(100)));
+  ax->line(create_data().x(line_x).y(line_y));
+
+  auto draw = [&]() {
+    std::stringstream out;
+    BackendSVG backend(out);
+    fig->draw(backend);
+    return out.str();
+  };
+  auto count = [](const std::string &svg, const std::string &tag) {
+    int number = 0;
+    for (auto i = svg.find(tag); i != std::string::npos;
+         i = svg.find(tag, i + 1)) {
+      ++number;
+    }
+    return number;
+  };
+
+  const std::string full = draw();
+  CHECK(count(full, "<circle") >= n);
+  CHECK(count(full, "<rect") >= n + 100);
+  CHECK(count(full, "<clipPath") == 1);
+  CHECK(count(full, "<g clip-path") == 1);
+
+  ax->xlim({40.f, 50.f});
+  ax->ylim({40.f, 50.f});
+  const std::string zoomed = draw();
+  CHECK(zoomed.size() < full.size() / 10);
+  CHECK(count(zoomed, "<circle") > 0);
+  CHECK(count(zoomed, "<circle") < n / 20);
+  CHECK(count(zoomed, "<rect") < n / 20);
+  CHECK(count(zoomed, "</g>") == count(zoomed, "<g"));
+}
+
+TEST_CASE("animated drawing keeps primitives that cross the axis",
+          "[geometry]") {
+  // the primitives are left of the axis in the first frame and right of it
+  // in the second, so are only in view between the frames
+  auto one = [](const float value) { return std::vector<float>{value}; };
+  auto draw = [&](const float x_end) {
+    auto fig = figure();
+    auto ax = fig->axis();
+    auto points = ax->points(create_data().x(one(-10.f)).y(one(5.f)));
+    points->add_frame(create_data().x(one(x_end)).y(one(5.f)), 1.f);
+    auto rects = ax->rectangle(create_data()
+                                   .xmin(one(-10.f))
+                                   .ymin(one(4.f))
+                                   .xmax(one(-9.f))
+                                   .ymax(one(6.f)));
+    rects->add_frame(create_data()
+                         .xmin(one(x_end))
+                         .ymin(one(4.f))
+                         .xmax(one(x_end + 1.f))
+                         .ymax(one(6.f)),
+                     1.f);
+    ax->xlim({0.f, 10.f});
+    ax->ylim({0.f, 10.f});
+    std::stringstream out;
+    BackendSVG backend(out);
+    fig->draw(backend);
+    return out.str();
+  };
+  auto count = [](const std::string &svg, const std::string &tag) {
+    int number = 0;
+    for (auto i = svg.find(tag); i != std::string::npos;
+         i = svg.find(tag, i + 1)) {
+      ++number;
+    }
+    return number;
+  };
+
+  const std::string crossing = draw(20.f);
+  const std::string outside = draw(-5.f);
+  CHECK(count(outside, "<circle") == 0);
+  CHECK(count(crossing, "<circle") == 1);
+  CHECK(count(crossing, "<rect") == count(outside, "<rect") + 1);
+}
@@ -34,11 +34,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "catch.hpp"
 
 #include "DummyDraw.hpp"
+#include "frontend/Histogram.hpp"
 
 //! [histogram example includes]
 #include "trase.hpp"
 #include <fstream>
 #include <random>
+#include <sstream>
 //! [histogram example includes]
 
 using namespace trase;
@@ -111,3 +113,129 @@ TEST_CASE("histogram creation", "[histogram]") {
   ax->histogram(create_data().x(x));
   DummyDraw::draw("histogram", fig);
 }
+
+TEST_CASE("histogram re-binned on zoom", "[histogram]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+  const int n = 1000;
+  std::vector<float> x(n);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  std::generate(x.begin(), x.end(), [&]() { return normal(gen); });
+  auto data = create_data().x(x);
+  CHECK_FALSE(data.has_histogram_index<Aesthetic::x>());
+
+  // adding the histogram builds the index of the samples, and re-binning on
+  // zoom (or binning with BinX) is counted from it
+  ax->histogram(data, Transform(BinX(20)));
+  CHECK(data.has_histogram_index<Aesthetic::x>());
+  ax->xlim({-1.f, 1.f});
+  ax->update_view();
+  DummyDraw::draw("histogram", fig);
+
+  const auto counts = data.histogram_index<Aesthetic::x>()->counts(20, -1, 1);
+  const auto binned = BinX(20, -1, 1)(data);
+  CHECK(std::equal(counts.begin(), counts.end(), binned.begin<Aesthetic::y>()));
+
+  // frames added after zooming are re-binned over the same range
+  auto histogram = std::dynamic_pointer_cast<Histogram>(ax->plot(0));
+  std::vector<float> x2(x);
+  std::transform(x2.begin(), x2.end(), x2.begin(),
+                 [](const float i) { return 0.5f * i; });
+  histogram->add_frame(create_data().x(x2), 1.f);
+  DummyDraw::draw("histogram", fig);
+  const Pick pick = histogram->pick(
+      {ax->to_display<Aesthetic::x>(0.f), ax->to_display<Aesthetic::y>(0.f)},
+      5.f);
+  CHECK(pick.geometry == histogram.get());
+
+  // the samples do not need to be kept alive to re-bin on zoom, and the
+  // bars are the same as binning over the zoomed range
+  auto zoomed_svg = [&](const bool rebin) {
+    auto zoomed_fig = figure();
+    auto zoomed_ax = zoomed_fig->axis();
+    if (rebin) {
+      auto temporary = create_data().x(x);
+      zoomed_ax->histogram(temporary, Transform(BinX(20)));
+    } else {
+      zoomed_ax->histogram(create_data().x(x), Transform(BinX(20, -1, 1)));
+    }
+    zoomed_ax->xlim({-1.f, 1.f});
+    zoomed_ax->ylim({0.f, 200.f});
+    zoomed_ax->update_view();
+    std::stringstream out;
+    BackendSVG backend(out);
+    zoomed_fig->draw(backend);
+    const std::string svg = out.str();
+    std::vector<std::string> rects;
+    for (auto pos = svg.find("<rect"); pos != std::string::npos;
+         pos = svg.find("<rect", pos + 1)) {
+      rects.push_back(svg.substr(pos, svg.find('>', pos) - pos));
+    }
+    return rects;
+  };
+  const auto rebinned = zoomed_svg(true);
+  CHECK(rebinned.size() >= 20);
+  CHECK(rebinned == zoomed_svg(false));
+
+  // histograms with other transforms are not re-binned
+  std::vector<float> heights = {1.f, 3.f, 2.f};
+  ax->histogram(create_data().x(-1.f, 1.f).y(heights), Transform(Identity()));
+  ax->update_view();
+  DummyDraw::draw("histogram", fig);
+}
+
+TEST_CASE("histogram frames added in a batch", "[histogram]") {
+  const int n = 1000;
+  const int number_of_frames = 200;
+  std::default_random_engine gen;
+  std::vector<std::pair<DataWithAesthetic, float>> frames;
+  for (int f = 0; f < number_of_frames; ++f) {
+    std::normal_distribution<float> normal(f / 50.f, 1);
+    std::vector<float> x(n);
+    std::generate(x.begin(), x.end(), [&]() { return normal(gen); });
+    frames.emplace_back(create_data().x(x), 0.1f * (f + 1));
+  }
+
+  // batched frames give the same result as adding them one at a time
+  auto accumulator = std::make_shared<HistogramAccumulator>(12, -4.f, 8.f);
+  auto batched_accumulator =
+      std::make_shared<HistogramAccumulator>(12, -4.f, 8.f);
+  for (const auto &transform :
+       {std::make_pair(Transform(BinX(20)), Transform(BinX(20))),
+        std::make_pair(Transform(AccumulateBinX(accumulator)),
+                       Transform(AccumulateBinX(batched_accumulator)))}) {
+    auto fig = figure();
+    auto ax = fig->axis();
+    auto batched_ax = fig->axis();
+    auto one_at_a_time = ax->histogram(frames[0].first, transform.first);
+    auto batched = batched_ax->histogram(frames[0].first, transform.second);
+    for (int f = 1; f < number_of_frames; ++f) {
+      one_at_a_time->add_frame(frames[f].first, frames[f].second);
+    }
+    batched->add_frames(std::vector<std::pair<DataWithAesthetic, float>>(
+        frames.begin() + 1, frames.end()));
+
+    REQUIRE(batched->data_size() == one_at_a_time->data_size());
+    for (std::size_t f = 0; f < batched->data_size(); ++f) {
+      CHECK(batched->get_time(f) == one_at_a_time->get_time(f));
+      const auto &expected = one_at_a_time->get_data(f);
+      const auto &actual = batched->get_data(f);
+      REQUIRE(actual.rows() == expected.rows());
+      CHECK(std::equal(expected.begin<Aesthetic::y>(),
+                       expected.end<Aesthetic::y>(),
+                       actual.begin<Aesthetic::y>()));
+    }
+    CHECK((batched_ax->limits().bmin == ax->limits().bmin).all());
+    CHECK((batched_ax->limits().bmax == ax->limits().bmax).all());
+  }
+  CHECK(Transform(BinX(20)).is_concurrent());
+  CHECK(!Transform(AccumulateBinX(accumulator)).is_concurrent());
+
+  // frames out of order are rejected before any are added
+  auto fig = figure();
+  auto hist = fig->axis()->histogram(frames[0].first);
+  std::swap(frames[10], frames[20]);
+  CHECK_THROWS_AS(hist->add_frames(frames), Exception);
+  CHECK(hist->data_size() == 1);
+}
@@ -0,0 +1,1104 @@
+/*
+Copyright (c) 2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of the Oxford RSE C++ Template project.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "trase.hpp"
+#include "util/FFT.hpp"
+
+using namespace trase;
+
+TEST_CASE("parallel blocks cover the range", "[transform]") {
+  const int n = 1000;
+  std::vector<int> visited(n, 0);
+  std::vector<int> blocks(parallel_blocks(n, 64), 0);
+  parallel_for_blocks(n, 64,
+                      [&](const int thread, const int block, const int begin,
+                          const int end) {
+                        CHECK(thread < parallel_threads(blocks.size()));
+                        ++blocks[block];
+                        for (int i = begin; i < end; ++i) {
+                          ++visited[i];
+                        }
+                      });
+  CHECK(std::all_of(visited.begin(), visited.end(),
+                    [](int i) { return i == 1; }));
+  CHECK(std::all_of(blocks.begin(), blocks.end(),
+                    [](int i) { return i == 1; }));
+
+  CHECK_THROWS_AS(parallel_for_blocks(n, 64,
+                                      [](const int, const int block,
+                                         const int, const int) {
+                                        if (block == 3) {
+                                          throw Exception("block failed");
+                                        }
+                                      }),
+                  Exception);
+}
+
+TEST_CASE("parallel sort", "[transform]") {
+  const int n = 500001;
+  std::vector<float> x(n);
+  std::default_random_engine gen(7);
+  std::uniform_real_distribution<float> uniform(0, 100);
+  std::generate(x.begin(), x.end(), [&]() { return uniform(gen); });
+  auto expected = x;
+  std::sort(expected.begin(), expected.end());
+  for (const int threads : {1, 3, 8}) {
+    set_num_threads(threads);
+    auto sorted = x;
+    parallel_sort(sorted.begin(), sorted.end());
+    CHECK(sorted == expected);
+    parallel_sort(sorted.begin(), sorted.end(), std::greater<float>());
+    CHECK(std::is_sorted(sorted.rbegin(), sorted.rend()));
+  }
+  set_num_threads(0);
+}
+
+TEST_CASE("bin x is independent of the number of threads", "[transform]") {
+  const int n = 300000;
+  std::vector<float> x(n);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  std::generate(x.begin(), x.end(), [&]() { return normal(gen); });
+
+  auto bin = [&](const int threads) {
+    set_num_threads(threads);
+    BinX transform;
+    auto result = transform(create_data().x(x));
+    set_num_threads(0);
+    return std::vector<float>(result.begin<Aesthetic::y>(),
+                              result.end<Aesthetic::y>());
+  };
+
+  const auto serial = bin(1);
+  REQUIRE(serial.size() > 1);
+  CHECK(std::accumulate(serial.begin(), serial.end(), 0.f) == n);
+  CHECK(bin(3) == serial);
+  CHECK(bin(8) == serial);
+
+  // missing values are not binned
+  for (int i = 0; i < n; i += 7) {
+    x[i] = std::numeric_limits<float>::quiet_NaN();
+  }
+  const auto serial_missing = bin(1);
+  CHECK(std::accumulate(serial_missing.begin(), serial_missing.end(), 0.f) ==
+        n - (n + 6) / 7);
+  CHECK(bin(5) == serial_missing);
+}
+
+TEST_CASE("bin x with fixed span", "[transform]") {
+  std::vector<float> x = {0.1f, 0.2f, 1.5f, 2.9f, -1.f, 3.f};
+  BinX transform(3, 0.f, 3.f);
+  auto result = transform(create_data().x(x));
+  std::vector<float> y(result.begin<Aesthetic::y>(),
+                       result.end<Aesthetic::y>());
+  CHECK(y == std::vector<float>({2.f, 1.f, 1.f}));
+}
+
+TEST_CASE("histogram accumulator", "[transform]") {
+  HistogramAccumulator accumulator(4, 0.f, 4.f);
+  accumulator.add(std::vector<float>({0.5f, 1.5f, 1.5f, 10.f}));
+  accumulator.add(create_data().x(std::vector<float>(
+      {3.5f, std::numeric_limits<float>::quiet_NaN()})));
+  CHECK(accumulator.counts() == std::vector<double>({1, 2, 0, 1}));
+
+  HistogramAccumulator other(4, 0.f, 4.f);
+  other.add(std::vector<float>({2.5f}));
+  accumulator.merge(other);
+  CHECK(accumulator.counts() == std::vector<double>({1, 2, 1, 1}));
+
+  HistogramAccumulator different(4, 0.f, 5.f);
+  CHECK_THROWS_AS(accumulator.merge(different), Exception);
+
+  auto data = accumulator.snapshot();
+  CHECK(data.rows() == 4);
+  CHECK(data.limits().bmin[Aesthetic::x::index] == 0.f);
+  CHECK(data.limits().bmax[Aesthetic::x::index] == 4.f);
+  CHECK(data.limits().bmax[Aesthetic::y::index] == 2.f);
+
+  SECTION("sliding window") {
+    HistogramAccumulator window(2, 0.f, 2.f);
+    window.set_window(2);
+    window.add(std::vector<float>({0.5f}));
+    window.add(std::vector<float>({1.5f}));
+    window.add(std::vector<float>({1.5f}));
+    CHECK(window.counts() == std::vector<double>({0, 2}));
+  }
+
+  SECTION("exponential decay") {
+    HistogramAccumulator decay(2, 0.f, 2.f);
+    decay.set_decay(0.5f);
+    decay.add(std::vector<float>({0.5f, 0.5f}));
+    decay.add(std::vector<float>({1.5f}));
+    CHECK(decay.counts() == std::vector<double>({1, 1}));
+  }
+}
+
+TEST_CASE("accumulated histogram frames", "[transform]") {
+  auto fig = figure();
+  auto ax = fig->axis();
+  auto accumulator = std::make_shared<HistogramAccumulator>(10, -3.f, 3.f);
+  auto hist = ax->histogram(create_data().x(std::vector<float>()),
+                            Transform(AccumulateBinX(accumulator)));
+
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  std::vector<float> chunk(100);
+  for (int i = 1; i <= 5; ++i) {
+    std::generate(chunk.begin(), chunk.end(), [&]() { return normal(gen); });
+    hist->add_frame(create_data().x(chunk), static_cast<float>(i));
+  }
+
+  REQUIRE(hist->data_size() == 6);
+  const auto &last = hist->get_data(5);
+  CHECK(last.rows() == 10);
+  const float total = std::accumulate(last.begin<Aesthetic::y>(),
+                                      last.end<Aesthetic::y>(), 0.f);
+  CHECK(total <= 500.f);
+  CHECK(total > 490.f);
+}
+
+TEST_CASE("fft", "[transform]") {
+  std::vector<std::complex<double>> a(7);
+  CHECK_THROWS_AS(fft(a), Exception);
+
+  // compare against the direct transform
+  const int n = 16;
+  std::vector<std::complex<double>> x(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = {std::sin(0.3 * i) + i, 0.1 * i};
+  }
+  auto y = x;
+  fft(y);
+  const double pi = 3.14159265358979323846;
+  for (int k = 0; k < n; ++k) {
+    std::complex<double> sum = 0;
+    for (int i = 0; i < n; ++i) {
+      sum += x[i] * std::polar(1.0, -2 * pi * i * k / n);
+    }
+    CHECK(std::abs(y[k] - sum) < 1e-9);
+  }
+
+  fft(y, true);
+  for (int i = 0; i < n; ++i) {
+    CHECK(std::abs(y[i] - x[i]) < 1e-12);
+  }
+}
+
+TEST_CASE("kernel density estimate", "[transform]") {
+  std::vector<float> x = {-1.f, 0.f, 0.5f, 2.f, 2.1f, 4.f};
+  const float h = 0.7f;
+  auto data = create_data().x(x);
+  auto kde = KDE(1000, h)(data);
+  auto grid = kde.begin<Aesthetic::x>();
+  auto density = kde.begin<Aesthetic::y>();
+
+  // grid size is rounded up to a power of two
+  REQUIRE(kde.rows() == 1024);
+  CHECK(kde.limits().bmin[Aesthetic::y::index] == 0.f);
+
+  // compare against the direct sum over the samples
+  const double pi = 3.14159265358979323846;
+  double integral = 0;
+  for (int j = 0; j < kde.rows(); ++j) {
+    double expected = 0;
+    for (float xi : x) {
+      const double u = (grid[j] - xi) / h;
+      expected += std::exp(-0.5 * u * u) / (h * std::sqrt(2 * pi));
+    }
+    expected /= x.size();
+    CHECK(density[j] == Approx(expected).margin(1e-3));
+    if (j > 0) {
+      integral += density[j] * (grid[j] - grid[j - 1]);
+    }
+  }
+  CHECK(integral == Approx(1.0).epsilon(0.01));
+
+  // missing values are skipped, and the bandwidth is chosen automatically
+  x.push_back(std::numeric_limits<float>::quiet_NaN());
+  auto auto_kde = KDE(64)(create_data().x(x));
+  CHECK(auto_kde.rows() == 64);
+  CHECK(std::none_of(auto_kde.begin<Aesthetic::y>(),
+                     auto_kde.end<Aesthetic::y>(),
+                     [](float y) { return std::isnan(y); }));
+
+  // the automatic bandwidth is not inflated by an outlier, as the
+  // interquartile range is used when it is smaller than the standard deviation
+  std::vector<float> outlier(99);
+  std::iota(outlier.begin(), outlier.end(), 0.f);
+  outlier.push_back(1e4f);
+  auto outlier_kde = KDE(64)(create_data().x(outlier));
+  const float span = outlier_kde.limits().bmax[Aesthetic::x::index] -
+                     outlier_kde.limits().bmin[Aesthetic::x::index];
+  const float bandwidth = (span - 1e4f) / 6;
+  CHECK(bandwidth == Approx(0.9 * 50 / 1.34 * std::pow(100, -0.2))
+                         .epsilon(0.05));
+
+  // identical samples still give a finite density
+  std::vector<float> same(10, 3.f);
+  auto same_kde = KDE(64)(create_data().x(same));
+  CHECK(std::isfinite(same_kde.limits().bmax[Aesthetic::y::index]));
+
+  std::vector<float> empty;
+  CHECK(KDE()(create_data().x(empty)).rows() == 0);
+}
+
+TEST_CASE("loess smoothing", "[transform]") {
+  // a straight line is reproduced exactly by the local linear fits
+  const int n = 100000;
+  std::vector<float> x(n);
+  std::vector<float> line(n);
+  std::vector<float> noisy(n);
+  std::default_random_engine gen(3);
+  std::normal_distribution<float> noise(0.f, 0.2f);
+  for (int i = 0; i < n; ++i) {
+    x[i] = 10.f * i / (n - 1);
+    line[i] = 2.f * x[i] + 1.f;
+    noisy[i] = std::sin(x[i]) + noise(gen);
+  }
+  auto fit = Loess(50, 0.2f)(create_data().x(x).y(line));
+  REQUIRE(fit.rows() == 50);
+  auto grid = fit.begin<Aesthetic::x>();
+  auto y = fit.begin<Aesthetic::y>();
+  CHECK(grid[0] == 0.f);
+  CHECK(grid[49] == Approx(10.f));
+  for (int j = 0; j < fit.rows(); ++j) {
+    CHECK(y[j] == Approx(2.f * grid[j] + 1.f).margin(1e-3));
+  }
+
+  // the noise is smoothed away, leaving the underlying curve
+  auto smooth = Loess(100, 0.05f)(create_data().x(x).y(noisy));
+  REQUIRE(smooth.rows() == 100);
+  grid = smooth.begin<Aesthetic::x>();
+  y = smooth.begin<Aesthetic::y>();
+  for (int j = 0; j < smooth.rows(); ++j) {
+    CHECK(y[j] == Approx(std::sin(grid[j])).margin(0.05));
+  }
+
+  // missing values are skipped, and the fit can be drawn as a line
+  x.push_back(std::numeric_limits<float>::quiet_NaN());
+  line.push_back(1.f);
+  auto fig = figure();
+  auto ax = fig->axis();
+  auto smoothed = ax->line(create_data().x(x).y(line), Transform(Loess()));
+  CHECK(smoothed->get_data(0).rows() == 256);
+  CHECK(std::none_of(smoothed->get_data(0).begin<Aesthetic::y>(),
+                     smoothed->get_data(0).end<Aesthetic::y>(),
+                     [](float y) { return std::isnan(y); }));
+
+  std::vector<float> empty;
+  CHECK(Loess()(create_data().x(empty).y(empty)).rows() == 0);
+  CHECK_THROWS_AS(Loess(10, 0.f), Exception);
+}
+
+TEST_CASE("empirical cumulative distribution", "[transform]") {
+  // few samples give the exact steps
+  std::vector<float> x = {3.f, 1.f, std::numeric_limits<float>::quiet_NaN(),
+                          2.f, 2.f};
+  auto ecdf = ECDF()(create_data().x(x));
+  const std::vector<float> exact_x = {1.f, 1.f, 2.f, 2.f, 3.f, 3.f};
+  const std::vector<float> exact_y = {0.f, 0.25f, 0.25f, 0.75f, 0.75f, 1.f};
+  CHECK(std::vector<float>(ecdf.begin<Aesthetic::x>(),
+                           ecdf.end<Aesthetic::x>()) == exact_x);
+  CHECK(std::vector<float>(ecdf.begin<Aesthetic::y>(),
+                           ecdf.end<Aesthetic::y>()) == exact_y);
+  CHECK(ecdf.limits().bmin[Aesthetic::y::index] == 0.f);
+  auto fig = figure();
+  auto line = fig->axis()->line(create_data().x(x), Transform(ECDF()));
+  CHECK(line->get_data(0).rows() == 6);
+
+  // weighted samples
+  std::vector<float> w = {3.f, 1.f, 1.f, 0.f, 0.f};
+  auto weighted =
+      ECDF().weight<Aesthetic::size>()(create_data().x(x).size(w));
+  const std::vector<float> weighted_y = {0.f, 0.25f, 0.25f, 0.25f, 0.25f, 1.f};
+  CHECK(std::vector<float>(weighted.begin<Aesthetic::y>(),
+                           weighted.end<Aesthetic::y>()) == weighted_y);
+  w[0] = -1.f;
+  CHECK_THROWS_AS(
+      ECDF().weight<Aesthetic::size>()(create_data().x(x).size(w)), Exception);
+
+  // many samples give at most the requested number of points, each step
+  // rising to the exact fraction of samples
+  const int n = 300000;
+  std::vector<float> samples(n);
+  std::default_random_engine gen(11);
+  std::exponential_distribution<float> exponential(1.f);
+  std::generate(samples.begin(), samples.end(),
+                [&]() { return std::round(100.f * exponential(gen)); });
+  auto sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+  auto big = ECDF(400)(create_data().x(samples));
+  REQUIRE(big.rows() <= 400);
+  REQUIRE(big.rows() > 100);
+  auto step_x = big.begin<Aesthetic::x>();
+  auto step_y = big.begin<Aesthetic::y>();
+  for (int i = 1; i < big.rows(); i += 2) {
+    const auto below = std::upper_bound(sorted.begin(), sorted.end(),
+                                        step_x[i]) -
+                       sorted.begin();
+    CHECK(step_y[i] == Approx(static_cast<double>(below) / n));
+    CHECK(step_y[i - 1] <= step_y[i]);
+  }
+  CHECK(step_y[big.rows() - 1] == 1.f);
+
+  // facets are transformed together, matching the separate transforms
+  std::vector<DataWithAesthetic> facets;
+  for (int i = 0; i < 2 * get_num_threads(); ++i) {
+    facets.push_back(create_data().x(
+        std::vector<float>(samples.begin() + i, samples.begin() + i + 1000)));
+  }
+  auto together = ECDF(400)(facets);
+  REQUIRE(together.size() == facets.size());
+  for (std::size_t i = 0; i < facets.size(); ++i) {
+    auto separate = ECDF(400)(facets[i]);
+    REQUIRE(together[i].rows() == separate.rows());
+    CHECK(std::equal(separate.begin<Aesthetic::y>(),
+                     separate.end<Aesthetic::y>(),
+                     together[i].begin<Aesthetic::y>()));
+  }
+}
+
+TEST_CASE("contour lines", "[transform]") {
+  // a circular field, large enough that the contours cross several bands
+  const int n = 201;
+  std::vector<float> value(n * n);
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      const float x = -1.f + 2.f * i / (n - 1);
+      const float y = -1.f + 2.f * j / (n - 1);
+      value[j * n + i] = x * x + y * y;
+    }
+  }
+  const bfloat2_t span({-1.f, -1.f}, {1.f, 1.f});
+  auto data = create_data().fill(value);
+  Contour contour({0.25f, 0.64f}, n, n, span);
+  auto levels = contour.lines(data);
+  REQUIRE(levels.size() == 2);
+  const float radius[2] = {0.5f, 0.8f};
+  for (int level = 0; level < 2; ++level) {
+    // a single closed line
+    const auto &line = levels[level];
+    auto x = line.begin<Aesthetic::x>();
+    auto y = line.begin<Aesthetic::y>();
+    REQUIRE(line.rows() > 100);
+    CHECK(line.valid<Aesthetic::x>().all_valid());
+    CHECK(x[0] == x[line.rows() - 1]);
+    CHECK(y[0] == y[line.rows() - 1]);
+    for (int i = 0; i < line.rows(); ++i) {
+      CHECK(std::sqrt(x[i] * x[i] + y[i] * y[i]) ==
+            Approx(radius[level]).margin(2e-3));
+    }
+  }
+
+  // simplifying to a tolerance keeps the points within the tolerance
+  auto simplified = Contour({0.25f}, n, n, span).tolerance(0.01f, 0.01f);
+  auto coarse = simplified.lines(data)[0];
+  CHECK(coarse.rows() < levels[0].rows() / 4);
+  CHECK(coarse.rows() > 8);
+  for (int i = 0; i < coarse.rows(); ++i) {
+    const float x = coarse.begin<Aesthetic::x>()[i];
+    const float y = coarse.begin<Aesthetic::y>()[i];
+    CHECK(std::sqrt(x * x + y * y) == Approx(0.5f).margin(2e-3));
+  }
+
+  // missing values open the line, and all the levels are given together
+  value[(n / 2) * n + n / 2 + 50] = std::numeric_limits<float>::quiet_NaN();
+  auto open = Contour({0.25f}, n, n, span)(create_data().fill(value));
+  auto x = open.begin<Aesthetic::x>();
+  auto y = open.begin<Aesthetic::y>();
+  CHECK(open.valid<Aesthetic::x>().all_valid());
+  CHECK(std::hypot(x[0] - x[open.rows() - 1], y[0] - y[open.rows() - 1]) >
+        0.005f);
+  auto both = contour(create_data().fill(value));
+  CHECK(both.rows() == open.rows() + levels[1].rows() + 1);
+
+  // contours of binned points
+  std::vector<float> px(20000);
+  std::vector<float> py(20000);
+  std::default_random_engine gen(5);
+  std::normal_distribution<float> normal;
+  std::generate(px.begin(), px.end(), [&]() { return normal(gen); });
+  std::generate(py.begin(), py.end(), [&]() { return normal(gen); });
+  auto bins = BinXY(30, 30)(create_data().x(px).y(py));
+  auto density = Contour(3).lines(bins);
+  REQUIRE(density.size() == 3);
+  for (const auto &line : density) {
+    CHECK(line.rows() > 0);
+  }
+
+  CHECK_THROWS_AS(Contour({0.f}, n, n, span)(create_data().fill(px)),
+                  Exception);
+}
+
+TEST_CASE("random sample of rows", "[transform]") {
+  const int n = 1000000;
+  std::vector<float> x(n);
+  std::vector<float> category(n, 0.f);
+  std::iota(x.begin(), x.end(), 0.f);
+  for (int i = 0; i < n; i += 100) {
+    category[i] = 1.f;
+  }
+  for (int i = 0; i < 50; ++i) {
+    category[1 + 7 * i] = std::numeric_limits<float>::quiet_NaN();
+  }
+  auto data = create_data().x(x).y(x).color(category);
+
+  // reproducible for any number of threads, and different for each seed
+  auto sample = [&](const int threads, const std::uint64_t seed) {
+    set_num_threads(threads);
+    auto rows = Sample(1000, seed).rows(data);
+    set_num_threads(0);
+    return rows;
+  };
+  const auto rows = sample(1, 42);
+  REQUIRE(rows.size() == 1000);
+  CHECK(std::is_sorted(rows.begin(), rows.end()));
+  CHECK(std::adjacent_find(rows.begin(), rows.end()) == rows.end());
+  CHECK(sample(3, 42) == rows);
+  CHECK(sample(8, 42) == rows);
+  CHECK(sample(8, 43) != rows);
+  const double mean =
+      std::accumulate(rows.begin(), rows.end(), 0.0) / rows.size();
+  CHECK(mean == Approx(n / 2.0).epsilon(0.05));
+
+  // the output holds the sampled rows of each aesthetic in order
+  auto out = Sample(1000, 42)(data);
+  REQUIRE(out.rows() == 1000);
+  for (int i = 0; i < out.rows(); ++i) {
+    CHECK(out.begin<Aesthetic::x>()[i] == rows[i]);
+    CHECK(out.begin<Aesthetic::y>()[i] == rows[i]);
+  }
+  CHECK(Sample(n)(data).rows() == n);
+
+  // stratified samples keep the rare strata
+  auto stratified = Sample(300, 42).stratify<Aesthetic::color>()(data);
+  REQUIRE(stratified.rows() == 300);
+  int common = 0;
+  int rare = 0;
+  int missing = 0;
+  for (int i = 0; i < stratified.rows(); ++i) {
+    const float c = stratified.begin<Aesthetic::color>()[i];
+    common += c == 0.f;
+    rare += c == 1.f;
+    missing += std::isnan(c);
+  }
+  CHECK(missing == 50);
+  CHECK(rare == 125);
+  CHECK(common == 125);
+
+  // with more strata than rows in the sample, the smallest strata get a row
+  // each. Stratum k holds the 2^k rows starting at row 2^k - 1
+  std::vector<float> level(n);
+  for (int i = 0; i < n; ++i) {
+    level[i] = std::floor(std::log2(i + 1.f));
+  }
+  auto levels = create_data().x(x).color(level);
+  auto sample_levels = [&](const int threads) {
+    set_num_threads(threads);
+    auto rows = Sample(5, 42).stratify<Aesthetic::color>().rows(levels);
+    set_num_threads(0);
+    return rows;
+  };
+  const auto level_rows = sample_levels(1);
+  REQUIRE(level_rows.size() == 5);
+  for (int k = 0; k < 5; ++k) {
+    CHECK(level[level_rows[k]] == k);
+  }
+  CHECK(sample_levels(8) == level_rows);
+
+  // can be used to draw a preview
+  auto fig = figure();
+  auto points = fig->axis()->points(data, Transform(Sample(500)));
+  CHECK(points->get_data(0).rows() == 500);
+}
+
+TEST_CASE("rolling window statistics", "[transform]") {
+  // long enough to span several parallel blocks
+  const int n = 140000;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(5, 2);
+  for (int i = 0; i < n; ++i) {
+    x[i] = 0.1f * i;
+    y[i] = normal(gen);
+  }
+  y[10] = std::numeric_limits<float>::quiet_NaN();
+  auto data = create_data().x(x).y(y);
+  x.erase(x.begin() + 10);
+  y.erase(y.begin() + 10);
+
+  using Statistic = Rolling::Statistic;
+  using Window = Rolling::Window;
+  for (auto window : {Window::rows, Window::span}) {
+    for (auto statistic : {Statistic::mean, Statistic::sum, Statistic::min,
+                           Statistic::max, Statistic::stdev}) {
+      const float size = window == Window::rows ? 37.f : 2.45f;
+      auto rolled = Rolling(statistic, window, size)(data);
+      REQUIRE(rolled.rows() == static_cast<int>(x.size()));
+      auto out_x = rolled.begin<Aesthetic::x>();
+      auto out_y = rolled.begin<Aesthetic::y>();
+      for (int i = 0; i < static_cast<int>(x.size()); i += 97) {
+        int lo = i;
+        while (lo > 0 && (window == Window::rows ? i - lo + 1 < 37
+                                                 : x[lo - 1] > x[i] - size)) {
+          --lo;
+        }
+        double sum = 0;
+        double sq_sum = 0;
+        float min = y[lo];
+        float max = y[lo];
+        for (int j = lo; j <= i; ++j) {
+          sum += y[j];
+          sq_sum += static_cast<double>(y[j]) * y[j];
+          min = std::min(min, y[j]);
+          max = std::max(max, y[j]);
+        }
+        const int count = i - lo + 1;
+        double expected = 0;
+        switch (statistic) {
+        case Statistic::mean:
+          expected = sum / count;
+          break;
+        case Statistic::sum:
+          expected = sum;
+          break;
+        case Statistic::min:
+          expected = min;
+          break;
+        case Statistic::max:
+          expected = max;
+          break;
+        case Statistic::stdev:
+          expected = count > 1 ? std::sqrt((sq_sum - sum * sum / count) /
+                                           (count - 1))
+                               : 0.0;
+          break;
+        }
+        CHECK(out_x[i] == x[i]);
+        CHECK(out_y[i] == Approx(expected).epsilon(1e-4));
+      }
+    }
+  }
+
+  std::vector<float> unsorted = {1.f, 0.f};
+  CHECK_THROWS_AS(Rolling(Statistic::mean, Window::span, 1.f)(
+                      create_data().x(unsorted).y(unsorted)),
+                  Exception);
+  CHECK_NOTHROW(Rolling(Statistic::mean, Window::rows, 1.f)(
+      create_data().x(unsorted).y(unsorted)));
+  CHECK_THROWS_AS(Rolling(Statistic::mean, Window::rows, 0.f), Exception);
+}
+
+TEST_CASE("group by", "[transform]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> key = {3.f, 1.f, 3.f, -0.f, 0.f, 1.f, nan, 3.f};
+  std::vector<float> value = {1.f, 2.f, 3.f, 4.f, 5.f, nan, 7.f, 8.f};
+  auto data = create_data().x(key).y(value);
+
+  auto count = GroupBy(0.5f)(data);
+  REQUIRE(count.rows() == 3);
+  auto x = count.begin<Aesthetic::x>();
+  auto y = count.begin<Aesthetic::y>();
+  CHECK(x[0] == 0.f);
+  CHECK(x[1] == 1.f);
+  CHECK(x[2] == 3.f);
+  CHECK(y[0] == 2.f);
+  CHECK(y[1] == 2.f);
+  CHECK(y[2] == 3.f);
+  CHECK(count.begin<Aesthetic::xmin>()[2] == 2.75f);
+  CHECK(count.begin<Aesthetic::xmax>()[2] == 3.25f);
+  CHECK(count.begin<Aesthetic::ymin>()[2] == 0.f);
+  CHECK(count.begin<Aesthetic::ymax>()[2] == 3.f);
+
+  // missing values are skipped
+  auto groups = GroupBy().mean<Aesthetic::y>().aggregate(data);
+  REQUIRE(groups.size() == 3);
+  CHECK(groups[1].count == 1);
+  CHECK(groups[2].sum == 12.0);
+  CHECK(groups[2].min == 1.f);
+  CHECK(groups[2].max == 8.f);
+  CHECK(GroupBy().mean<Aesthetic::y>()(data).begin<Aesthetic::y>()[2] ==
+        4.f);
+  CHECK(GroupBy().sum<Aesthetic::y>()(data).begin<Aesthetic::y>()[0] == 9.f);
+  CHECK(GroupBy().min<Aesthetic::y>()(data).begin<Aesthetic::y>()[0] == 4.f);
+  CHECK(GroupBy().max<Aesthetic::y>()(data).begin<Aesthetic::y>()[0] == 5.f);
+
+  // dictionary encoded string keys
+  std::vector<std::string> names = {"b", "a", "c", "a", "b", "a"};
+  auto name_count = GroupBy()(create_data().x(names));
+  REQUIRE(name_count.rows() == 3);
+  CHECK(name_count.begin<Aesthetic::y>()[0] == 3.f);
+  CHECK(name_count.begin<Aesthetic::y>()[1] == 2.f);
+  CHECK(name_count.begin<Aesthetic::y>()[2] == 1.f);
+
+  // many keys, spanning several parallel blocks and growing the tables
+  const int n = 200000;
+  std::vector<int> many(n);
+  for (int i = 0; i < n; ++i) {
+    many[i] = (i * 7919) % 50000;
+  }
+  auto many_count = GroupBy()(create_data().x(many));
+  REQUIRE(many_count.rows() == 50000);
+  CHECK(std::all_of(many_count.begin<Aesthetic::y>(),
+                    many_count.end<Aesthetic::y>(),
+                    [](float y) { return y == 4.f; }));
+  CHECK(std::is_sorted(many_count.begin<Aesthetic::x>(),
+                       many_count.end<Aesthetic::x>()));
+}
+
+TEST_CASE("histogram index", "[transform]") {
+  const int n = 100000;
+  std::vector<float> x(n);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  std::generate(x.begin(), x.end(), [&]() { return normal(gen); });
+  x[7] = std::numeric_limits<float>::quiet_NaN();
+
+  // the counts from the index are identical to binning the samples, for any
+  // number of bins and range
+  auto data = create_data().x(x);
+  for (int bins : {1, 7, 50, 333}) {
+    for (float min : {-5.f, -1.3f, 0.f}) {
+      for (float max : {0.5f, 2.f, 5.f}) {
+        if (max <= min) {
+          continue;
+        }
+        auto binned = BinX(bins, min, max)(data);
+        auto counts = HistogramIndex(data.begin<Aesthetic::x>(),
+                                     data.end<Aesthetic::x>(),
+                                     data.valid<Aesthetic::x>())
+                          .counts(bins, min, max);
+        REQUIRE(static_cast<int>(counts.size()) == bins);
+        CHECK(std::equal(counts.begin(), counts.end(),
+                         binned.begin<Aesthetic::y>()));
+      }
+    }
+  }
+
+  // BinX counts from the index once it has been built
+  auto index = data.histogram_index<Aesthetic::x>();
+  CHECK(index->size() == n - 1);
+  CHECK(data.has_histogram_index<Aesthetic::x>());
+  auto binned = BinX(10, -2.f, 2.f)(data);
+  auto counts = index->counts(10, -2.f, 2.f);
+  CHECK(std::equal(counts.begin(), counts.end(), binned.begin<Aesthetic::y>()));
+}
+
+TEST_CASE("transform cache", "[transform]") {
+  auto &cache = TransformCache::global();
+  cache.clear();
+
+  std::vector<float> x = {1.f, 2.f, 2.5f, 4.f};
+  std::vector<float> x2 = {1.f, 2.f, 2.5f, 5.f};
+  Transform bin(BinX(3));
+  auto first = bin(create_data().x(x));
+  CHECK(cache.misses() == 1);
+  CHECK(cache.hits() == 0);
+
+  // identical data in a different data set, and an identical transform
+  Transform other_bin(BinX(3));
+  auto second = other_bin(create_data().x(x));
+  CHECK(cache.hits() == 1);
+  CHECK(second.rows() == first.rows());
+  CHECK(std::equal(first.begin<Aesthetic::y>(), first.end<Aesthetic::y>(),
+                   second.begin<Aesthetic::y>()));
+
+  // the state of the transform (the span fixed on the first frame) is
+  // restored from the cache
+  auto third = other_bin(create_data().x(x2));
+  CHECK(cache.misses() == 2);
+  CHECK(third.limits().bmax[Aesthetic::x::index] ==
+        first.limits().bmax[Aesthetic::x::index]);
+
+  // different parameters or aesthetics are different keys
+  Transform(BinX(4))(create_data().x(x));
+  Transform(BinX(3))(create_data().x(x).y(x));
+  CHECK(cache.misses() == 4);
+  CHECK(cache.entries() == 4);
+
+  // transforms without a cache key are not cached
+  Transform identity{Identity()};
+  identity(create_data().x(x));
+  CHECK(cache.misses() == 4);
+
+  // results served from the cache do not share their columns, so modifying
+  // one does not change another user of the same key
+  const std::vector<float> bins(first.begin<Aesthetic::y>(),
+                                first.end<Aesthetic::y>());
+  first.set<Aesthetic::y>(std::vector<float>(first.rows(), -1.f));
+  auto fourth = Transform(BinX(3))(create_data().x(x));
+  CHECK(cache.misses() == 4);
+  CHECK(std::equal(bins.begin(), bins.end(), second.begin<Aesthetic::y>()));
+  CHECK(std::equal(bins.begin(), bins.end(), fourth.begin<Aesthetic::y>()));
+  fourth.set<Aesthetic::y>(std::vector<float>(fourth.rows(), -2.f));
+  CHECK(std::equal(bins.begin(), bins.end(), second.begin<Aesthetic::y>()));
+
+  // string data with the same codes but different labels are different keys
+  const std::vector<std::string> labels = {"a", "b", "b", "c"};
+  const std::vector<std::string> other_labels = {"d", "e", "e", "f"};
+  CHECK(create_data().x(labels).content_hash() !=
+        create_data().x(other_labels).content_hash());
+
+  // the size of an entry includes the cached indices of its result
+  auto indexed = create_data().x(x);
+  const std::size_t unindexed_size = indexed.memory_usage();
+  CHECK(unindexed_size > sizeof(float) * x.size());
+  indexed.histogram_index<Aesthetic::x>();
+  CHECK(indexed.memory_usage() >= unindexed_size + sizeof(float) * x.size());
+
+  // least recently used entries are discarded to stay within capacity
+  const std::size_t size = cache.size();
+  cache.set_capacity(size - 1);
+  CHECK(cache.entries() < 4);
+  CHECK(cache.size() < size);
+  cache.set_capacity(0);
+  CHECK(cache.entries() == 0);
+  Transform(BinX(3))(create_data().x(x));
+  CHECK(cache.misses() == 4);
+
+  cache.set_capacity(TransformCache::default_capacity);
+  cache.clear();
+}
+
+TEST_CASE("largest triangle three buckets", "[transform]") {
+  // random walk
+  const int n = 20000;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  float walk = 0;
+  for (int i = 0; i < n; ++i) {
+    x[i] = 0.01f * i;
+    walk += normal(gen);
+    y[i] = walk;
+  }
+
+  // compare against a direct implementation
+  const int target = 500;
+  std::vector<int> expected = {0};
+  const double every = static_cast<double>(n - 2) / (target - 2);
+  for (int b = 0; b < target - 2; ++b) {
+    const int begin = 1 + static_cast<int>(b * every);
+    const int end =
+        b == target - 3 ? n - 1 : 1 + static_cast<int>((b + 1) * every);
+    double cx = x[n - 1];
+    double cy = y[n - 1];
+    if (b < target - 3) {
+      const int next_end =
+          b + 1 == target - 3 ? n - 1 : 1 + static_cast<int>((b + 2) * every);
+      cx = cy = 0;
+      for (int i = end; i < next_end; ++i) {
+        cx += x[i];
+        cy += y[i];
+      }
+      cx /= next_end - end;
+      cy /= next_end - end;
+    }
+    const int a = expected.back();
+    int best = begin;
+    double best_area = -1;
+    for (int i = begin; i < end; ++i) {
+      const double area = std::abs((x[a] - cx) * (y[i] - y[a]) -
+                                   (x[a] - x[i]) * (cy - y[a]));
+      if (area > best_area) {
+        best_area = area;
+        best = i;
+      }
+    }
+    expected.push_back(best);
+  }
+  expected.push_back(n - 1);
+
+  auto down = LTTB(target)(create_data().x(x).y(y));
+  REQUIRE(down.rows() == target);
+  for (int i = 0; i < target; ++i) {
+    CHECK(down.begin<Aesthetic::x>()[i] == x[expected[i]]);
+    CHECK(down.begin<Aesthetic::y>()[i] == y[expected[i]]);
+  }
+
+  // gaps are kept, with the first and last point of each run
+  y[n / 2] = std::numeric_limits<float>::quiet_NaN();
+  auto gapped = LTTB(target)(create_data().x(x).y(y));
+  auto gapped_x = gapped.begin<Aesthetic::x>();
+  CHECK(gapped.rows() <= target + 1);
+  CHECK(gapped_x[0] == x[0]);
+  CHECK(gapped_x[gapped.rows() - 1] == x[n - 1]);
+  const auto &valid = gapped.valid<Aesthetic::y>();
+  REQUIRE(valid.null_count() == 1);
+  int gap = 0;
+  while (valid.test(gap)) {
+    ++gap;
+  }
+  CHECK(gapped_x[gap - 1] == x[n / 2 - 1]);
+  CHECK(gapped_x[gap + 1] == x[n / 2 + 1]);
+  CHECK(gapped.rows() <= target);
+
+  // with gaps every few rows the target is still a bound. Runs are given
+  // their share of the target while there is room for every gap, and are
+  // merged otherwise
+  for (const int every : {4, 20, 1000}) {
+    std::vector<float> holey_y(y);
+    for (int i = every - 1; i < n; i += every) {
+      holey_y[i] = std::numeric_limits<float>::quiet_NaN();
+    }
+    for (const int holey_target : {3, 100, 500, 2000}) {
+      auto holey = LTTB(holey_target)(create_data().x(x).y(holey_y));
+      CHECK(holey.rows() <= holey_target);
+      CHECK(holey.rows() > 0);
+      // the last row is missing, so there is one gap fewer than missing rows
+      const int gaps = n / every - 1;
+      if (2 * gaps + 1 <= holey_target) {
+        CHECK(holey.valid<Aesthetic::y>().null_count() == gaps);
+      }
+    }
+  }
+
+  // short lines are unchanged, and the transform can be used with Axis::line
+  std::vector<float> short_x = {0.f, 1.f, 2.f};
+  CHECK(LTTB()(create_data().x(short_x).y(short_x)).rows() == 3);
+  auto fig = figure();
+  auto ax = fig->axis();
+  auto line = ax->line(create_data().x(x).y(y), Transform(LTTB(*ax)));
+  CHECK(line->get_data(0).rows() <= 2 * ax->pixels().delta()[0] + 1);
+  CHECK_THROWS_AS(LTTB(2), Exception);
+}
+
+TEST_CASE("bin xy", "[transform]") {
+  std::vector<float> x = {0.5f, 0.5f, 1.5f, 1.5f, 5.f};
+  std::vector<float> y = {0.5f, 0.5f, 0.5f, 1.5f, 0.5f};
+  std::vector<float> c = {1.f, 3.f, 2.f, 4.f, 100.f};
+  const bfloat2_t span({0.f, 0.f}, {2.f, 2.f});
+
+  auto fill = [](const DataWithAesthetic &data) {
+    return std::vector<float>(data.begin<Aesthetic::fill>(),
+                              data.end<Aesthetic::fill>());
+  };
+
+  auto counts = BinXY(2, 2, span)(create_data().x(x).y(y));
+  REQUIRE(counts.rows() == 4);
+  CHECK(fill(counts) == std::vector<float>({2.f, 1.f, 0.f, 1.f}));
+  CHECK(counts.begin<Aesthetic::xmin>()[1] == 1.f);
+  CHECK(counts.begin<Aesthetic::xmax>()[1] == 2.f);
+  CHECK(counts.begin<Aesthetic::ymin>()[3] == 1.f);
+  CHECK(counts.begin<Aesthetic::ymax>()[3] == 2.f);
+
+  auto data = create_data().x(x).y(y).color(c);
+  auto sums = BinXY(2, 2, span).sum<Aesthetic::color>()(data);
+  CHECK(fill(sums) == std::vector<float>({4.f, 2.f, 0.f, 4.f}));
+
+  auto means = BinXY(2, 2, span).mean<Aesthetic::color>()(data);
+  CHECK(means.begin<Aesthetic::fill>()[0] == 2.f);
+  CHECK_FALSE(means.valid<Aesthetic::fill>().test(2));
+
+  // the span defaults to that of the data, and the output size is fixed
+  std::vector<float> big(100000);
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  std::generate(big.begin(), big.end(), [&]() { return normal(gen); });
+  auto grid = BinXY(10, 20)(create_data().x(big).y(big));
+  CHECK(grid.rows() == 200);
+  const auto total = std::accumulate(grid.begin<Aesthetic::fill>(),
+                                     grid.end<Aesthetic::fill>(), 0.f);
+  CHECK(total == 100000.f);
+
+  auto fig = figure();
+  auto ax = fig->axis();
+  ax->rectangle(data, Transform(BinXY(2, 2, span).mean<Aesthetic::color>()));
+  std::stringstream out;
+  BackendSVG backend(out);
+  fig->draw(backend);
+}
+
+TEST_CASE("fused pipelines", "[transform]") {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> x = {-1.f, 0.5f, 1.5f, 1.6f, 3.5f, nan, 2.5f};
+  std::vector<float> y = {1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f};
+  auto data = create_data().x(x).y(y);
+
+  auto positive = [](const float v) { return v > 0.f; };
+  auto small = [](const float v) { return v < 3.f; };
+
+  SECTION("filter") {
+    auto out = (filter<Aesthetic::x>(positive) |
+                filter<Aesthetic::y>([](const float v) { return v > 2.f; }))(
+        data);
+    REQUIRE(out.rows() == 4);
+    CHECK(out.begin<Aesthetic::x>()[0] == 1.5f);
+    CHECK(out.begin<Aesthetic::y>()[3] == 7.f);
+  }
+
+  SECTION("filter and bin") {
+    auto pipeline = filter<Aesthetic::x>(positive) |
+                    filter<Aesthetic::x>(small) |
+                    bin<Aesthetic::x>(3, 0.f, 3.f);
+    auto out = pipeline(data);
+    std::vector<float> counts(out.begin<Aesthetic::y>(),
+                              out.end<Aesthetic::y>());
+    CHECK(counts == std::vector<float>({1.f, 2.f, 1.f}));
+  }
+
+  SECTION("normalize") {
+    auto out = (bin<Aesthetic::x>(4, 0.f, 4.f) | normalize())(data);
+    const float integral = std::accumulate(out.begin<Aesthetic::y>(),
+                                           out.end<Aesthetic::y>(), 0.f);
+    CHECK(integral == Approx(1.f));
+    auto max = (bin<Aesthetic::x>(4, 0.f, 4.f) |
+                normalize(pipeline::Normalization::max))(data);
+    CHECK(max.limits().bmax[Aesthetic::y::index] == 1.f);
+  }
+
+  SECTION("matches BinX") {
+    std::vector<float> big(100000);
+    std::default_random_engine gen;
+    std::normal_distribution<float> normal(0, 1);
+    std::generate(big.begin(), big.end(), [&]() { return normal(gen); });
+    auto big_data = create_data().x(big);
+    BinX binx(40);
+    auto expected = binx(big_data);
+    auto out = bin<Aesthetic::x>(40)(big_data);
+    CHECK(std::equal(out.begin<Aesthetic::y>(), out.end<Aesthetic::y>(),
+                     expected.begin<Aesthetic::y>()));
+  }
+
+  SECTION("accepted as a transform") {
+    auto fig = figure();
+    auto ax = fig->axis();
+    auto hist = ax->histogram(data, filter<Aesthetic::x>(positive) |
+                                        bin<Aesthetic::x>(5) | normalize());
+    CHECK(hist->get_data(0).rows() == 5);
+    auto points = ax->points(data, filter<Aesthetic::x>(small));
+    CHECK(points->get_data(0).rows() == 5);
+  }
+}
+
+TEST_CASE("quantile sketch", "[transform]") {
+  std::default_random_engine gen;
+  std::uniform_real_distribution<float> uniform(0, 1);
+  QuantileSketch a;
+  QuantileSketch b;
+  for (int i = 0; i < 100000; ++i) {
+    a.add(uniform(gen));
+    b.add(uniform(gen) + 1.f);
+  }
+  CHECK(a.size() < 2000);
+  CHECK(a.quantile(0.5f) == Approx(0.5f).margin(0.02f));
+  CHECK(a.quantile(0.9f) == Approx(0.9f).margin(0.02f));
+  a.merge(b);
+  CHECK(a.count() == 200000);
+  CHECK(a.quantile(0.5f) == Approx(1.f).margin(0.04f));
+  CHECK(a.quantile(0.25f) == Approx(0.5f).margin(0.04f));
+  CHECK(a.quantile(0.f) == a.min());
+  CHECK(a.quantile(1.f) == a.max());
+}
+
+TEST_CASE("exact quantiles", "[transform]") {
+  // group 0 is 1..9 plus an outlier, group 1 is 10..18
+  std::vector<float> x;
+  std::vector<float> y;
+  for (int i = 1; i <= 9; ++i) {
+    x.push_back(0.f);
+    y.push_back(static_cast<float>(i));
+    x.push_back(1.f);
+    y.push_back(static_cast<float>(i + 9));
+  }
+  x.push_back(0.f);
+  y.push_back(100.f);
+
+  Quantiles quantiles;
+  const auto summaries = quantiles.summarise(create_data().x(x).y(y));
+  REQUIRE(summaries.size() == 2);
+  CHECK(summaries[0].group == 0.f);
+  CHECK(summaries[0].count == 10);
+  CHECK(summaries[0].median == 5.5f);
+  CHECK(summaries[0].lower_quartile == 3.25f);
+  CHECK(summaries[0].upper_quartile == 7.75f);
+  CHECK(summaries[0].lower_whisker == 1.f);
+  CHECK(summaries[0].upper_whisker == 9.f);
+  CHECK(summaries[1].median == 14.f);
+  CHECK(summaries[1].lower_quartile == 12.f);
+  CHECK(summaries[1].upper_whisker == 18.f);
+
+  auto boxes = quantiles(create_data().x(x).y(y));
+  REQUIRE(boxes.rows() == 2);
+  CHECK(boxes.begin<Aesthetic::xmin>()[1] == Approx(0.6f));
+  CHECK(boxes.begin<Aesthetic::ymax>()[1] == 16.f);
+
+  Quantiles whiskers(Quantiles::Mode::exact, Quantiles::Output::whiskers);
+  auto lines = whiskers(create_data().x(x).y(y));
+  CHECK(lines.rows() == 18);
+  CHECK(lines.valid<Aesthetic::y>().null_count() == 6);
+
+  auto fig = figure();
+  auto ax = fig->axis();
+  ax->rectangle(create_data().x(x).y(y), Transform(quantiles));
+  ax->line(create_data().x(x).y(y), Transform(whiskers));
+  std::stringstream out;
+  BackendSVG backend(out);
+  fig->draw(backend);
+}
+
+TEST_CASE("approximate quantiles of streamed chunks", "[transform]") {
+  std::default_random_engine gen;
+  std::normal_distribution<float> normal(0, 1);
+  Quantiles quantiles(Quantiles::Mode::approximate);
+  std::vector<float> x(10000);
+  std::vector<float> y(10000);
+  for (int chunk = 0; chunk < 5; ++chunk) {
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = static_cast<float>(i % 3);
+      y[i] = normal(gen) + x[i];
+    }
+    quantiles(create_data().x(x).y(y));
+  }
+  const auto summaries = quantiles.summarise(DataWithAesthetic());
+  REQUIRE(summaries.size() == 3);
+  for (int g = 0; g < 3; ++g) {
+    CHECK(summaries[g].count > 16000);
+    CHECK(summaries[g].median == Approx(g).margin(0.05f));
+    CHECK(summaries[g].upper_quartile - summaries[g].lower_quartile ==
+          Approx(1.349f).margin(0.1f));
+  }
+}